@@ -1,18 +1,24 @@
 #ifndef SO_PROJEKT_COMMON_H
 #define SO_PROJEKT_COMMON_H
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <optional>
 #include <random>
+#include <sched.h>
 #include <utility>
 #include <string>
 #include <string_view>
 #include <stdexcept>
+#include <sys/types.h>
+#include "futex.h"
 
 typedef std::pair<short, short> HoursOpen; // tp, tk
 
-enum class Identity { Petent, Urzednik, Dyrektor, Rejestracja, Generator, Kasa };
+enum class Identity { Petent, Urzednik, Dyrektor, Rejestracja, Generator, Kasa, LogDump };
+constexpr size_t kIdentityCount = 7;
 
 inline std::optional<Identity> string_to_identity(std::string_view str) {
     if (str == "petent") return Identity::Petent;
@@ -21,6 +27,7 @@ inline std::optional<Identity> string_to_identity(std::string_view str) {
     if (str == "rejestracja") return Identity::Rejestracja;
     if (str == "generator") return Identity::Generator;
     if (str == "kasa") return Identity::Kasa;
+    if (str == "logdump") return Identity::LogDump;
     return std::nullopt;
 }
 
@@ -48,22 +55,380 @@ enum class OfficeStatus: bool { Open, Closed };
 
 enum class TicketRejectReason : uint8_t { None, OfficeClosed, LimitReached };
 
-struct SharedState {
+// How ipc::msg moves messages: SysV message queues, the shared-memory rings from shmqueue.h
+// or POSIX message queues from posixmq.h
+enum class MsgTransport : uint8_t { SysV, Shm, Posix };
+
+inline std::optional<MsgTransport> string_to_msg_transport(std::string_view str) {
+    if (str == "sysv") return MsgTransport::SysV;
+    if (str == "shm") return MsgTransport::Shm;
+    if (str == "posix") return MsgTransport::Posix;
+    return std::nullopt;
+}
+
+inline std::string_view msg_transport_to_string(MsgTransport transport) {
+    if (transport == MsgTransport::Shm) return "shm";
+    if (transport == MsgTransport::Posix) return "posix";
+    return "sysv";
+}
+
+// Where the generator runs petents: a process each (fork + exec), threads of the generator itself
+// or processes forked by a zygote that has already attached SharedState and the queues
+enum class PetentHost : uint8_t { Process, Thread, Zygote };
+
+inline std::optional<PetentHost> string_to_petent_host(std::string_view str) {
+    if (str == "process") return PetentHost::Process;
+    if (str == "thread") return PetentHost::Thread;
+    if (str == "zygote") return PetentHost::Zygote;
+    return std::nullopt;
+}
+
+inline std::string_view petent_host_to_string(PetentHost host) {
+    if (host == PetentHost::Thread) return "thread";
+    if (host == PetentHost::Zygote) return "zygote";
+    return "process";
+}
+
+constexpr size_t kDepartmentCount = 5;
+
+// Clerks of each department, indexed by UrzednikRole
+using ClerkCounts = std::array<int, kDepartmentCount>;
+
+// Daily ticket limits indexed by UrzednikRole (SharedState::ticket_limits). X1..X5 (SA, SC, KM, ML, PD) are per clerk,
+// so a department's limit is set by its starting staff.
+inline std::array<uint32_t, kDepartmentCount> department_ticket_limits(const std::array<uint32_t, 5>& per_clerk,
+                                                                       const ClerkCounts& clerks) {
+    auto clerks_of = [&](UrzednikRole role) { return static_cast<uint32_t>(clerks[static_cast<size_t>(role)]); };
+    return {
+        per_clerk[1] * clerks_of(UrzednikRole::SC),
+        per_clerk[2] * clerks_of(UrzednikRole::KM),
+        per_clerk[3] * clerks_of(UrzednikRole::ML),
+        per_clerk[4] * clerks_of(UrzednikRole::PD),
+        per_clerk[0] * clerks_of(UrzednikRole::SA)
+    };
+}
+constexpr int kMaxClerksPerDepartment = 16;
+
+// Kasa windows (processes sharing MsgQueueKasa), numbered from 1
+constexpr int kMaxKasaWindows = 8;
+
+// Petents of one department away at the kasa at the same time (SharedState::parked); a clerk finding the table full
+// finishes the petent without sending it to pay
+constexpr size_t kMaxParkedPerDepartment = 128;
+
+enum class RealtimePolicy : uint8_t { None, Fifo, Rr };
+
+inline std::optional<RealtimePolicy> string_to_realtime_policy(std::string_view str) {
+    if (str == "none") return RealtimePolicy::None;
+    if (str == "fifo") return RealtimePolicy::Fifo;
+    if (str == "rr") return RealtimePolicy::Rr;
+    return std::nullopt;
+}
+
+inline std::string_view realtime_policy_to_string(RealtimePolicy policy) {
+    if (policy == RealtimePolicy::Fifo) return "fifo";
+    if (policy == RealtimePolicy::Rr) return "rr";
+    return "none";
+}
+
+// CPU sets of the roles (an empty set leaves the role where the scheduler puts it) and the real-time class of
+// dyrektor's clock thread and the ticket machines; applied through placement.h
+struct PlacementConfig {
+    cpu_set_t dyrektor; // with the clock, log flusher and sampler threads
+    cpu_set_t rejestracja;
+    cpu_set_t kasa;
+    cpu_set_t generator;
+    cpu_set_t petent;
+    std::array<cpu_set_t, kDepartmentCount> urzednik; // indexed by UrzednikRole
+    RealtimePolicy realtime = RealtimePolicy::None;
+    int realtime_priority = 10; // SCHED_FIFO/SCHED_RR priority, 1-99
+};
+
+// Latency accumulated over a day in microseconds: sum and count for the average, plus the maximum
+struct LatencyStat {
+    std::atomic<uint64_t> total_us;
+    std::atomic<uint32_t> count;
+    std::atomic<uint32_t> max_us;
+
+    void reset() {
+        total_us = 0;
+        count = 0;
+        max_us = 0;
+    }
+
+    void record(uint64_t us) {
+        total_us.fetch_add(us, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        auto value = static_cast<uint32_t>(us > UINT32_MAX ? UINT32_MAX : us);
+        uint32_t current = max_us.load(std::memory_order_relaxed);
+        while (value > current && !max_us.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+};
+
+// Per-day KPI counters, bumped by the workers during the day and summarised by dyrektor at rollover.
+// Arrays are indexed by UrzednikRole.
+struct DayStats {
+    std::atomic<uint32_t> served[kDepartmentCount];
+    std::atomic<uint32_t> redirected_from_sa[kDepartmentCount]; // by target department
+    std::atomic<uint32_t> sent_to_kasa[kDepartmentCount];
+    std::atomic<uint32_t> rejected_limit[kDepartmentCount];
+    std::atomic<uint32_t> rejected_closed[kDepartmentCount];
+    std::atomic<uint32_t> unserved[kDepartmentCount]; // left in the queues at close or on SIGUSR1
+    std::atomic<uint32_t> evacuated;
+    std::atomic<uint32_t> peak_queue_length;
+    std::atomic<uint32_t> peak_ticket_machines;
+    std::atomic<uint32_t> peak_kasa_windows;
+    std::atomic<uint32_t> kasa_payments[kMaxKasaWindows]; // by window
+    std::atomic<uint32_t> kasa_busy_sec[kMaxKasaWindows]; // simulated seconds spent taking payments
+    LatencyStat petent_startup; // generator's arrival to the petent running its visit
+    LatencyStat petent_first_send; // generator's arrival to the ticket request msgsnd
+
+    void reset() {
+        for (size_t i = 0; i < kDepartmentCount; ++i) {
+            served[i] = 0;
+            redirected_from_sa[i] = 0;
+            sent_to_kasa[i] = 0;
+            rejected_limit[i] = 0;
+            rejected_closed[i] = 0;
+            unserved[i] = 0;
+        }
+        evacuated = 0;
+        peak_queue_length = 0;
+        peak_ticket_machines = 0;
+        peak_kasa_windows = 0;
+        for (int i = 0; i < kMaxKasaWindows; ++i) {
+            kasa_payments[i] = 0;
+            kasa_busy_sec[i] = 0;
+        }
+        petent_startup.reset();
+        petent_first_send.reset();
+    }
+
+    static void bump(std::atomic<uint32_t>* counters, UrzednikRole dept) {
+        auto idx = static_cast<size_t>(dept);
+        if (idx < kDepartmentCount) {
+            counters[idx].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    static void raise_peak(std::atomic<uint32_t>& peak, uint32_t value) {
+        uint32_t current = peak.load(std::memory_order_relaxed);
+        while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+};
+
+// Startup parameters of the simulation, published by dyrektor so that spawned roles need no argv beyond --role
+struct ProcessConfig {
+    HoursOpen hours_open;
+    std::array<uint32_t, 5> department_limits;
+    int time_mul;
+    int gen_min_delay_sec;
+    int gen_max_delay_sec;
+    int gen_max_count;
+    bool one_day;
+    int building_capacity;
+    PetentHost petent_host;
+    int petent_threads; // most petents hosted at once in PetentHost::Thread mode
+    PlacementConfig placement;
+};
+
+// One message queue as seen by children: the ftok() key plus the msqid (SysV) or shm segment id (shm transport)
+struct MsgEndpoint {
+    key_t key;
+    int id;
+};
+
+// Replies to petents (tickets, service and payment confirmations, mtype = petent pid) go to their own queues,
+// sharded by pid, so that they neither crowd out ticket requests nor make msgrcv() scan one long queue
+constexpr size_t kReplyShardCount = 4;
+
+// IPC ids created by dyrektor; children resolve them from here instead of ftok() + msgget() each
+struct IpcRegistry {
+    uint32_t published; // 0 until dyrektor has filled in the registry
+    MsgEndpoint rejestracja;
+    MsgEndpoint kasa;
+    MsgEndpoint departments[kDepartmentCount]; // indexed by UrzednikRole
+    MsgEndpoint replies[kReplyShardCount];
+};
+
+constexpr size_t kCacheLine = 64;
+
+// Ticket counter of one department on its own cache line, so machines issuing for different departments never
+// bounce a shared line between them
+struct alignas(kCacheLine) TicketCounter {
+    std::atomic<uint32_t> value;
+};
+
+// A petent a clerk has sent to the kasa. The slot is taken and given back with a CAS on petent_id, so whichever clerk
+// of the department takes the return resumes it, and dyrektor releases what is still taken at day end.
+struct ParkedPetent {
+    std::atomic<uint32_t> petent_id; // 0 = free
+    uint32_t ticket_number;
+};
+
+// Consistent copy of the mutable SharedState fields, see SharedState::snapshot()
+struct StateSnapshot {
     uint32_t day;
-    uint32_t building_capacity; // N
+    uint32_t simulated_time;
+    OfficeStatus office_status;
     uint32_t current_queue_length;
     uint8_t ticket_machines_num;
+};
+
+// Laid out by writer: read-mostly config first, then one cache line per hot mutable field, so the clock thread
+// ticking simulated_time does not invalidate the lines every petent and ticket machine reads or writes.
+struct SharedState {
+    // Read-mostly, written by dyrektor before the children are spawned
+    uint32_t building_capacity; // N
     uint32_t ticket_limits[5];
-    uint32_t ticket_counters[5];
-    uint32_t simulated_time; // Essentially ticks (which can be affected by time_mul)
     uint32_t time_mul;
-    OfficeStatus office_status;
+    MsgTransport msg_transport; // chosen by dyrektor, picked up by children in ipc::helper::get_shared_state
+    ProcessConfig config;
+    IpcRegistry registry;
+
+    // Written by the clock thread only; clock_seq is the seqlock sequence of day, office_status and simulated_time
+    alignas(kCacheLine) std::atomic<uint32_t> clock_seq;
+    std::atomic<uint32_t> day;
+    std::atomic<uint32_t> simulated_time; // Essentially ticks (which can be affected by time_mul)
+    std::atomic<OfficeStatus> office_status;
+
+    // Petents entering the building minus those handed a ticket; queue_arrivals only counts the entries, for the
+    // arrival rate of dyrektor's scaling policy
+    alignas(kCacheLine) std::atomic<uint32_t> current_queue_length;
+    std::atomic<uint32_t> queue_arrivals;
+
+    // Free places in the ticket hall (N - 1); a petent with a child takes two
+    alignas(kCacheLine) ipc::sync::Semaphore admission;
+
+    // Set by the clock while the office is open, so idle processes can sleep until it opens
+    alignas(kCacheLine) ipc::sync::Event office_open;
+
+    // Set by dyrektor before it signals the evacuation at shutdown; never reset
+    ipc::sync::Event evacuation;
+
+    // Day rollover handshake with the persistent workers (rejestracja, urzednicy, kasa): dyrektor resets day_start,
+    // bumps worker_epoch and rings them; each worker does its day-end work, counts itself in day_end_acks, writes
+    // dyrektor's ack eventfd (dayshift::kAckFdEnv) and sleeps on day_start until dyrektor has drained the queues and
+    // reset the day
+    alignas(kCacheLine) std::atomic<uint32_t> worker_epoch;
+    std::atomic<uint32_t> day_end_acks;
+    ipc::sync::Event day_start;
+
+    // Written by dyrektor's autoscaler
+    alignas(kCacheLine) std::atomic<uint8_t> ticket_machines_num;
+
+    TicketCounter ticket_counters[5]; // allocated lock-free with take_ticket(), reset by dyrektor at rollover
+
+    // Petents at the kasa, per department (indexed by UrzednikRole); see park()
+    alignas(kCacheLine) ParkedPetent parked[kDepartmentCount][kMaxParkedPerDepartment];
+    alignas(kCacheLine) DayStats stats;
 
     SharedState(uint32_t capacity, const std::array<uint32_t, 5>& limits, uint32_t time_mul_value) :
-        day(0), building_capacity(capacity), current_queue_length(0), ticket_machines_num(1),
-        ticket_limits{limits[0], limits[1], limits[2], limits[3], limits[4]},
-        ticket_counters{0, 0, 0, 0, 0},
-        simulated_time(0), time_mul(time_mul_value), office_status(OfficeStatus::Closed) {}
+        building_capacity(capacity), ticket_limits{limits[0], limits[1], limits[2], limits[3], limits[4]},
+        time_mul(time_mul_value), msg_transport(MsgTransport::SysV), config{}, registry{},
+        clock_seq(0), day(0), simulated_time(0), office_status(OfficeStatus::Closed),
+        current_queue_length(0), queue_arrivals(0), admission{}, office_open{}, evacuation{}, worker_epoch(0),
+        day_end_acks(0), day_start{}, ticket_machines_num(1), ticket_counters{} {
+        admission.reset(capacity > 1 ? capacity - 1 : 1);
+        office_open.init(false);
+        evacuation.init(false);
+        day_start.init(true);
+        for (auto& counter : ticket_counters) {
+            counter.value = 0;
+        }
+        for (auto& department : parked) {
+            for (ParkedPetent& slot : department) {
+                slot.petent_id.store(0, std::memory_order_relaxed);
+                slot.ticket_number = 0;
+            }
+        }
+        stats.reset();
+    }
+
+    // Next ticket number of the department, or 0 once its limit is reached (a limit of 0 means unlimited).
+    // A CAS loop instead of the state semaphore, so ticket machines and SA clerks never serialize on it.
+    uint32_t take_ticket(UrzednikRole dept) {
+        auto idx = static_cast<size_t>(dept);
+        uint32_t limit = ticket_limits[idx];
+        std::atomic<uint32_t>& counter = ticket_counters[idx].value;
+        uint32_t current = counter.load(std::memory_order_relaxed);
+        do {
+            if (limit != 0 && current >= limit) {
+                return 0;
+            }
+        } while (!counter.compare_exchange_weak(current, current + 1, std::memory_order_relaxed));
+        return current + 1;
+    }
+
+    // Records a petent sent to the kasa; false when the department's table is full
+    bool park(UrzednikRole dept, uint32_t petent_id, uint32_t ticket_number) {
+        for (ParkedPetent& slot : parked[static_cast<size_t>(dept)]) {
+            uint32_t expected = 0;
+            if (slot.petent_id.compare_exchange_strong(expected, petent_id, std::memory_order_acq_rel)) {
+                slot.ticket_number = ticket_number;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Gives the petent's slot back; false when it is not parked (any more), e.g. released by dyrektor at day end
+    bool unpark(UrzednikRole dept, uint32_t petent_id) {
+        for (ParkedPetent& slot : parked[static_cast<size_t>(dept)]) {
+            uint32_t expected = petent_id;
+            if (slot.petent_id.compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void enter_queue() {
+        uint32_t length = current_queue_length.fetch_add(1, std::memory_order_relaxed) + 1;
+        queue_arrivals.fetch_add(1, std::memory_order_relaxed);
+        DayStats::raise_peak(stats.peak_queue_length, length);
+    }
+
+    // Decrements current_queue_length by up to `count` without wrapping below zero
+    void leave_queue(uint32_t count) {
+        uint32_t current = current_queue_length.load(std::memory_order_relaxed);
+        while (!current_queue_length.compare_exchange_weak(current, current - std::min(current, count),
+                                                            std::memory_order_relaxed)) {
+        }
+    }
+
+    // Clock thread only: publishes a new day/status/time triple that snapshot() readers see all at once
+    void publish_clock(uint32_t new_day, OfficeStatus status, uint32_t time) {
+        uint32_t seq = clock_seq.load(std::memory_order_relaxed);
+        clock_seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        day.store(new_day, std::memory_order_relaxed);
+        office_status.store(status, std::memory_order_relaxed);
+        simulated_time.store(time, std::memory_order_relaxed);
+        clock_seq.store(seq + 2, std::memory_order_release);
+    }
+
+    // Seqlock read: retried while the clock thread is mid-update, so day and time never come from different days
+    StateSnapshot snapshot() const {
+        StateSnapshot result{};
+        uint32_t seq_before = 0;
+        uint32_t seq_after = 0;
+        do {
+            seq_before = clock_seq.load(std::memory_order_acquire);
+            result.day = day.load(std::memory_order_relaxed);
+            result.office_status = office_status.load(std::memory_order_relaxed);
+            result.simulated_time = simulated_time.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            seq_after = clock_seq.load(std::memory_order_relaxed);
+        } while ((seq_before & 1u) != 0 || seq_before != seq_after);
+        result.current_queue_length = current_queue_length.load(std::memory_order_relaxed);
+        result.ticket_machines_num = ticket_machines_num.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    bool is_open() const { return office_status.load(std::memory_order_acquire) == OfficeStatus::Open; }
 };
 
 struct TicketRequestMsg {
@@ -81,9 +446,13 @@ struct TicketIssuedMsg {
     uint8_t redirected_from_sa; // boolean
     TicketRejectReason reject_reason; // uint8_t
     uint8_t is_vip; // boolean - priority queue flag
+    uint8_t from_kasa; // boolean - the petent's ticket again, sent back to the department after paying
+    uint8_t padding[3]; // for explicit alignment
 };
 
-enum class ServiceAction : uint8_t { Complete, GoToKasa };
+// Complete and GoToKasa come from the clerk, Paid from the kasa, Released from dyrektor for a petent still away at
+// the kasa when the day ends
+enum class ServiceAction : uint8_t { Complete, GoToKasa, Paid, Released };
 
 struct ServiceDoneMsg {
     uint32_t petent_id;
@@ -92,7 +461,7 @@ struct ServiceDoneMsg {
     uint8_t padding[2]; // for explicit alignment
 };
 
-// Sent by petent to kasa queue, and back to urzednik queue
+// Sent by petent to kasa queue
 struct KasaRequestMsg {
     uint32_t petent_id;
     UrzednikRole department; // uint8_t
@@ -104,9 +473,13 @@ struct KasaRequestMsg {
 constexpr long kVipQueueType = 1;
 constexpr long kNormalQueueType = 2;
 constexpr long kTicketRequestType = 1;
-constexpr long kKasaReturnQueueType = 3; // returning petents
+constexpr long kKasaReturnQueueType = 3; // petents back from the kasa (TicketIssuedMsg with from_kasa set)
 constexpr long kKasaRequestType = 1; // payment requests
 
+// sigqueue() payload of SIGUSR1 when dyrektor retires a clerk: it finishes the petent in hand and leaves its
+// department's queue to the remaining clerks instead of reporting it unserved
+constexpr int kRetireClerkSignalValue = 1;
+
 namespace rng {
     inline int random_int(int min_inclusive, int max_inclusive) {
         static thread_local std::mt19937 engine(std::random_device{}());
@@ -0,0 +1,94 @@
+#ifndef SO_PROJEKT_DAYSHIFT_H
+#define SO_PROJEKT_DAYSHIFT_H
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include "common.h"
+#include "ipcutils.h"
+
+// Worker side of the day rollover handshake (SharedState::worker_epoch). Rejestracja, urzednicy and kasa stay alive
+// across days: when dyrektor bumps the epoch and rings kDayEndSignal, a worker finishes the item in hand, does its
+// day-end work in place, acknowledges and sleeps until dyrektor starts the next day.
+namespace dayshift {
+
+    // Only interrupts a blocking receive or sleep; what to do is read from SharedState::worker_epoch
+    constexpr int kDayEndSignal = SIGHUP;
+
+    // The day_start wait is re-armed this often, so shutdown flags raised by a lost signal are still noticed
+    constexpr long kDayStartPollMs = 200;
+
+    inline void handle_day_end_signal(int) {}
+
+    inline int install_day_end_handler() { return ipc::install_signal_handler(kDayEndSignal, handle_day_end_signal); }
+
+    // dyrektor's eventfd for the acks, handed only to the workers it spawns: their copy of the descriptor loses
+    // FD_CLOEXEC and its number is put in this variable between fork and exec (see process.cpp)
+    constexpr const char* kAckFdEnv = "SO_PROJEKT_DAY_END_ACK_FD";
+
+    // -1 unless the variable names an open eventfd, e.g. for a role started by hand; acks then only go to the counter.
+    // The worker's own descriptor goes back to FD_CLOEXEC so nothing it might exec inherits it in turn.
+    inline int inherited_ack_fd() {
+        const char* value = getenv(kAckFdEnv);
+        if (value == nullptr || *value == '\0') {
+            return -1;
+        }
+        char* end = nullptr;
+        long fd = std::strtol(value, &end, 10);
+        if (*end != '\0' || fd < 0) {
+            return -1;
+        }
+        char link[64] = {};
+        std::string path = "/proc/self/fd/" + std::to_string(fd);
+        if (readlink(path.c_str(), link, sizeof(link) - 1) == -1 || std::strcmp(link, "anon_inode:[eventfd]") != 0) {
+            return -1;
+        }
+        fcntl(static_cast<int>(fd), F_SETFD, FD_CLOEXEC);
+        return static_cast<int>(fd);
+    }
+
+    class Shift {
+    public:
+        explicit Shift(SharedState* shared_state) :
+            shared_state(shared_state), epoch(shared_state->worker_epoch.load(std::memory_order_acquire)),
+            ack_fd(inherited_ack_fd()) {}
+
+        bool day_ended() const { return shared_state->worker_epoch.load(std::memory_order_acquire) != epoch; }
+
+        // Acknowledges the day end and sleeps until dyrektor starts the next day (or ends another one). Returns false
+        // when `should_stop` turns true meanwhile: the worker is being shut down instead.
+        template <typename StopPredicate>
+        bool finish_day(StopPredicate should_stop) {
+            epoch = shared_state->worker_epoch.load(std::memory_order_acquire);
+            shared_state->day_end_acks.fetch_add(1, std::memory_order_acq_rel);
+            uint64_t one = 1;
+            if (ack_fd != -1 && write(ack_fd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+                perror("eventfd write failed");
+            }
+            while (!shared_state->day_start.is_set() && !day_ended()) {
+                if (should_stop()) {
+                    return false;
+                }
+                timespec timeout = ipc::futex::millis(kDayStartPollMs);
+                shared_state->day_start.wait(&timeout);
+            }
+            return !should_stop();
+        }
+
+    private:
+        SharedState* shared_state;
+        uint32_t epoch;
+        int ack_fd;
+    };
+
+} // namespace dayshift
+
+#endif // SO_PROJEKT_DAYSHIFT_H
@@ -0,0 +1,423 @@
+#include "des.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+#include "../logger.h"
+#include "../report.h"
+
+namespace des {
+
+    constexpr uint32_t kDayEndDelaySec = 120; // dyrektor's clock runs on for two minutes after closing
+    constexpr int kRedirectPercent = 40; // SA services that end with a ticket to another department
+    constexpr int kKasaPercent = 10; // other services that send the petent to the kasa first
+
+    enum class EventKind : uint8_t {
+        Arrival,
+        ServiceDone, // index: clerk
+        PaymentDone, // index: kasa window
+        Close,
+        DayEnd,
+    };
+
+    struct Event {
+        uint32_t time; // simulated seconds since midnight
+        uint64_t seq; // events due in the same second run in the order they were scheduled
+        EventKind kind;
+        size_t index;
+    };
+
+    struct Later {
+        bool operator()(const Event& a, const Event& b) const {
+            return a.time != b.time ? a.time > b.time : a.seq > b.seq;
+        }
+    };
+
+    struct Ticket {
+        uint32_t petent_id;
+        uint32_t ticket_number;
+        UrzednikRole department;
+        bool is_vip;
+        bool redirected_from_sa;
+    };
+
+    struct Clerk {
+        UrzednikRole role;
+        bool busy;
+        Ticket ticket;
+    };
+
+    struct Window {
+        bool open;
+        bool busy;
+        Ticket ticket;
+        uint32_t started;
+    };
+
+    // One office on virtual time. The counters live in a SharedState of its own, so ticket limits, DayStats and the
+    // day summary are exactly those of the process simulation.
+    class Engine {
+    public:
+        Engine(const Config& config, SharedState& state)
+            : config(config), state(state), random(config.seed),
+              kasa_policy(scaling::make_policy(config.kasa_scaling)) {
+            for (size_t idx = 0; idx < kDepartmentCount; ++idx) {
+                for (int i = 0; i < config.clerk_counts[idx]; ++i) {
+                    clerks.push_back({static_cast<UrzednikRole>(idx), false, {}});
+                }
+            }
+            set_windows(config.kasa_scaling.min_machines);
+        }
+
+        // `day` counts from 0, as SharedState::day; returns -1 when the summary could not be written
+        int run_day(uint32_t day) {
+            uint32_t report_day = day + 1;
+            report::Writer day_report(report_day);
+            writer = &day_report;
+            this->day = day;
+            day_over = false;
+            now = static_cast<uint32_t>(config.hours_open.first * 3600);
+            close_time = static_cast<uint32_t>(config.hours_open.second * 3600);
+            open = true;
+            state.publish_clock(day, OfficeStatus::Open, now);
+
+            state.ticket_machines_num.store(static_cast<uint8_t>(config.ticket_machines), std::memory_order_relaxed);
+            DayStats::raise_peak(state.stats.peak_ticket_machines, static_cast<uint32_t>(config.ticket_machines));
+            DayStats::raise_peak(state.stats.peak_kasa_windows, static_cast<uint32_t>(open_windows));
+
+            schedule(now, EventKind::Arrival);
+            schedule(close_time, EventKind::Close);
+            schedule(close_time + kDayEndDelaySec, EventKind::DayEnd);
+
+            // Past the day end only the services and payments in hand are left to finish
+            while (!pending.empty()) {
+                Event event = pending.top();
+                pending.pop();
+                now = event.time;
+                processed++;
+                switch (event.kind) {
+                    case EventKind::Arrival:
+                        arrive();
+                        break;
+                    case EventKind::ServiceDone:
+                        finish_service(clerks[event.index]);
+                        break;
+                    case EventKind::PaymentDone:
+                        finish_payment(windows[event.index]);
+                        break;
+                    case EventKind::Close:
+                        open = false;
+                        state.publish_clock(day, OfficeStatus::Closed, now);
+                        break;
+                    case EventKind::DayEnd:
+                        end_day();
+                        break;
+                }
+            }
+
+            // As at rollover: the clock already shows the next day, still at the end of this one
+            state.publish_clock(day + 1, OfficeStatus::Closed, close_time + kDayEndDelaySec);
+            day_report.flush();
+            writer = nullptr;
+            report::DaySummary summary = report::snapshot_day(report_day, state);
+            int rc = report::write_day_summary(summary);
+
+            report::DepartmentSummary total = report::summary_total(summary);
+            Logger::log<LogSeverity::Info>(Identity::Dyrektor, [&] {
+                return "Dzien " + std::to_string(report_day) + ": wydane " + std::to_string(total.issued) +
+                       ", obsluzone " + std::to_string(total.served) + ", nieobsluzone " +
+                       std::to_string(total.unserved) + ", odrzucone (limit) " +
+                       std::to_string(total.rejected_limit) + ".";
+            });
+
+            for (auto& counter : state.ticket_counters) {
+                counter.value.store(0, std::memory_order_relaxed);
+            }
+            state.current_queue_length.store(0, std::memory_order_relaxed);
+            state.stats.reset();
+            return rc;
+        }
+
+        uint64_t events() const { return processed; }
+
+    private:
+        int uniform(int min_inclusive, int max_inclusive) {
+            return std::uniform_int_distribution<int>(min_inclusive, max_inclusive)(random);
+        }
+
+        // Same odds as the generator's choose_department()
+        UrzednikRole choose_department() {
+            int roll = uniform(1, 100);
+            if (roll <= 60) {
+                return UrzednikRole::SA;
+            }
+            if (roll <= 70) {
+                return UrzednikRole::SC;
+            }
+            if (roll <= 80) {
+                return UrzednikRole::KM;
+            }
+            if (roll <= 90) {
+                return UrzednikRole::ML;
+            }
+            return UrzednikRole::PD;
+        }
+
+        // 5-30 simulated minutes, as short_work_delay() and payment_delay()
+        uint32_t work_duration() { return static_cast<uint32_t>(uniform(5, 30) * 60); }
+
+        void schedule(uint32_t time, EventKind kind, size_t index = 0) {
+            pending.push({time, next_seq++, kind, index});
+        }
+
+        void arrive() {
+            // The generator only sends petents while the office is open and stops at its limit
+            if (!open || (config.gen_max_count >= 0 && generated >= config.gen_max_count)) {
+                return;
+            }
+            generated++;
+            Ticket ticket{next_petent_id++, 0, choose_department(), uniform(1, 10) == 1, false};
+            schedule(now + static_cast<uint32_t>(uniform(config.gen_min_delay_sec, config.gen_max_delay_sec)),
+                     EventKind::Arrival);
+
+            // Ticket machines are not modelled: the petent is in the ticket hall only for the instant of issuing, so
+            // no admission is needed - the hall never holds more than this one petent
+            state.enter_queue();
+            state.leave_queue(1);
+            ticket.ticket_number = state.take_ticket(ticket.department);
+            if (ticket.ticket_number == 0) {
+                DayStats::bump(state.stats.rejected_limit, ticket.department);
+                return;
+            }
+            enqueue(ticket);
+        }
+
+        void enqueue(const Ticket& ticket) {
+            auto idx = static_cast<size_t>(ticket.department);
+            (ticket.is_vip ? vip_queues[idx] : queues[idx]).push_back(ticket);
+            dispatch(ticket.department);
+        }
+
+        // Idle clerks of the department take the next tickets, VIPs first
+        void dispatch(UrzednikRole role) {
+            auto idx = static_cast<size_t>(role);
+            for (size_t c = 0; c < clerks.size(); ++c) {
+                Clerk& clerk = clerks[c];
+                if (clerk.role != role || clerk.busy) {
+                    continue;
+                }
+                std::deque<Ticket>& queue = !vip_queues[idx].empty() ? vip_queues[idx] : queues[idx];
+                if (queue.empty()) {
+                    return;
+                }
+                clerk.ticket = queue.front();
+                queue.pop_front();
+                clerk.busy = true;
+                schedule(now + work_duration(), EventKind::ServiceDone, c);
+            }
+        }
+
+        void finish_service(Clerk& clerk) {
+            clerk.busy = false;
+            const Ticket& ticket = clerk.ticket;
+
+            if (clerk.role == UrzednikRole::SA && open && uniform(1, 100) <= kRedirectPercent) {
+                static const UrzednikRole kTargets[] = {UrzednikRole::SC, UrzednikRole::KM, UrzednikRole::ML,
+                                                        UrzednikRole::PD};
+                UrzednikRole target = kTargets[uniform(0, 3)];
+                uint32_t ticket_number = state.take_ticket(target);
+                if (ticket_number == 0) {
+                    DayStats::bump(state.stats.rejected_limit, target);
+                    writer->unserved_after_signal(ticket.petent_id, target, "SA");
+                    DayStats::bump(state.stats.served, clerk.role);
+                }
+                else {
+                    DayStats::bump(state.stats.redirected_from_sa, target);
+                    enqueue({ticket.petent_id, ticket_number, target, ticket.is_vip, true});
+                }
+            }
+            else if (clerk.role != UrzednikRole::SA && open && uniform(1, 100) <= kKasaPercent) {
+                // The clerk parks the petent and serves others; the service ends when the petent is back
+                DayStats::bump(state.stats.sent_to_kasa, clerk.role);
+                payments.push_back(ticket);
+                scale_windows();
+                dispatch_payments();
+            }
+            else {
+                DayStats::bump(state.stats.served, clerk.role);
+            }
+
+            if (!day_over) {
+                dispatch(clerk.role);
+            }
+        }
+
+        void dispatch_payments() {
+            for (size_t w = 0; w < windows.size() && !payments.empty(); ++w) {
+                Window& window = windows[w];
+                if (!window.open || window.busy) {
+                    continue;
+                }
+                window.ticket = payments.front();
+                payments.pop_front();
+                window.busy = true;
+                window.started = now;
+                schedule(now + work_duration(), EventKind::PaymentDone, w);
+            }
+        }
+
+        void finish_payment(Window& window) {
+            size_t slot = static_cast<size_t>(&window - windows.data());
+            // The clock stops at the day end, and so does the busy time it measures
+            uint32_t finished = std::min(now, close_time + kDayEndDelaySec);
+            window.busy = false;
+            state.stats.kasa_busy_sec[slot].fetch_add(finished - std::min(finished, window.started),
+                                                      std::memory_order_relaxed);
+            state.stats.kasa_payments[slot].fetch_add(1, std::memory_order_relaxed);
+            if (day_over) {
+                return; // released and reported at the day end
+            }
+
+            DayStats::bump(state.stats.served, window.ticket.department);
+            scale_windows();
+            dispatch_payments();
+        }
+
+        // The threshold (or configured) policy of the process simulation on the depth of the payment queue
+        void scale_windows() {
+            if (!open) {
+                return;
+            }
+            uint32_t requested = 0;
+            for (const auto& sent : state.stats.sent_to_kasa) {
+                requested += sent.load(std::memory_order_relaxed);
+            }
+            scaling::Inputs inputs{day,
+                                   now,
+                                   static_cast<uint32_t>(payments.size()),
+                                   requested,
+                                   static_cast<uint32_t>(config.kasa_scaling.max_machines *
+                                                         scaling::kKasaPaymentsPerWindow),
+                                   open_windows};
+            std::string reason;
+            int target = kasa_policy->desired(inputs, reason);
+            if (target != open_windows) {
+                Logger::log<LogSeverity::Notice>(Identity::Dyrektor, [&] {
+                    return "Kasy: " + std::to_string(open_windows) + " -> " + std::to_string(target) + " (" +
+                           reason + ").";
+                });
+                set_windows(target);
+            }
+        }
+
+        // Opens the lowest closed windows or closes the highest open ones; a closed window finishes its payment
+        void set_windows(int target) {
+            for (size_t w = 0; w < windows.size() && open_windows < target; ++w) {
+                if (!windows[w].open) {
+                    windows[w].open = true;
+                    open_windows++;
+                }
+            }
+            for (size_t w = windows.size(); w-- > 0 && open_windows > target;) {
+                if (windows[w].open) {
+                    windows[w].open = false;
+                    open_windows--;
+                }
+            }
+            DayStats::raise_peak(state.stats.peak_kasa_windows, static_cast<uint32_t>(open_windows));
+        }
+
+        // What the workers and dyrektor do at the day end: tickets still queued go to the report as unserved, and so
+        // do petents waiting for or at the kasa; waiting payments are dropped
+        void end_day() {
+            day_over = true;
+            for (size_t idx = 0; idx < kDepartmentCount; ++idx) {
+                for (std::deque<Ticket>* queue : {&vip_queues[idx], &queues[idx]}) {
+                    for (const Ticket& ticket : *queue) {
+                        writer->unserved_after_signal(ticket.petent_id, ticket.department,
+                                                      ticket.redirected_from_sa ? "SA" : "REJESTRACJA");
+                        DayStats::bump(state.stats.unserved, ticket.department);
+                    }
+                    queue->clear();
+                }
+            }
+            auto release = [this](const Ticket& ticket) {
+                writer->unserved_after_close(ticket.petent_id, ticket.department, ticket.ticket_number);
+                DayStats::bump(state.stats.unserved, ticket.department);
+            };
+            for (const Ticket& ticket : payments) {
+                release(ticket);
+            }
+            for (const Window& window : windows) {
+                if (window.busy) {
+                    release(window.ticket);
+                }
+            }
+            payments.clear();
+        }
+
+        const Config& config;
+        SharedState& state;
+        std::mt19937_64 random;
+        std::unique_ptr<scaling::Policy> kasa_policy;
+
+        std::priority_queue<Event, std::vector<Event>, Later> pending;
+        uint64_t next_seq = 0;
+        uint64_t processed = 0;
+
+        std::vector<Clerk> clerks;
+        std::array<std::deque<Ticket>, kDepartmentCount> vip_queues;
+        std::array<std::deque<Ticket>, kDepartmentCount> queues;
+        std::deque<Ticket> payments;
+        std::array<Window, kMaxKasaWindows> windows{};
+        int open_windows = 0;
+
+        report::Writer* writer = nullptr;
+        uint32_t day = 0;
+        uint32_t now = 0;
+        uint32_t close_time = 0;
+        bool open = false;
+        bool day_over = false;
+        int generated = 0;
+        uint32_t next_petent_id = 1;
+    };
+
+    int run(const Config& config) {
+        // Private memory: nothing else attaches, the struct only supplies the counters and the summary snapshot
+        auto state = std::make_unique<SharedState>(
+            static_cast<uint32_t>(config.building_capacity),
+            department_ticket_limits(config.department_limits, config.clerk_counts), 1);
+        state->config.hours_open = config.hours_open;
+        state->config.department_limits = config.department_limits;
+
+        Logger::log(LogSeverity::Notice, Identity::Dyrektor,
+                    "Symulacja zdarzeniowa: dni " + std::to_string(config.days) + ", ziarno " +
+                    std::to_string(config.seed) + ".");
+
+        auto started = std::chrono::steady_clock::now();
+        Engine engine(config, *state);
+        int rc = 0;
+        for (int day = 0; day < config.days; ++day) {
+            if (engine.run_day(static_cast<uint32_t>(day)) == -1) {
+                Logger::log(LogSeverity::Err, Identity::Dyrektor, "Nie udalo sie zapisac podsumowania dnia.");
+                rc = -1;
+            }
+            else {
+                Logger::log(LogSeverity::Notice, Identity::Dyrektor,
+                            "Zapisano podsumowanie dnia " + std::to_string(day + 1) + ".");
+            }
+        }
+        auto elapsed_ms =
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+
+        Logger::log(LogSeverity::Notice, Identity::Dyrektor,
+                    "Symulacja zdarzeniowa zakonczona: dni " + std::to_string(config.days) + ", zdarzen " +
+                    std::to_string(engine.events()) + ", czas " + std::to_string(elapsed_ms) + " ms.");
+        return rc;
+    }
+
+} // namespace des
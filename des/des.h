@@ -0,0 +1,38 @@
+#ifndef SO_PROJEKT_DES_H
+#define SO_PROJEKT_DES_H
+
+#include <array>
+#include <cstdint>
+#include "../common.h"
+#include "../dyrektor/scaling.h"
+
+// Discrete-event mode: the whole office in one process on virtual time. A priority queue of timestamped events
+// (arrivals, service and payment completions, day end) drives the rules of the process simulation - departments
+// with VIP-first queues, per-clerk ticket limits, SA redirects, the kasa round trip and its windows - without
+// sleeping, so months of days take seconds. Days are written out as the same summaries and unserved-petent reports.
+// Wall-clock measurements (petent startup latencies) stay 0, ticket machines issue instantly and clerks keep their
+// starting staff; kasa windows are scaled by the same policy as in the process simulation. A petent holds a place in
+// the ticket hall only until the ticket is issued, so with instant issuing the building capacity N never makes anyone
+// wait, and petents with children are not modelled.
+namespace des {
+
+    struct Config {
+        HoursOpen hours_open;
+        std::array<uint32_t, 5> department_limits; // X1..X5, per clerk
+        ClerkCounts clerk_counts;
+        int gen_min_delay_sec;
+        int gen_max_delay_sec;
+        int gen_max_count; // over the whole run; -1 for no limit
+        int building_capacity;
+        int ticket_machines;
+        scaling::PolicyConfig kasa_scaling;
+        int days;
+        uint64_t seed;
+    };
+
+    // Returns 0 when every day was simulated and its summary written
+    int run(const Config& config);
+
+} // namespace des
+
+#endif // SO_PROJEKT_DES_H
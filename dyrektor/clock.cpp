@@ -5,6 +5,8 @@
 #include "../common.h"
 #include "../ipcutils.h"
 #include "../logger.h"
+#include "../placement.h"
+#include "supervisor.h"
 
 std::atomic<bool> simulation_running(true);
 static pthread_mutex_t restart_mutex;
@@ -16,9 +18,10 @@ static bool restart_cond_initialized = false;
 struct ClockArgsHelper {
     SharedState* state;
     HoursOpen hours_open;
+    int notify_fd;
 };
 
-void init_clock(SharedState* state, HoursOpen hours_open) {
+void init_clock(SharedState* state, HoursOpen hours_open, int notify_fd) {
     while (simulation_running) {
         if (ipc::mutex::lock(&restart_mutex) == -1) {
             Logger::log(LogSeverity::Err, Identity::Dyrektor, "Blad blokady mutexu restartu dnia.");
@@ -39,15 +42,19 @@ void init_clock(SharedState* state, HoursOpen hours_open) {
             break;
         }
 
-        state->simulated_time = hours_open.first * 3600;
-        state->office_status = OfficeStatus::Open;
+        // Only this thread writes the clock fields, so it keeps them locally and publishes each change
+        uint32_t day = state->day.load(std::memory_order_relaxed);
+        auto time = static_cast<uint32_t>(hours_open.first * 3600);
+        auto close_time = static_cast<uint32_t>(hours_open.second * 3600);
+        OfficeStatus status = OfficeStatus::Open;
+        state->publish_clock(day, status, time);
+        state->office_open.set();
+        supervisor::notify_clock_change(notify_fd);
 
-        std::string message = "Dzien " + std::to_string(state->day + 1) + ": Urzad otwarty.";
+        std::string message = "Dzien " + std::to_string(day + 1) + ": Urzad otwarty.";
         Logger::log(LogSeverity::Info, Identity::Dyrektor, message);
 
-        bool wait_after_close = false;
-
-        while (state->simulated_time < hours_open.second * 3600 + 120) {
+        while (time < close_time + 120) {
             if (!simulation_running.load()) {
                 break;
             }
@@ -62,12 +69,17 @@ void init_clock(SharedState* state, HoursOpen hours_open) {
             }
             std::this_thread::sleep_for(std::chrono::microseconds(sleep_us));
 
-            state->simulated_time++;
+            time++;
 
-            if (state->simulated_time >= hours_open.second * 3600 && !wait_after_close) {
-                state->office_status = OfficeStatus::Closed;
+            bool closing = time >= close_time && status == OfficeStatus::Open;
+            if (closing) {
+                status = OfficeStatus::Closed;
+            }
+            state->publish_clock(day, status, time);
+            if (closing) {
+                state->office_open.reset();
+                supervisor::notify_clock_change(notify_fd);
                 Logger::log(LogSeverity::Info, Identity::Dyrektor, "Urzad zamkniety.");
-                wait_after_close = true;
             }
         }
 
@@ -75,25 +87,31 @@ void init_clock(SharedState* state, HoursOpen hours_open) {
             Logger::log(LogSeverity::Err, Identity::Dyrektor, "Blad blokady mutexu restartu dnia.");
             break;
         }
-        state->day++;
+        state->publish_clock(day + 1, status, time);
         restart_pending = true;
         if (ipc::mutex::unlock(&restart_mutex) == -1) {
             Logger::log(LogSeverity::Err, Identity::Dyrektor, "Blad odblokowania mutexu restartu dnia.");
             break;
         }
         ipc::cond::broadcast(&restart_cv);
+        supervisor::notify_clock_change(notify_fd);
         Logger::log(LogSeverity::Info, Identity::Dyrektor, "Koniec dnia.");
     }
 }
 
 static void* clock_thread_main(void* arg) {
     auto* args = static_cast<ClockArgsHelper*>(arg);
-    init_clock(args->state, args->hours_open);
+    // Late ticks are simulated-time drift; dyrektor's CPU set is inherited, the real-time class was checked beforehand
+    const PlacementConfig& placement_config = args->state->config.placement;
+    if (placement::set_realtime(placement_config.realtime, placement_config.realtime_priority) == -1) {
+        Logger::log(LogSeverity::Warning, Identity::Dyrektor, "Zegar nie mogl przejsc na klase czasu rzeczywistego.");
+    }
+    init_clock(args->state, args->hours_open, args->notify_fd);
     delete args;
     return nullptr;
 }
 
-int start_clock(SharedState* shared_state, HoursOpen hours_open, pthread_t* out_thread) {
+int start_clock(SharedState* shared_state, HoursOpen hours_open, int notify_fd, pthread_t* out_thread) {
     if (!out_thread) {
         Logger::log(LogSeverity::Err, Identity::Dyrektor, "Niepoprawny wskaznik watku zegara.");
         return -1;
@@ -115,7 +133,7 @@ int start_clock(SharedState* shared_state, HoursOpen hours_open, pthread_t* out_
         restart_cond_initialized = true;
     }
 
-    auto* args = new ClockArgsHelper{shared_state, hours_open};
+    auto* args = new ClockArgsHelper{shared_state, hours_open, notify_fd};
 
     int create_err = ipc::thread::create(out_thread, clock_thread_main, args);
     if (create_err != 0) {
@@ -7,8 +7,9 @@
 
 extern std::atomic<bool> simulation_running;
 
-void init_clock(SharedState* state, HoursOpen hours_open);
-int start_clock(SharedState* shared_state, HoursOpen hours_open, pthread_t* out_thread);
+// notify_fd (an eventfd, or -1) is written on every opening, closing and day end, see supervisor::EventLoop
+void init_clock(SharedState* state, HoursOpen hours_open, int notify_fd);
+int start_clock(SharedState* shared_state, HoursOpen hours_open, int notify_fd, pthread_t* out_thread);
 
 int stop_clock(pthread_t thread);
 void notify_day_restart_complete();
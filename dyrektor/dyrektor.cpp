@@ -1,35 +1,55 @@
 #include "dyrektor.h"
+#include <algorithm>
+#include <array>
 #include <cerrno>
-#include <chrono>
 #include <csignal>
 #include <cstring>
 #include <fcntl.h>
+#include <memory>
 #include <pthread.h>
 #include <signal.h>
-#include <sys/msg.h>
 #include <sys/wait.h>
-#include <thread>
 #include <unistd.h>
 #include <vector>
 #include "../common.h"
 #include "../ipcutils.h"
 #include "../logger.h"
+#include "../placement.h"
 #include "../report.h"
 #include "clock.h"
+#include "log_flusher.h"
 #include "process.h"
+#include "sampler.h"
+#include "scaling.h"
+#include "staffing.h"
+#include "supervisor.h"
 
 static void handle_shutdown_signal(int) { simulation_running = false; }
 
-// Drain all messages from a SysV message queue
-static void drain_msg_queue(int msqid) {
-    struct { long mtype; char data[256]; } buf;
-    while (msgrcv(msqid, &buf, sizeof(buf.data), 0, IPC_NOWAIT | MSG_NOERROR) != -1) {
-        // keep draining
+// Autoscaling period while the office is open; the timer is disarmed outside opening hours. Scaling is sampled rather
+// than driven by queue events: the policies work on arrival rates and dwell times over simulated time, and the queues
+// are fed by petents dyrektor does not hear from. Worker exits trigger an extra pass at once.
+constexpr uint32_t kScaleTickMs = 200;
+
+// Reply shards are created and removed together, so they are tracked here instead of in cleanup()'s arguments
+static std::array<int, kReplyShardCount> reply_msg_ids = [] {
+    std::array<int, kReplyShardCount> ids{};
+    ids.fill(-1);
+    return ids;
+}();
+
+static void drain_reply_queues() {
+    for (int msg_id : reply_msg_ids) {
+        if (msg_id != -1) {
+            ipc::msg::drain(msg_id);
+        }
     }
 }
 
 void cleanup(SharedState* shared_state, int shm_id, int msg_req_id, int msg_sa_id, int msg_sc_id, int msg_km_id,
-             int msg_ml_id, int msg_pd_id, int msg_kasa_id, int sem_id, int lock_file) {
+             int msg_ml_id, int msg_pd_id, int msg_kasa_id, int lock_file) {
+    sampler::stop();
+    stop_log_flusher();
     ipc::shm::detach(shared_state);
     ipc::shm::remove(shm_id);
     if (msg_req_id != -1) {
@@ -53,65 +73,343 @@ void cleanup(SharedState* shared_state, int shm_id, int msg_req_id, int msg_sa_i
     if (msg_kasa_id != -1) {
         ipc::msg::remove(msg_kasa_id);
     }
-    if (sem_id != -1) {
-        ipc::sem::remove(sem_id);
+    for (int& msg_id : reply_msg_ids) {
+        if (msg_id != -1) {
+            ipc::msg::remove(msg_id);
+            msg_id = -1;
+        }
     }
     close(lock_file);
     unlink(ipc::IPC_LOCK_FILE);
 }
 
-static short desired_ticket_machines(const SharedState* shared_state) {
-    if (!shared_state) {
-        return 1;
+// The configured CPU sets restricted to the CPUs dyrektor may use (taskset, cgroup cpuset), and the real-time class
+// dropped when it is not permitted. Children inherit the parent's set, so below a pinned parent a role without a set
+// of its own gets all allowed CPUs back.
+static PlacementConfig fit_placement(PlacementConfig config) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1) {
+        perror("sched_getaffinity failed");
+        Logger::log(LogSeverity::Warning, Identity::Dyrektor, "Nie mozna odczytac dostepnych procesorow; "
+                                                              "role nie beda przypiete.");
+        CPU_ZERO(&allowed);
+    }
+
+    std::vector<std::pair<std::string, cpu_set_t*>> roles = {{"dyrektor", &config.dyrektor},
+                                                             {"rejestracja", &config.rejestracja},
+                                                             {"kasa", &config.kasa},
+                                                             {"generator", &config.generator},
+                                                             {"petent", &config.petent}};
+    for (size_t idx = 0; idx < kDepartmentCount; ++idx) {
+        roles.emplace_back(urzednik_role_to_string(static_cast<UrzednikRole>(idx)).value_or("?"),
+                           &config.urzednik[idx]);
+    }
+    for (auto& [name, cpus] : roles) {
+        if (!placement::fit_to_allowed(*cpus, allowed)) {
+            Logger::log(LogSeverity::Warning, Identity::Dyrektor,
+                        "Zestaw procesorow roli " + name + " nie zawiera dostepnych procesorow; rola nie bedzie "
+                        "przypieta.");
+        }
     }
+    auto unpin_below = [&allowed](const cpu_set_t& parent, std::initializer_list<cpu_set_t*> children) {
+        for (cpu_set_t* cpus : children) {
+            if (CPU_COUNT(&parent) > 0 && CPU_COUNT(cpus) == 0) {
+                *cpus = allowed;
+            }
+        }
+    };
+    unpin_below(config.dyrektor, {&config.rejestracja, &config.kasa, &config.generator, &config.urzednik[0],
+                                  &config.urzednik[1], &config.urzednik[2], &config.urzednik[3], &config.urzednik[4]});
+    unpin_below(config.generator, {&config.petent});
+
+    if (config.realtime != RealtimePolicy::None &&
+        !placement::realtime_permitted(config.realtime, config.realtime_priority)) {
+        Logger::log(LogSeverity::Warning, Identity::Dyrektor,
+                    "Brak uprawnien do klasy " + std::string(realtime_policy_to_string(config.realtime)) +
+                        " (" + std::strerror(errno) + "); zegar i biletomaty zostaja przy SCHED_OTHER.");
+        config.realtime = RealtimePolicy::None;
+    }
+    return config;
+}
 
-    unsigned int capacity = shared_state->building_capacity;
-    unsigned int k = capacity / 3u;
-    if (k == 0) {
-        k = 1;
+// Drops a worker that exited mid-day from dyrektor's lists. Ticket machines and kasa windows below the policy minimum
+// are started again by the scaling pass that follows; clerks come back with the next day, as after SIGUSR1.
+static void forget_worker(pid_t pid, std::vector<pid_t>& rejestracja_pids,
+                          std::vector<process::UrzednikProcess>& urzednik_pids,
+                          std::vector<process::KasaWindow>& kasa_windows) {
+    auto kasa = std::find_if(kasa_windows.begin(), kasa_windows.end(),
+                             [pid](const process::KasaWindow& window) { return window.pid == pid; });
+    if (std::find(rejestracja_pids.begin(), rejestracja_pids.end(), pid) != rejestracja_pids.end()) {
+        Logger::log(LogSeverity::Warning, Identity::Dyrektor,
+                    "Biletomat " + std::to_string(pid) + " zakonczyl dzialanie przed koncem dnia.");
+        process::forget_exited(rejestracja_pids);
+    }
+    else if (kasa != kasa_windows.end()) {
+        Logger::log(LogSeverity::Warning, Identity::Dyrektor,
+                    "Okienko kasy " + std::to_string(kasa->window) + " zakonczylo dzialanie przed koncem dnia.");
+        process::forget_exited(kasa_windows);
+    }
+    else {
+        process::forget_exited(urzednik_pids);
     }
+}
 
-    unsigned int queue_len = shared_state->current_queue_length;
-    if (queue_len > 2 * k) {
-        return 3;
+// Moves the ticket machine count to what the policy wants. Machines scaled down finish their current batch and exit
+// on their own; dyrektor does not wait for them but keeps them in `retiring` until they are gone.
+static void scale_ticket_machines(SharedState* shared_state, scaling::Policy& policy,
+                                  std::vector<pid_t>& rejestracja_pids, std::vector<pid_t>& retiring) {
+    process::forget_exited(retiring);
+
+    StateSnapshot snapshot = shared_state->snapshot();
+    auto current = static_cast<int>(rejestracja_pids.size());
+    scaling::Inputs inputs{snapshot.day,
+                           snapshot.simulated_time,
+                           snapshot.current_queue_length,
+                           shared_state->queue_arrivals.load(std::memory_order_relaxed),
+                           shared_state->building_capacity,
+                           current};
+    std::string reason;
+    int target = policy.desired(inputs, reason);
+    if (target != current) {
+        Logger::log(LogSeverity::Notice, Identity::Dyrektor,
+                    "Biletomaty: " + std::to_string(current) + " -> " + std::to_string(target) + " (" + reason + ").");
+    }
+
+    while (current < target) {
+        pid_t pid = process::spawn_rejestracja();
+        if (pid == -1) {
+            break;
+        }
+        rejestracja_pids.push_back(pid);
+        current++;
     }
-    if (queue_len > k) {
-        return 2;
+
+    while (current > target) {
+        pid_t pid = rejestracja_pids.back();
+        rejestracja_pids.pop_back();
+        if (kill(pid, SIGUSR1) == -1) {
+            perror("kill failed");
+        }
+        retiring.push_back(pid);
+        current--;
     }
-    return 1;
+
+    shared_state->ticket_machines_num.store(static_cast<uint8_t>(current), std::memory_order_relaxed);
+    DayStats::raise_peak(shared_state->stats.peak_ticket_machines, static_cast<uint32_t>(current));
 }
 
-static void drain_unserved_tickets(const std::vector<process::UrzednikQueue>& queues, uint32_t report_day) {
+// The same policy machinery for the kasa windows, on the depth of the shared payment queue. A window closed by it
+// finishes the payment in hand and exits; it is kept in `retiring` until it is gone.
+static void scale_kasa_windows(SharedState* shared_state, scaling::Policy& policy, int msg_kasa_id, int max_windows,
+                               std::vector<process::KasaWindow>& kasa_windows,
+                               std::vector<process::KasaWindow>& retiring) {
+    process::forget_exited(retiring);
+
+    ipc::msg::QueueStat queue_stat{};
+    auto depth = ipc::msg::stat(msg_kasa_id, &queue_stat) == 0 ? static_cast<uint32_t>(queue_stat.messages) : 0;
+    uint32_t payments = 0;
+    for (const auto& sent : shared_state->stats.sent_to_kasa) {
+        payments += sent.load(std::memory_order_relaxed);
+    }
+    StateSnapshot snapshot = shared_state->snapshot();
+    auto current = static_cast<int>(kasa_windows.size());
+    scaling::Inputs inputs{snapshot.day,
+                           snapshot.simulated_time,
+                           depth,
+                           payments,
+                           static_cast<uint32_t>(max_windows * scaling::kKasaPaymentsPerWindow),
+                           current};
+    std::string reason;
+    int target = policy.desired(inputs, reason);
+    if (target != current) {
+        Logger::log(LogSeverity::Notice, Identity::Dyrektor,
+                    "Kasy: " + std::to_string(current) + " -> " + std::to_string(target) + " (" + reason + ").");
+    }
+
+    while (current < target && process::open_kasa_window(kasa_windows, retiring)) {
+        current++;
+    }
+
+    while (current > target) {
+        // The highest window closes first, so the open ones keep the lowest numbers
+        auto last = std::max_element(kasa_windows.begin(), kasa_windows.end(),
+                                     [](const process::KasaWindow& a, const process::KasaWindow& b) {
+                                         return a.window < b.window;
+                                     });
+        if (kill(last->pid, SIGUSR1) == -1) {
+            perror("kill failed");
+        }
+        retiring.push_back(*last);
+        kasa_windows.erase(last);
+        current--;
+    }
+
+    DayStats::raise_peak(shared_state->stats.peak_kasa_windows, static_cast<uint32_t>(current));
+}
+
+constexpr size_t kDrainBatch = 64;
+
+static void drain_unserved_tickets(const std::vector<process::UrzednikQueue>& queues, uint32_t report_day,
+                                   DayStats& stats) {
+    report::Writer report_writer(report_day);
+    TicketIssuedMsg tickets[kDrainBatch];
     for (const auto& queue : queues) {
         while (true) {
-            TicketIssuedMsg ticket{};
-            int rc = ipc::msg::receive<TicketIssuedMsg>(queue.msg_id, -kNormalQueueType, &ticket, IPC_NOWAIT);
-            if (rc == -1) {
-                if (errno == ENOMSG) {
-                    break;
-                }
+            int received = ipc::msg::receive_batch<TicketIssuedMsg>(queue.msg_id, -kNormalQueueType, tickets,
+                                                                    kDrainBatch, IPC_NOWAIT);
+            if (received == -1) {
                 break;
             }
 
-            if (ticket.petent_id == 0) {
-                continue;
+            for (int i = 0; i < received; ++i) {
+                const TicketIssuedMsg& ticket = tickets[i];
+                if (ticket.petent_id == 0) {
+                    continue;
+                }
+                report_writer.unserved_after_close(ticket.petent_id, ticket.department, ticket.ticket_number);
+                DayStats::bump(stats.unserved, ticket.department);
             }
+        }
+    }
+    report_writer.flush();
+}
 
-            report::log_unserved_after_close(report_day, ticket.petent_id, ticket.department, ticket.ticket_number);
+// Petents still away at the kasa when the day ends (or back in a department queue without a clerk having taken them)
+// are told to go home and reported unserved. Runs once every clerk and window has acknowledged the day end, so
+// nobody resumes or confirms them meanwhile; the reply shards are drained just before.
+static void release_parked(SharedState* shared_state, uint32_t report_day) {
+    report::Writer report_writer(report_day);
+    for (size_t idx = 0; idx < kDepartmentCount; ++idx) {
+        auto dept = static_cast<UrzednikRole>(idx);
+        for (ParkedPetent& slot : shared_state->parked[idx]) {
+            uint32_t petent_id = slot.petent_id.exchange(0, std::memory_order_acq_rel);
+            if (petent_id == 0) {
+                continue;
+            }
+            ServiceDoneMsg released{};
+            released.petent_id = petent_id;
+            released.department = dept;
+            released.action = ServiceAction::Released;
+            int shard_id = reply_msg_ids[ipc::helper::reply_shard(petent_id)];
+            if (shard_id != -1) {
+                ipc::msg::send<ServiceDoneMsg>(shard_id, static_cast<long>(petent_id), released, IPC_NOWAIT);
+            }
+            report_writer.unserved_after_close(petent_id, dept, slot.ticket_number);
+            DayStats::bump(shared_state->stats.unserved, dept);
         }
     }
+    report_writer.flush();
 }
 
+using process::KasaWindow;
 using process::UrzednikProcess;
 using process::UrzednikQueue;
 
+constexpr uint64_t kDayEndRingMs = 100; // a worker that has not answered is rung again this often
+constexpr int kDayEndTimeoutRings = 50; // 5 s without progress; a worker stuck for longer is left behind
+
+// Reaps every exited child; workers are matched up through their pidfds, not here
+static void reap_children() {
+    int status = 0;
+    while (waitpid(-1, &status, WNOHANG) > 0) {
+    }
+}
+
+// Ends the day of every live worker in place: bumps the epoch, rings them and waits in dyrektor's event loop until
+// each has done its day-end work and gone to sleep on day_start (an ack on the loop's eventfd), and until the retiring
+// machines and windows, which do not take part in the count, have exited (their pidfds). Workers that exit meanwhile
+// are dropped from the lists; a shutdown signal read meanwhile stops the simulation as in the main loop.
+static void end_worker_day(SharedState* shared_state, supervisor::EventLoop& supervisor,
+                           std::vector<pid_t>& rejestracja_pids, std::vector<UrzednikProcess>& urzednik_pids,
+                           std::vector<KasaWindow>& kasa_windows, std::vector<pid_t>& retiring_rejestracja,
+                           std::vector<KasaWindow>& retiring_kasy) {
+    auto forget_all_exited = [&] {
+        process::forget_exited(rejestracja_pids);
+        process::forget_exited(urzednik_pids);
+        process::forget_exited(kasa_windows);
+        process::forget_exited(retiring_rejestracja);
+        process::forget_exited(retiring_kasy);
+    };
+    for (pid_t pid : retiring_rejestracja) {
+        supervisor.watch(pid);
+    }
+    for (const auto& kasa : retiring_kasy) {
+        supervisor.watch(kasa.pid);
+    }
+    forget_all_exited();
+
+    shared_state->day_start.reset();
+    shared_state->day_end_acks.store(0, std::memory_order_relaxed);
+    shared_state->worker_epoch.fetch_add(1, std::memory_order_acq_rel);
+    process::ring_day_end(rejestracja_pids, urzednik_pids, kasa_windows);
+    process::signal_kasa_all(retiring_kasy);
+
+    int rings = 0;
+    uint64_t progress_ns = ipc::monotonic_ns();
+    std::vector<supervisor::Event> events;
+    while (rings < kDayEndTimeoutRings) {
+        size_t workers = rejestracja_pids.size() + urzednik_pids.size() + kasa_windows.size();
+        if (shared_state->day_end_acks.load(std::memory_order_acquire) >= workers && retiring_rejestracja.empty() &&
+            retiring_kasy.empty()) {
+            return;
+        }
+        // A ring that lands just before a worker enters its blocking call is lost, so it is repeated when neither an
+        // ack nor an exit came within kDayEndRingMs; workers still busy draining their queues are not interrupted
+        uint64_t now_ns = ipc::monotonic_ns();
+        if (now_ns - progress_ns >= kDayEndRingMs * 1'000'000ULL) {
+            process::ring_day_end(rejestracja_pids, urzednik_pids, kasa_windows);
+            progress_ns = now_ns;
+            rings++;
+            continue;
+        }
+        auto timeout_ms = static_cast<int>(kDayEndRingMs - (now_ns - progress_ns) / 1'000'000ULL);
+        if (supervisor.wait(events, timeout_ms) == -1) {
+            break;
+        }
+        for (const auto& event : events) {
+            if (event.kind == supervisor::Wake::ChildExit ||
+                (event.kind == supervisor::Wake::Signal && event.signal == SIGCHLD)) {
+                reap_children();
+                forget_all_exited();
+                progress_ns = ipc::monotonic_ns();
+            }
+            else if (event.kind == supervisor::Wake::DayEndAck) {
+                progress_ns = ipc::monotonic_ns();
+            }
+            else if (event.kind == supervisor::Wake::Signal) {
+                simulation_running = false;
+            }
+            // Clock changes and ticks are picked up by the main loop afterwards
+        }
+    }
+    Logger::log(LogSeverity::Warning, Identity::Dyrektor, "Nie wszyscy pracownicy zakonczyli dzien na czas.");
+}
+
 int dyrektor_main(HoursOpen hours_open, const std::array<uint32_t, 5>& department_limits, int time_mul,
                   int gen_min_delay_sec, int gen_max_delay_sec, int gen_max_count, bool spawn_generator, bool one_day,
-                  int building_capacity) {
+                  int building_capacity, const LogOptions& log_options, MsgTransport transport,
+                  int sample_interval_sec, PetentHost petent_host, int petent_threads, const ClerkCounts& clerk_counts,
+                  const ClerkCounts& clerk_max, const scaling::PolicyConfig& ticket_scaling,
+                  const scaling::PolicyConfig& kasa_scaling, const PlacementConfig& placement_config) {
     ipc::install_signal_handler(SIGINT, handle_shutdown_signal);
     ipc::install_signal_handler(SIGTERM, handle_shutdown_signal);
     ipc::install_signal_handler(SIGUSR2, handle_shutdown_signal);
 
+    // Also before any thread starts: the clock, log flusher and sampler threads run on dyrektor's CPU set
+    PlacementConfig placement = fit_placement(placement_config);
+    if (placement::pin_self(placement.dyrektor) == -1) {
+        Logger::log(LogSeverity::Warning, Identity::Dyrektor,
+                    "Nie udalo sie przypiac dyrektora do procesorow: " + std::string(std::strerror(errno)));
+    }
+    process::set_placement(placement);
+
+    // Before any thread starts, so that all of them keep these signals blocked and they reach the main loop only
+    supervisor::EventLoop supervisor;
+    if (supervisor.open({SIGINT, SIGTERM, SIGUSR2, SIGCHLD}) == -1) {
+        Logger::log(LogSeverity::Emerg, Identity::Dyrektor, "Nie udalo sie przygotowac petli zdarzen dyrektora.");
+        return 1;
+    }
+
     process::group::init_self();
 
     int lock_file = open(ipc::IPC_LOCK_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
@@ -122,47 +420,53 @@ int dyrektor_main(HoursOpen hours_open, const std::array<uint32_t, 5>& departmen
         return 1;
     }
 
+    if (start_log_flusher(log_options) == -1) {
+        Logger::log(LogSeverity::Emerg, Identity::Dyrektor, "Nie udalo sie utworzyc wspoldzielonego bufora logow.");
+        stop_log_flusher();
+        close(lock_file);
+        return 1;
+    }
+
     Logger::log(LogSeverity::Info, Identity::Dyrektor, "Dyrektor uruchomiony pomyslnie.");
 
     key_t shm_key = ipc::make_key(ipc::KeyType::SharedState);
     if (shm_key == -1) {
+        stop_log_flusher();
         close(lock_file);
         return 1;
     }
 
     int shm_id = ipc::helper::create_or_reset_shm(shm_key);
     if (shm_id == -1) {
+        stop_log_flusher();
         close(lock_file);
         return 1;
     }
 
     auto shared_state = ipc::shm::attach<SharedState>(shm_id, false);
     if (!shared_state) {
+        stop_log_flusher();
         close(lock_file);
         ipc::shm::remove(shm_id);
         return 1;
     }
 
-    std::array<uint32_t, 5> ticket_limits = {
-        department_limits[1],
-        department_limits[2],
-        department_limits[3],
-        department_limits[4],
-        department_limits[0] * 2u
-    };
-
-    new (shared_state) SharedState(static_cast<uint32_t>(building_capacity), ticket_limits,
+    new (shared_state) SharedState(static_cast<uint32_t>(building_capacity),
+                                   department_ticket_limits(department_limits, clerk_counts),
                                    static_cast<uint32_t>(time_mul));
+    process::set_day_end_ack_fd(supervisor.ack_fd());
+    shared_state->msg_transport = transport;
+    ipc::msg::set_transport(transport);
 
     key_t msg_req_key = ipc::make_key(ipc::KeyType::MsgQueueRejestracja);
     if (msg_req_key == -1) {
-        cleanup(shared_state, shm_id, -1, -1, -1, -1, -1, -1, -1, -1, lock_file);
+        cleanup(shared_state, shm_id, -1, -1, -1, -1, -1, -1, -1, lock_file);
         return 1;
     }
 
     int msg_req_id = ipc::helper::create_or_reset_msg(msg_req_key);
     if (msg_req_id == -1) {
-        cleanup(shared_state, shm_id, -1, -1, -1, -1, -1, -1, -1, -1, lock_file);
+        cleanup(shared_state, shm_id, -1, -1, -1, -1, -1, -1, -1, lock_file);
         return 1;
     }
 
@@ -172,7 +476,7 @@ int dyrektor_main(HoursOpen hours_open, const std::array<uint32_t, 5>& departmen
     key_t msg_ml_key = ipc::make_key(ipc::KeyType::MsgQueueML);
     key_t msg_pd_key = ipc::make_key(ipc::KeyType::MsgQueuePD);
     if (msg_sa_key == -1 || msg_sc_key == -1 || msg_km_key == -1 || msg_ml_key == -1 || msg_pd_key == -1) {
-        cleanup(shared_state, shm_id, msg_req_id, -1, -1, -1, -1, -1, -1, -1, lock_file);
+        cleanup(shared_state, shm_id, msg_req_id, -1, -1, -1, -1, -1, -1, lock_file);
         return 1;
     }
 
@@ -182,97 +486,117 @@ int dyrektor_main(HoursOpen hours_open, const std::array<uint32_t, 5>& departmen
     int msg_ml_id = ipc::helper::create_or_reset_msg(msg_ml_key);
     int msg_pd_id = ipc::helper::create_or_reset_msg(msg_pd_key);
     if (msg_sa_id == -1 || msg_sc_id == -1 || msg_km_id == -1 || msg_ml_id == -1 || msg_pd_id == -1) {
-        cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, -1, -1, lock_file);
+        cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, -1, lock_file);
         return 1;
     }
 
     key_t msg_kasa_key = ipc::make_key(ipc::KeyType::MsgQueueKasa);
     if (msg_kasa_key == -1) {
-        cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, -1, -1, lock_file);
+        cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, -1, lock_file);
         return 1;
     }
     int msg_kasa_id = ipc::helper::create_or_reset_msg(msg_kasa_key);
     if (msg_kasa_id == -1) {
-        cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, -1, -1, lock_file);
+        cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, -1, lock_file);
         return 1;
     }
 
-    const std::vector<UrzednikQueue> urzednik_queues = {
-        {msg_sa_id, UrzednikRole::SA, 2}, {msg_sc_id, UrzednikRole::SC, 1}, {msg_km_id, UrzednikRole::KM, 1},
-        {msg_ml_id, UrzednikRole::ML, 1}, {msg_pd_id, UrzednikRole::PD, 1},
-    };
-
-    key_t sem_key = ipc::make_key(ipc::KeyType::SemaphoreSet);
-    if (sem_key == -1) {
-        cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, msg_kasa_id, -1, lock_file);
-        return 1;
+    std::array<key_t, kReplyShardCount> reply_keys{};
+    for (size_t shard = 0; shard < kReplyShardCount; ++shard) {
+        reply_keys[shard] = ipc::make_reply_key(shard);
+        reply_msg_ids[shard] = reply_keys[shard] == -1 ? -1 : ipc::helper::create_or_reset_msg(reply_keys[shard]);
+        if (reply_msg_ids[shard] == -1) {
+            cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, msg_kasa_id,
+                    lock_file);
+            return 1;
+        }
     }
 
-    int sem_id = ipc::helper::create_or_reset_sem(sem_key, 2);
-    if (sem_id == -1) {
-        cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, msg_kasa_id, -1, lock_file);
-        return 1;
-    }
+    auto clerks_of = [&](UrzednikRole role) { return clerk_counts[static_cast<size_t>(role)]; };
+    std::vector<UrzednikQueue> urzednik_queues = {
+        {msg_sa_id, UrzednikRole::SA, clerks_of(UrzednikRole::SA)},
+        {msg_sc_id, UrzednikRole::SC, clerks_of(UrzednikRole::SC)},
+        {msg_km_id, UrzednikRole::KM, clerks_of(UrzednikRole::KM)},
+        {msg_ml_id, UrzednikRole::ML, clerks_of(UrzednikRole::ML)},
+        {msg_pd_id, UrzednikRole::PD, clerks_of(UrzednikRole::PD)},
+    };
+    staffing::Autoscaler clerk_autoscaler(clerk_counts, clerk_max);
 
-    unsigned short sem_vals[2];
     unsigned int capacity = shared_state->building_capacity;
-    unsigned short queue_slots = capacity > 1 ? (capacity - 1) : 1;
-    sem_vals[0] = queue_slots;
-    sem_vals[1] = 1;
-    if (ipc::sem::set_all(sem_id, sem_vals) == -1) {
-        cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, msg_kasa_id, sem_id,
-                lock_file);
-        return 1;
-    }
-
-    process::ProcessConfig process_config{hours_open, department_limits, time_mul, gen_min_delay_sec, gen_max_delay_sec,
-                                          gen_max_count, one_day, building_capacity};
+    unsigned int queue_slots = capacity > 1 ? (capacity - 1) : 1;
+
+    // Publish config and IPC ids before anything is spawned; children only get "--role" in argv
+    shared_state->config = {hours_open, department_limits, time_mul, gen_min_delay_sec, gen_max_delay_sec,
+                            gen_max_count, one_day, building_capacity, petent_host, petent_threads, placement};
+    shared_state->registry.rejestracja = ipc::helper::make_endpoint(msg_req_key, msg_req_id);
+    shared_state->registry.kasa = ipc::helper::make_endpoint(msg_kasa_key, msg_kasa_id);
+    MsgEndpoint* departments = shared_state->registry.departments;
+    departments[static_cast<size_t>(UrzednikRole::SA)] = ipc::helper::make_endpoint(msg_sa_key, msg_sa_id);
+    departments[static_cast<size_t>(UrzednikRole::SC)] = ipc::helper::make_endpoint(msg_sc_key, msg_sc_id);
+    departments[static_cast<size_t>(UrzednikRole::KM)] = ipc::helper::make_endpoint(msg_km_key, msg_km_id);
+    departments[static_cast<size_t>(UrzednikRole::ML)] = ipc::helper::make_endpoint(msg_ml_key, msg_ml_id);
+    departments[static_cast<size_t>(UrzednikRole::PD)] = ipc::helper::make_endpoint(msg_pd_key, msg_pd_id);
+    for (size_t shard = 0; shard < kReplyShardCount; ++shard) {
+        shared_state->registry.replies[shard] = ipc::helper::make_endpoint(reply_keys[shard], reply_msg_ids[shard]);
+    }
+    shared_state->registry.published = 1;
+    ipc::helper::publish_shm_id(ipc::helper::kStateShmEnv, shm_id);
 
     std::vector<UrzednikProcess> urzednik_pids;
     pid_t generator_pid = -1;
-    pid_t kasa_pid = -1;
+    std::vector<KasaWindow> kasa_windows;
+    std::vector<KasaWindow> retiring_kasy;
+    std::unique_ptr<scaling::Policy> kasa_policy = scaling::make_policy(kasa_scaling);
     if (spawn_generator) {
-        generator_pid = process::spawn_generator(process_config);
+        generator_pid = process::spawn_generator();
         if (generator_pid == -1) {
-            cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, msg_kasa_id, sem_id,
+            cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, msg_kasa_id,
                     lock_file);
             return 1;
         }
     }
-    kasa_pid = process::spawn_kasa(process_config);
-    if (kasa_pid == -1) {
+    // As with the ticket machines, only the first window is required; the scaling pass retries the rest
+    while (static_cast<int>(kasa_windows.size()) < kasa_scaling.min_machines &&
+           process::open_kasa_window(kasa_windows, retiring_kasy)) {
+    }
+    if (kasa_windows.empty()) {
         if (generator_pid != -1) {
             process::terminate_generator(generator_pid);
         }
-        cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, msg_kasa_id, sem_id,
+        cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, msg_kasa_id,
                 lock_file);
         return 1;
     }
-    if (!process::spawn_urzednicy(urzednik_pids, process_config)) {
+    if (!process::spawn_urzednicy(urzednik_pids, urzednik_queues)) {
         if (generator_pid != -1) {
             process::terminate_generator(generator_pid);
         }
-        process::terminate_kasa(kasa_pid);
-        cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, msg_kasa_id, sem_id,
+        process::terminate_kasa_all(kasa_windows);
+        cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, msg_kasa_id,
                 lock_file);
         return 1;
     }
     std::vector<pid_t> rejestracja_pids;
-    if (!process::spawn_rejestracja_group(rejestracja_pids, process_config)) {
+    std::vector<pid_t> retiring_rejestracja;
+    std::unique_ptr<scaling::Policy> ticket_policy = scaling::make_policy(ticket_scaling);
+    if (!process::spawn_rejestracja_group(rejestracja_pids, ticket_scaling.min_machines)) {
         process::send_urzednik_shutdowns(urzednik_queues);
         process::wait_urzednik_all(urzednik_pids);
         if (generator_pid != -1) {
             process::terminate_generator(generator_pid);
         }
-        process::terminate_kasa(kasa_pid);
-        cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, msg_kasa_id, sem_id,
+        process::terminate_kasa_all(kasa_windows);
+        cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, msg_kasa_id,
                 lock_file);
         return 1;
     }
-    shared_state->ticket_machines_num = 1;
+    auto machines = static_cast<uint8_t>(rejestracja_pids.size());
+    shared_state->ticket_machines_num.store(machines, std::memory_order_relaxed);
+    DayStats::raise_peak(shared_state->stats.peak_ticket_machines, machines);
+    DayStats::raise_peak(shared_state->stats.peak_kasa_windows, static_cast<uint32_t>(kasa_windows.size()));
 
     pthread_t clock_thread{};
-    if (start_clock(shared_state, hours_open, &clock_thread) != 0) {
+    if (start_clock(shared_state, hours_open, supervisor.clock_fd(), &clock_thread) != 0) {
         process::send_rejestracja_shutdown(msg_req_id, static_cast<int>(rejestracja_pids.size()));
         process::send_urzednik_shutdowns(urzednik_queues);
         process::wait_rejestracja_all(rejestracja_pids);
@@ -280,98 +604,177 @@ int dyrektor_main(HoursOpen hours_open, const std::array<uint32_t, 5>& departmen
         if (generator_pid != -1) {
             process::terminate_generator(generator_pid);
         }
-        process::terminate_kasa(kasa_pid);
-        cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, msg_kasa_id, sem_id,
+        process::terminate_kasa_all(kasa_windows);
+        cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, msg_kasa_id,
                 lock_file);
         return 1;
     }
 
-    uint32_t last_day = shared_state->day;
-
-    // Main dyrektor loop
-    while (simulation_running.load()) {
-        if (shared_state->day != last_day) {
-            uint32_t report_day = last_day + 1;
-            Logger::log(LogSeverity::Notice, Identity::Dyrektor, "Restart dzienny urzednikow, rejestracji i kasy.");
-
-            process::stop_daily_rejestracja(rejestracja_pids);
-
-            drain_msg_queue(msg_req_id);
+    std::vector<sampler::SampledQueue> sampled_queues = {{"rejestracja", msg_req_id}};
+    for (const auto& queue : urzednik_queues) {
+        sampled_queues.push_back({std::string(urzednik_role_to_string(queue.role).value_or("?")), queue.msg_id});
+    }
+    sampled_queues.push_back({"kasa", msg_kasa_id});
+    for (size_t shard = 0; shard < kReplyShardCount; ++shard) {
+        sampled_queues.push_back({"odp" + std::to_string(shard), reply_msg_ids[shard]});
+    }
+    if (sampler::start(shared_state, std::move(sampled_queues), static_cast<uint32_t>(sample_interval_sec)) ==
+        -1) {
+        Logger::log(LogSeverity::Warning, Identity::Dyrektor, "Nie udalo sie uruchomic probkowania kolejek.");
+    }
 
-            process::stop_daily_urzednik(urzednik_pids);
+    uint32_t last_day = shared_state->day.load(std::memory_order_acquire);
 
-            drain_unserved_tickets(urzednik_queues, report_day);
+    auto watch_workers = [&] {
+        for (pid_t pid : rejestracja_pids) {
+            supervisor.watch(pid);
+        }
+        for (pid_t pid : retiring_rejestracja) {
+            supervisor.watch(pid);
+        }
+        for (const auto& proc : urzednik_pids) {
+            supervisor.watch(proc.pid);
+        }
+        for (const auto& kasa : kasa_windows) {
+            supervisor.watch(kasa.pid);
+        }
+        for (const auto& kasa : retiring_kasy) {
+            supervisor.watch(kasa.pid);
+        }
+        supervisor.watch(generator_pid);
+    };
 
-            process::terminate_kasa(kasa_pid);
-            kasa_pid = -1;
-            drain_msg_queue(msg_kasa_id);
+    // Main dyrektor loop: sleeps in epoll_wait until a signal, a clock change, a scaling tick or a worker exit
+    std::vector<supervisor::Event> events;
+    bool evaluate_scaling = true;
+    while (simulation_running.load()) {
+        if (shared_state->day.load(std::memory_order_acquire) != last_day) {
+            uint32_t report_day = last_day + 1;
+            Logger::log(LogSeverity::Notice, Identity::Dyrektor, "Koniec dnia urzednikow, rejestracji i kasy.");
+            uint64_t rollover_start_ns = ipc::monotonic_ns();
+
+            end_worker_day(shared_state, supervisor, rejestracja_pids, urzednik_pids, kasa_windows,
+                           retiring_rejestracja, retiring_kasy);
+
+            // Workers sleep on day_start now, so the queues stay empty once drained
+            ipc::msg::drain(msg_req_id);
+            drain_reply_queues();
+            release_parked(shared_state, report_day);
+            drain_unserved_tickets(urzednik_queues, report_day, shared_state->stats);
+            // Returns from the kasa of petents that have left would otherwise wait for a clerk on the next day
+            for (const auto& queue : urzednik_queues) {
+                ipc::msg::drain(queue.msg_id);
+            }
+            ipc::msg::drain(msg_kasa_id);
 
             // Reset cap to avoid leaks
-            ipc::sem::set_val(sem_id, 0, static_cast<int>(queue_slots));
+            shared_state->admission.reset(queue_slots);
+
+            if (report::write_day_summary(report::snapshot_day(report_day, *shared_state)) == -1) {
+                Logger::log(LogSeverity::Err, Identity::Dyrektor, "Nie udalo sie zapisac podsumowania dnia.");
+            }
+            else {
+                Logger::log(LogSeverity::Notice, Identity::Dyrektor,
+                            "Zapisano podsumowanie dnia " + std::to_string(report_day) + ".");
+            }
 
-            shared_state->current_queue_length = 0;
+            shared_state->current_queue_length.store(0, std::memory_order_relaxed);
             for (auto& counter : shared_state->ticket_counters) {
-                counter = 0;
+                counter.value.store(0, std::memory_order_relaxed);
             }
+            shared_state->stats.reset();
 
             if (one_day) {
                 Logger::log(LogSeverity::Notice, Identity::Dyrektor, "Tryb testowy: konczenie po jednym dniu.");
                 simulation_running = false;
                 break;
             }
+            // end_worker_day read a shutdown signal; the day is not started again
+            if (!simulation_running.load()) {
+                break;
+            }
 
-            kasa_pid = process::spawn_kasa(process_config);
-            if (kasa_pid == -1) {
+            // Only workers that exited during the day (e.g. a clerk stopped with SIGUSR1) are started again
+            while (static_cast<int>(kasa_windows.size()) < kasa_scaling.min_machines &&
+                   process::open_kasa_window(kasa_windows, retiring_kasy)) {
+            }
+            if (kasa_windows.empty()) {
                 Logger::log(LogSeverity::Emerg, Identity::Dyrektor, "Nie udalo sie odtworzyc kasy po dniu.");
                 simulation_running = false;
                 break;
             }
-
-            if (!process::spawn_urzednicy(urzednik_pids, process_config)) {
+            if (!process::replenish_urzednicy(urzednik_pids, urzednik_queues)) {
                 Logger::log(LogSeverity::Emerg, Identity::Dyrektor, "Nie udalo sie odtworzyc urzednikow po dniu.");
                 simulation_running = false;
                 break;
             }
-            if (!process::spawn_rejestracja_group(rejestracja_pids, process_config)) {
+            if (rejestracja_pids.empty() &&
+                !process::spawn_rejestracja_group(rejestracja_pids, ticket_scaling.min_machines)) {
                 Logger::log(LogSeverity::Emerg, Identity::Dyrektor, "Nie udalo sie odtworzyc rejestracji po dniu.");
-                process::wait_urzednik_all(urzednik_pids);
                 simulation_running = false;
                 break;
             }
 
-            shared_state->ticket_machines_num = static_cast<uint8_t>(rejestracja_pids.size());
+            machines = static_cast<uint8_t>(rejestracja_pids.size());
+            shared_state->ticket_machines_num.store(machines, std::memory_order_relaxed);
+            DayStats::raise_peak(shared_state->stats.peak_ticket_machines, machines);
+            DayStats::raise_peak(shared_state->stats.peak_kasa_windows, static_cast<uint32_t>(kasa_windows.size()));
+            shared_state->day_start.set();
             notify_day_restart_complete();
-            last_day = shared_state->day;
+            Logger::log<LogSeverity::Debug>(Identity::Dyrektor, [&] {
+                return "Zmiana dnia trwala " + std::to_string((ipc::monotonic_ns() - rollover_start_ns) / 1000) +
+                       " us.";
+            });
+            last_day = shared_state->day.load(std::memory_order_acquire);
+            evaluate_scaling = true;
         }
 
-        short target = desired_ticket_machines(shared_state);
-        auto current = static_cast<short>(rejestracja_pids.size());
+        if (evaluate_scaling) {
+            evaluate_scaling = false;
+            scale_ticket_machines(shared_state, *ticket_policy, rejestracja_pids, retiring_rejestracja);
+            scale_kasa_windows(shared_state, *kasa_policy, msg_kasa_id, kasa_scaling.max_machines, kasa_windows,
+                               retiring_kasy);
 
-        while (current < target) {
-            pid_t pid = process::spawn_rejestracja(process_config);
-            if (pid == -1) {
-                break;
+            if (clerk_autoscaler.enabled() && clerk_autoscaler.evaluate(shared_state, urzednik_queues)) {
+                process::forget_exited(urzednik_pids);
+                if (!process::replenish_urzednicy(urzednik_pids, urzednik_queues)) {
+                    Logger::log(LogSeverity::Err, Identity::Dyrektor, "Nie udalo sie zmienic obsady wydzialow.");
+                }
             }
-            rejestracja_pids.push_back(pid);
-            current = static_cast<short>(rejestracja_pids.size());
         }
+        watch_workers();
 
-        while (current > target) {
-            pid_t pid = rejestracja_pids.back();
-            rejestracja_pids.pop_back();
-
-            kill(pid, SIGUSR1);
-            process::wait_rejestracja(pid);
-            current = static_cast<short>(rejestracja_pids.size());
+        supervisor.set_tick(shared_state->is_open() ? kScaleTickMs : 0);
+        if (supervisor.wait(events) == -1) {
+            Logger::log(LogSeverity::Err, Identity::Dyrektor, "Blad petli zdarzen dyrektora.");
+            break;
         }
 
-        shared_state->ticket_machines_num = current;
-
-        int status = 0;
-        while (waitpid(-1, &status, WNOHANG) > 0) {
+        for (const auto& event : events) {
+            switch (event.kind) {
+                case supervisor::Wake::Signal:
+                    if (event.signal == SIGCHLD) {
+                        reap_children();
+                    }
+                    else {
+                        simulation_running = false;
+                    }
+                    break;
+                case supervisor::Wake::Clock:
+                    // The day check at the top of the loop reads the new state
+                    break;
+                case supervisor::Wake::Tick:
+                    evaluate_scaling = true;
+                    break;
+                case supervisor::Wake::DayEndAck:
+                    // Only expected during end_worker_day; a late ack is already counted
+                    break;
+                case supervisor::Wake::ChildExit:
+                    forget_worker(event.pid, rejestracja_pids, urzednik_pids, kasa_windows);
+                    evaluate_scaling = true;
+                    break;
+            }
         }
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(200));
     }
 
     stop_clock(clock_thread);
@@ -380,6 +783,8 @@ int dyrektor_main(HoursOpen hours_open, const std::array<uint32_t, 5>& departmen
 
     // 1. Send SIGUSR2 to the process group to evacuate petent processes.
     //    Generator, urzedniks, and rejestracja ignore SIGUSR2.
+    //    Petents check the shared flag once their handler is installed, so none started meanwhile stays behind.
+    shared_state->evacuation.set();
     signal(SIGUSR2, SIG_IGN);
     process::group::signal_self(SIGUSR2);
 
@@ -388,22 +793,31 @@ int dyrektor_main(HoursOpen hours_open, const std::array<uint32_t, 5>& departmen
         process::terminate_generator(generator_pid);
     }
 
-    // 3. Drain all message queues to make room for shutdown sentinel messages.
-    drain_msg_queue(msg_req_id);
-    drain_msg_queue(msg_kasa_id);
+    // 3. End the workers' day, so they stop taking work, then drain all message queues to make room for shutdown
+    //    sentinel messages.
+    end_worker_day(shared_state, supervisor, rejestracja_pids, urzednik_pids, kasa_windows, retiring_rejestracja,
+                   retiring_kasy);
+    ipc::msg::drain(msg_req_id);
+    drain_reply_queues();
+    ipc::msg::drain(msg_kasa_id);
     for (const auto& q : urzednik_queues) {
-        drain_msg_queue(q.msg_id);
+        ipc::msg::drain(q.msg_id);
     }
 
-    // 4. Shut down urzednik and rejestracja processes, then kasa last.
+    // 4. Shut down urzednik and rejestracja processes, then kasa last. The sentinels are queued while the workers
+    //    still sleep on day_start, so each one finds its sentinel waiting when it is woken.
     process::send_rejestracja_shutdown(msg_req_id, static_cast<int>(rejestracja_pids.size()));
     process::send_urzednik_shutdowns(urzednik_queues);
+    shared_state->day_start.set();
 
     process::wait_rejestracja_all(rejestracja_pids);
+    process::wait_rejestracja_all(retiring_rejestracja);
     process::wait_urzednik_all(urzednik_pids);
-    process::terminate_kasa(kasa_pid);
+    process::terminate_kasa_all(kasa_windows);
+    process::terminate_kasa_all(retiring_kasy);
 
     cleanup_clock();
-    cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, msg_kasa_id, sem_id, lock_file);
+    cleanup(shared_state, shm_id, msg_req_id, msg_sa_id, msg_sc_id, msg_km_id, msg_ml_id, msg_pd_id, msg_kasa_id,
+            lock_file);
     return 0;
 }
@@ -2,9 +2,14 @@
 #define SO_PROJEKT_DYREKTOR_H
 
 #include "../common.h"
+#include "../logger.h"
+#include "scaling.h"
 
 int dyrektor_main(HoursOpen hours_open, const std::array<uint32_t, 5>& department_limits, int time_mul,
 				  int gen_min_delay_sec, int gen_max_delay_sec, int gen_max_count, bool spawn_generator, bool one_day,
-				  int building_capacity);
+				  int building_capacity, const LogOptions& log_options, MsgTransport transport,
+				  int sample_interval_sec, PetentHost petent_host, int petent_threads, const ClerkCounts& clerk_counts,
+				  const ClerkCounts& clerk_max, const scaling::PolicyConfig& ticket_scaling,
+				  const scaling::PolicyConfig& kasa_scaling, const PlacementConfig& placement_config);
 
 #endif //SO_PROJEKT_DYREKTOR_H
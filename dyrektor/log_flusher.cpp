@@ -0,0 +1,208 @@
+#include "log_flusher.h"
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "../ipcutils.h"
+#include "../logger.h"
+
+constexpr uint32_t kMaxBatch = IOV_MAX < 1024 ? IOV_MAX : 1024;
+constexpr long kIdleWaitMs = 50;
+
+static logring::LogShared* shared_log = nullptr;
+static int log_shm_id = -1;
+static pthread_t flusher_thread{};
+static bool flusher_started = false;
+static std::atomic<bool> flusher_running(false);
+static uint64_t flushed_total = 0; // records passed on by the flusher thread; read after it is joined
+
+struct FlushTargets {
+    int log_fd;
+    int binary_fd;
+};
+
+static void report_drops(uint64_t& reported_drops, int log_fd) {
+    uint64_t dropped = shared_log->dropped.load(std::memory_order_relaxed);
+    if (dropped == reported_drops) {
+        return;
+    }
+    std::string line = Logger::format_line(LogSeverity::Warning, Identity::Dyrektor,
+                                           "Pominieto " + std::to_string(dropped - reported_drops) +
+                                               " wpisow dziennika (bufor pelny lub przerwany zapis).");
+    reported_drops = dropped;
+    iovec iov[1] = {{line.data(), line.size()}};
+    ipc::write_all(STDOUT_FILENO, iov, 1);
+    iov[0] = {line.data(), line.size()};
+    if (log_fd != -1) {
+        ipc::write_all(log_fd, iov, 1);
+    }
+}
+
+// Writes one batch of ready slots; returns the number of records flushed
+static uint32_t flush_batch(const FlushTargets& targets) {
+    uint32_t count = logring::ready_count(shared_log, kMaxBatch);
+    if (count == 0) {
+        return 0;
+    }
+
+    static iovec file_iov[kMaxBatch];
+    static iovec stdout_iov[kMaxBatch];
+    static iovec binary_iov[kMaxBatch];
+    int file_count = 0;
+    int stdout_count = 0;
+    int binary_count = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        const logring::Slot& slot = logring::slot_at(shared_log, i);
+        iovec entry{const_cast<char*>(slot.data), slot.length};
+        if (slot.flags & logring::kSlotToFile) {
+            file_iov[file_count++] = entry;
+        }
+        if (slot.flags & logring::kSlotToStdout) {
+            stdout_iov[stdout_count++] = entry;
+        }
+        if (slot.flags & logring::kSlotBinary) {
+            binary_iov[binary_count++] = entry;
+        }
+    }
+
+    if (stdout_count > 0 && ipc::write_all(STDOUT_FILENO, stdout_iov, stdout_count) == -1) {
+        perror("Failed to write to stdout");
+    }
+    if (file_count > 0 && targets.log_fd != -1 && ipc::write_all(targets.log_fd, file_iov, file_count) == -1) {
+        perror("Failed to write to log file");
+    }
+    if (binary_count > 0 && targets.binary_fd != -1 && ipc::write_all(targets.binary_fd, binary_iov, binary_count) == -1) {
+        perror("Failed to write to binary log file");
+    }
+
+    logring::release(shared_log, count);
+    flushed_total += count;
+    return count;
+}
+
+static void* flusher_thread_main(void*) {
+    ipc::block_signals({SIGINT, SIGTERM, SIGUSR1, SIGUSR2});
+
+    FlushTargets targets{-1, -1};
+    targets.log_fd = open(Logger::get_log_file().c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (targets.log_fd == -1) {
+        perror("Failed to open log file");
+    }
+    if (shared_log->binary_format) {
+        targets.binary_fd = open(Logger::get_binary_file().c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (targets.binary_fd == -1) {
+            perror("Failed to open binary log file");
+        }
+    }
+
+    uint64_t reported_drops = 0;
+    uint64_t stalled_head = UINT64_MAX;
+    uint64_t stalled_since_ns = 0;
+    while (true) {
+        bool running = flusher_running.load(std::memory_order_acquire);
+        uint32_t flushed = flush_batch(targets);
+        report_drops(reported_drops, targets.log_fd);
+        if (flushed > 0) {
+            continue;
+        }
+
+        // Nothing ready behind a claimed slot: wait kStalledSlotMs for its producer (none at shutdown), then skip it
+        if (logring::head_stalled(shared_log)) {
+            uint64_t head = shared_log->dequeue_pos.load(std::memory_order_relaxed);
+            uint64_t now_ns = ipc::monotonic_ns();
+            if (head != stalled_head) {
+                stalled_head = head;
+                stalled_since_ns = now_ns;
+            }
+            if ((!running || now_ns - stalled_since_ns >= logring::kStalledSlotMs * 1'000'000ULL) &&
+                logring::skip_stalled(shared_log)) {
+                continue;
+            }
+        }
+        if (!running) {
+            break;
+        }
+
+        uint32_t published = shared_log->published.load(std::memory_order_acquire);
+        shared_log->consumer_sleeping.store(1, std::memory_order_seq_cst);
+        if (logring::ready_count(shared_log, 1) == 0) {
+            timespec idle = ipc::futex::millis(kIdleWaitMs);
+            ipc::futex::wait(&shared_log->published, published, &idle);
+        }
+        shared_log->consumer_sleeping.store(0, std::memory_order_relaxed);
+    }
+
+    if (targets.log_fd != -1) {
+        close(targets.log_fd);
+    }
+    if (targets.binary_fd != -1) {
+        close(targets.binary_fd);
+    }
+    return nullptr;
+}
+
+int start_log_flusher(const LogOptions& options) {
+    key_t key = ipc::make_key(ipc::KeyType::LogShared);
+    if (key == -1) {
+        return -1;
+    }
+    log_shm_id = ipc::helper::create_or_reset_shm<logring::LogShared>(key);
+    if (log_shm_id == -1) {
+        return -1;
+    }
+    shared_log = ipc::shm::attach<logring::LogShared>(log_shm_id, false);
+    if (!shared_log) {
+        ipc::shm::remove(log_shm_id);
+        log_shm_id = -1;
+        return -1;
+    }
+    ipc::helper::publish_shm_id(ipc::helper::kLogShmEnv, log_shm_id);
+    new (shared_log) logring::LogShared(options.ring, options.format == LogFormat::Binary);
+    for (size_t i = 0; i < kIdentityCount; ++i) {
+        shared_log->min_severity[i] = static_cast<uint8_t>(options.min_severity[i]);
+        shared_log->rate.limits[i] = options.limits[i];
+    }
+    // Dyrektor's own records share the rate limiter even when the ring is off
+    Logger::use_shared_log(shared_log);
+
+    if (!options.ring.enabled) {
+        return 0;
+    }
+
+    flusher_running = true;
+    if (ipc::thread::create(&flusher_thread, flusher_thread_main, nullptr) == -1) {
+        flusher_running = false;
+        return -1;
+    }
+    flusher_started = true;
+    return 0;
+}
+
+void stop_log_flusher() {
+    if (shared_log != nullptr) {
+        Logger::flush_suppressed();
+        // Records pushed from now on go straight to the files
+        Logger::use_shared_log(nullptr);
+    }
+    if (flusher_started) {
+        flusher_running = false;
+        ipc::futex::wake(&shared_log->published);
+        ipc::thread::join(flusher_thread);
+        flusher_started = false;
+        Logger::log(LogSeverity::Notice, Identity::Dyrektor,
+                    "Bufor logow: przekazano " + std::to_string(flushed_total) + " wpisow, pominieto " +
+                        std::to_string(shared_log->dropped.load(std::memory_order_relaxed)) + ".");
+    }
+    if (shared_log != nullptr) {
+        ipc::shm::detach(shared_log);
+        shared_log = nullptr;
+    }
+    if (log_shm_id != -1) {
+        ipc::shm::remove(log_shm_id);
+        log_shm_id = -1;
+    }
+}
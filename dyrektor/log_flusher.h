@@ -0,0 +1,12 @@
+#ifndef SO_PROJEKT_DYREKTOR_LOG_FLUSHER_H
+#define SO_PROJEKT_DYREKTOR_LOG_FLUSHER_H
+
+#include "../logger.h"
+
+// Creates the shared log segment and, when the ring is enabled, starts the flusher thread.
+int start_log_flusher(const LogOptions& options);
+
+// Drains whatever is left in the ring, stops the thread and removes the segment.
+void stop_log_flusher();
+
+#endif // SO_PROJEKT_DYREKTOR_LOG_FLUSHER_H
@@ -1,50 +1,49 @@
 #include "process.h"
+#include <algorithm>
 #include <cerrno>
 #include <string>
 #include <vector>
+#include <fcntl.h>
 #include <signal.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include "../dayshift.h"
 #include "../ipcutils.h"
+#include "../placement.h"
 
 namespace process {
 
-    static std::vector<std::string> build_common_args(const char* role, const ProcessConfig& config) {
-        std::vector<std::string> args;
-        args.reserve(20);
-        args.emplace_back("so_projekt");
-        args.emplace_back("--role");
-        args.emplace_back(role);
-        args.emplace_back("--Tp");
-        args.emplace_back(std::to_string(config.hours_open.first));
-        args.emplace_back("--Tk");
-        args.emplace_back(std::to_string(config.hours_open.second));
-        args.emplace_back("--X1");
-        args.emplace_back(std::to_string(config.department_limits[0]));
-        args.emplace_back("--X2");
-        args.emplace_back(std::to_string(config.department_limits[1]));
-        args.emplace_back("--X3");
-        args.emplace_back(std::to_string(config.department_limits[2]));
-        args.emplace_back("--X4");
-        args.emplace_back(std::to_string(config.department_limits[3]));
-        args.emplace_back("--X5");
-        args.emplace_back(std::to_string(config.department_limits[4]));
-        args.emplace_back("--N");
-        args.emplace_back(std::to_string(config.building_capacity));
-        args.emplace_back("--time-mul");
-        args.emplace_back(std::to_string(config.time_mul));
-        args.emplace_back("--gen-min-delay");
-        args.emplace_back(std::to_string(config.gen_min_delay_sec));
-        args.emplace_back("--gen-max-delay");
-        args.emplace_back(std::to_string(config.gen_max_delay_sec));
-        if (config.gen_max_count >= 0) {
-            args.emplace_back("--gen-max-count");
-            args.emplace_back(std::to_string(config.gen_max_count));
-        }
-        if (config.one_day) {
-            args.emplace_back("--one-day");
-        }
-        return args;
+    static PlacementConfig child_placement{};
+
+    static int day_end_ack_fd = -1;
+
+    void set_placement(const PlacementConfig& config) { child_placement = config; }
+
+    void set_day_end_ack_fd(int fd) { day_end_ack_fd = fd; }
+
+    // Between fork and exec of a worker: only its copy of the ack eventfd survives exec, and it learns the number
+    static void pass_day_end_ack() {
+        if (day_end_ack_fd == -1) {
+            return;
+        }
+        int flags = fcntl(day_end_ack_fd, F_GETFD);
+        if (flags == -1 || fcntl(day_end_ack_fd, F_SETFD, flags & ~FD_CLOEXEC) == -1 ||
+            setenv(dayshift::kAckFdEnv, std::to_string(day_end_ack_fd).c_str(), 1) == -1) {
+            perror("passing the day-end ack fd failed");
+        }
+    }
+
+    // Between fork and exec: the set and the scheduling class survive exec. Failures are ignored, dyrektor has
+    // already fitted the sets and checked the real-time permission.
+    static void place_child(const cpu_set_t& cpus, bool realtime = false) {
+        placement::pin_self(cpus);
+        if (realtime) {
+            placement::set_realtime(child_placement.realtime, child_placement.realtime_priority);
+        }
+    }
+
+    static std::vector<std::string> build_common_args(const char* role) {
+        return {"so_projekt", "--role", role};
     }
 
     static int exec_with_args(std::vector<std::string>& args) {
@@ -54,11 +53,15 @@ namespace process {
             argv.push_back(const_cast<char*>(arg.c_str()));
         }
         argv.push_back(nullptr);
+        // The mask survives exec; dyrektor blocks the signals its supervisor reads from a signalfd
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, nullptr);
         execv("/proc/self/exe", argv.data());
         return -1;
     }
 
-    static pid_t spawn_urzednik(UrzednikRole role, const ProcessConfig& config) {
+    static pid_t spawn_urzednik(UrzednikRole role) {
         pid_t pid = fork();
         if (pid == -1) {
             perror("fork failed");
@@ -71,8 +74,10 @@ namespace process {
                 _exit(1);
             }
             const char* dept = dept_opt->data();
+            place_child(child_placement.urzednik[static_cast<size_t>(role)]);
+            pass_day_end_ack();
 
-            std::vector<std::string> args = build_common_args("urzednik", config);
+            std::vector<std::string> args = build_common_args("urzednik");
             args.emplace_back("--dept");
             args.emplace_back(dept);
 
@@ -90,14 +95,16 @@ namespace process {
         waitpid(pid, nullptr, 0);
     }
 
-    pid_t spawn_rejestracja(const ProcessConfig& config) {
+    pid_t spawn_rejestracja() {
         pid_t pid = fork();
         if (pid == -1) {
             perror("fork failed");
             return -1;
         }
         if (pid == 0) {
-            std::vector<std::string> args = build_common_args("rejestracja", config);
+            place_child(child_placement.rejestracja, true);
+            pass_day_end_ack();
+            std::vector<std::string> args = build_common_args("rejestracja");
             exec_with_args(args);
             perror("exec failed");
             _exit(1);
@@ -105,14 +112,15 @@ namespace process {
         return pid;
     }
 
-    pid_t spawn_generator(const ProcessConfig& config) {
+    pid_t spawn_generator() {
         pid_t pid = fork();
         if (pid == -1) {
             perror("fork failed");
             return -1;
         }
         if (pid == 0) {
-            std::vector<std::string> args = build_common_args("generator", config);
+            place_child(child_placement.generator);
+            std::vector<std::string> args = build_common_args("generator");
             exec_with_args(args);
             perror("exec failed");
             _exit(1);
@@ -139,14 +147,18 @@ namespace process {
         }
     }
 
-    pid_t spawn_kasa(const ProcessConfig& config) {
+    pid_t spawn_kasa(int window) {
         pid_t pid = fork();
         if (pid == -1) {
             perror("fork failed");
             return -1;
         }
         if (pid == 0) {
-            std::vector<std::string> args = build_common_args("kasa", config);
+            place_child(child_placement.kasa);
+            pass_day_end_ack();
+            std::vector<std::string> args = build_common_args("kasa");
+            args.emplace_back("--window");
+            args.emplace_back(std::to_string(window));
             exec_with_args(args);
             perror("exec failed");
             _exit(1);
@@ -154,24 +166,62 @@ namespace process {
         return pid;
     }
 
-    void terminate_kasa(pid_t pid) {
-        if (pid <= 0) {
-            return;
+    static void wait_kasa_all(std::vector<KasaWindow>& kasa_windows) {
+        for (const auto& kasa : kasa_windows) {
+            if (waitpid(kasa.pid, nullptr, 0) == -1 && errno != ECHILD) {
+                perror("waitpid failed");
+            }
         }
-        kill(pid, SIGUSR1);
-        if (waitpid(pid, nullptr, 0) == -1 && errno != ECHILD) {
-            perror("waitpid failed");
+        kasa_windows.clear();
+    }
+
+    void signal_kasa_all(const std::vector<KasaWindow>& kasa_windows) {
+        for (const auto& kasa : kasa_windows) {
+            kill(kasa.pid, SIGUSR1);
+        }
+    }
+
+    void terminate_kasa_all(std::vector<KasaWindow>& kasa_windows) {
+        signal_kasa_all(kasa_windows);
+        wait_kasa_all(kasa_windows);
+    }
+
+    bool open_kasa_window(std::vector<KasaWindow>& kasa_windows, const std::vector<KasaWindow>& retiring) {
+        auto taken = [](const std::vector<KasaWindow>& windows, int window) {
+            return std::any_of(windows.begin(), windows.end(),
+                               [window](const KasaWindow& kasa) { return kasa.window == window; });
+        };
+        int window = 1;
+        while (taken(kasa_windows, window) || taken(retiring, window)) {
+            window++;
+        }
+        if (window > kMaxKasaWindows) {
+            return false;
+        }
+        pid_t pid = spawn_kasa(window);
+        if (pid == -1) {
+            return false;
         }
+        kasa_windows.push_back({pid, window});
+        return true;
     }
 
-    bool spawn_rejestracja_group(std::vector<pid_t>& rejestracja_pids, const ProcessConfig& config) {
-        pid_t first_pid = spawn_rejestracja(config);
+    bool spawn_rejestracja_group(std::vector<pid_t>& rejestracja_pids, int count) {
+        pid_t first_pid = spawn_rejestracja();
         if (first_pid == -1) {
             return false;
         }
         rejestracja_pids.clear();
-        rejestracja_pids.reserve(3);
+        rejestracja_pids.reserve(static_cast<size_t>(count));
         rejestracja_pids.push_back(first_pid);
+        // The rest are a bonus; the scaling policy asks for the missing ones again on the next pass
+        while (static_cast<int>(rejestracja_pids.size()) < count) {
+            pid_t pid = spawn_rejestracja();
+            if (pid == -1) {
+                break;
+            }
+            rejestracja_pids.push_back(pid);
+        }
         return true;
     }
 
@@ -184,36 +234,21 @@ namespace process {
         }
     }
 
-    bool spawn_urzednicy(std::vector<UrzednikProcess>& urzednik_pids, const ProcessConfig& config) {
+    bool spawn_urzednicy(std::vector<UrzednikProcess>& urzednik_pids, const std::vector<UrzednikQueue>& queues) {
         std::vector<UrzednikProcess> spawned;
-        spawned.reserve(6);
-
-        pid_t sa1 = spawn_urzednik(UrzednikRole::SA, config);
-        if (sa1 != -1) {
-            spawned.push_back({sa1, UrzednikRole::SA});
-        }
-        pid_t sa2 = spawn_urzednik(UrzednikRole::SA, config);
-        if (sa2 != -1) {
-            spawned.push_back({sa2, UrzednikRole::SA});
-        }
-        pid_t sc = spawn_urzednik(UrzednikRole::SC, config);
-        if (sc != -1) {
-            spawned.push_back({sc, UrzednikRole::SC});
-        }
-        pid_t km = spawn_urzednik(UrzednikRole::KM, config);
-        if (km != -1) {
-            spawned.push_back({km, UrzednikRole::KM});
-        }
-        pid_t ml = spawn_urzednik(UrzednikRole::ML, config);
-        if (ml != -1) {
-            spawned.push_back({ml, UrzednikRole::ML});
-        }
-        pid_t pd = spawn_urzednik(UrzednikRole::PD, config);
-        if (pd != -1) {
-            spawned.push_back({pd, UrzednikRole::PD});
+        bool failed = false;
+        for (size_t q = 0; q < queues.size() && !failed; ++q) {
+            for (int i = 0; i < queues[q].count; ++i) {
+                pid_t pid = spawn_urzednik(queues[q].role);
+                if (pid == -1) {
+                    failed = true;
+                    break;
+                }
+                spawned.push_back({pid, queues[q].role});
+            }
         }
 
-        if (sa1 == -1 || sa2 == -1 || sc == -1 || km == -1 || ml == -1 || pd == -1) {
+        if (failed) {
             for (const auto& proc : spawned) {
                 request_stop_after_current(proc.pid);
             }
@@ -229,28 +264,85 @@ namespace process {
         return true;
     }
 
-    void stop_daily_rejestracja(std::vector<pid_t>& rejestracja_pids) {
-        for (pid_t pid : rejestracja_pids) {
-            request_stop_after_current(pid);
+    bool has_exited(pid_t pid) {
+        // ECHILD: already reaped by dyrektor's WNOHANG sweep
+        return waitpid(pid, nullptr, WNOHANG) != 0;
+    }
+
+    void forget_exited(std::vector<pid_t>& pids) {
+        pids.erase(std::remove_if(pids.begin(), pids.end(), has_exited), pids.end());
+    }
+
+    void forget_exited(std::vector<UrzednikProcess>& urzednik_pids) {
+        urzednik_pids.erase(std::remove_if(urzednik_pids.begin(), urzednik_pids.end(),
+                                           [](const UrzednikProcess& proc) { return has_exited(proc.pid); }),
+                            urzednik_pids.end());
+    }
+
+    void forget_exited(std::vector<KasaWindow>& kasa_windows) {
+        kasa_windows.erase(std::remove_if(kasa_windows.begin(), kasa_windows.end(),
+                                          [](const KasaWindow& kasa) { return has_exited(kasa.pid); }),
+                           kasa_windows.end());
+    }
+
+    static bool retire_urzednik(std::vector<UrzednikProcess>& urzednik_pids, UrzednikRole role) {
+        // The most recently hired clerk goes first
+        for (auto it = urzednik_pids.rbegin(); it != urzednik_pids.rend(); ++it) {
+            if (it->role != role || it->retiring) {
+                continue;
+            }
+            sigval value{};
+            value.sival_int = kRetireClerkSignalValue;
+            if (sigqueue(it->pid, SIGUSR1, value) == -1) {
+                perror("sigqueue failed");
+                return false;
+            }
+            it->retiring = true;
+            return true;
         }
-        for (pid_t pid : rejestracja_pids) {
-            if (waitpid(pid, nullptr, 0) == -1 && errno != ECHILD) {
-                perror("waitpid failed");
+        return false;
+    }
+
+    bool staff_department(std::vector<UrzednikProcess>& urzednik_pids, const UrzednikQueue& queue) {
+        auto staffed = std::count_if(urzednik_pids.begin(), urzednik_pids.end(), [&](const UrzednikProcess& proc) {
+            return proc.role == queue.role && !proc.retiring;
+        });
+        for (auto i = staffed; i < queue.count; ++i) {
+            pid_t pid = spawn_urzednik(queue.role);
+            if (pid == -1) {
+                return false;
             }
+            urzednik_pids.push_back({pid, queue.role});
         }
-        rejestracja_pids.clear();
+        for (auto i = staffed; i > queue.count; --i) {
+            if (!retire_urzednik(urzednik_pids, queue.role)) {
+                return false;
+            }
+        }
+        return true;
     }
 
-    void stop_daily_urzednik(std::vector<UrzednikProcess>& urzednik_pids) {
-        for (const auto& proc : urzednik_pids) {
-            request_stop_after_current(proc.pid);
+    bool replenish_urzednicy(std::vector<UrzednikProcess>& urzednik_pids, const std::vector<UrzednikQueue>& queues) {
+        bool complete = true;
+        for (const auto& queue : queues) {
+            if (!staff_department(urzednik_pids, queue)) {
+                complete = false;
+            }
+        }
+        return complete;
+    }
+
+    void ring_day_end(const std::vector<pid_t>& rejestracja_pids, const std::vector<UrzednikProcess>& urzednik_pids,
+                      const std::vector<KasaWindow>& kasa_windows) {
+        for (pid_t pid : rejestracja_pids) {
+            kill(pid, dayshift::kDayEndSignal);
         }
         for (const auto& proc : urzednik_pids) {
-            if (waitpid(proc.pid, nullptr, 0) == -1 && errno != ECHILD) {
-                perror("waitpid failed");
-            }
+            kill(proc.pid, dayshift::kDayEndSignal);
+        }
+        for (const auto& kasa : kasa_windows) {
+            kill(kasa.pid, dayshift::kDayEndSignal);
         }
-        urzednik_pids.clear();
     }
 
     void wait_rejestracja_all(std::vector<pid_t>& rejestracja_pids) {
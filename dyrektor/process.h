@@ -8,40 +8,61 @@
 
 namespace process {
 
-struct ProcessConfig {
-    HoursOpen hours_open;
-    std::array<uint32_t, 5> department_limits;
-    int time_mul;
-    int gen_min_delay_sec;
-    int gen_max_delay_sec;
-    int gen_max_count;
-    bool one_day;
-    int building_capacity;
-};
-
 struct UrzednikProcess {
     pid_t pid;
     UrzednikRole role;
+    bool retiring = false; // asked to leave after the petent in hand; no longer counts towards its department
+};
+
+struct KasaWindow {
+    pid_t pid;
+    int window; // 1..kMaxKasaWindows, passed as "--window"; indexes the window's counters in DayStats
 };
 
 struct UrzednikQueue {
     int msg_id;
     UrzednikRole role;
-    int count;
+    int count; // clerks the department should have; changed by the autoscaler
 };
 
-pid_t spawn_rejestracja(const ProcessConfig& config);
-pid_t spawn_generator(const ProcessConfig& config);
-pid_t spawn_kasa(const ProcessConfig& config);
+// CPU sets and real-time class the spawn functions apply to the children; fitted by dyrektor beforehand
+void set_placement(const PlacementConfig& config);
+
+// eventfd the workers (rejestracja, urzednicy, kasa) acknowledge their day end on; other children do not get it
+void set_day_end_ack_fd(int fd);
+
+// Children get only "--role" (and their department) in argv; the rest is read from SharedState::config
+pid_t spawn_rejestracja();
+pid_t spawn_generator();
+pid_t spawn_kasa(int window);
 void wait_rejestracja(pid_t pid);
 void terminate_generator(pid_t pid);
-void terminate_kasa(pid_t pid);
+// SIGUSR1 to every window (finish the payment in hand) without waiting for them
+void signal_kasa_all(const std::vector<KasaWindow>& kasa_windows);
+// signal_kasa_all, then waits for all of them
+void terminate_kasa_all(std::vector<KasaWindow>& kasa_windows);
+
+// Spawns `count` ticket machines; fails only when not even the first one starts
+bool spawn_rejestracja_group(std::vector<pid_t>& rejestracja_pids, int count);
+// Opens the lowest window number free in both lists, so that the numbers in use stay low; a retiring window may still
+// be finishing a payment and keeps its number (and its DayStats counters) until it exits
+bool open_kasa_window(std::vector<KasaWindow>& kasa_windows, const std::vector<KasaWindow>& retiring);
+bool spawn_urzednicy(std::vector<UrzednikProcess>& urzednik_pids, const std::vector<UrzednikQueue>& queues);
 
-bool spawn_rejestracja_group(std::vector<pid_t>& rejestracja_pids, const ProcessConfig& config);
-bool spawn_urzednicy(std::vector<UrzednikProcess>& urzednik_pids, const ProcessConfig& config);
+// Workers stay alive across days; these keep dyrektor's lists in step with the ones that actually run
+bool has_exited(pid_t pid);
+void forget_exited(std::vector<pid_t>& pids);
+void forget_exited(std::vector<UrzednikProcess>& urzednik_pids);
+void forget_exited(std::vector<KasaWindow>& kasa_windows);
+// Spawns the clerks missing from each queue's count (e.g. one stopped with SIGUSR1 during the day)
+bool replenish_urzednicy(std::vector<UrzednikProcess>& urzednik_pids, const std::vector<UrzednikQueue>& queues);
+// Brings one department to queue.count: spawns the missing clerks or retires the surplus without waiting for them
+// (SIGUSR1 with kRetireClerkSignalValue; the retired clerk is forgotten once it has exited)
+bool staff_department(std::vector<UrzednikProcess>& urzednik_pids, const UrzednikQueue& queue);
 
-void stop_daily_rejestracja(std::vector<pid_t>& rejestracja_pids);
-void stop_daily_urzednik(std::vector<UrzednikProcess>& urzednik_pids);
+// Interrupts the workers' blocking calls so they notice SharedState::worker_epoch
+void ring_day_end(const std::vector<pid_t>& rejestracja_pids, const std::vector<UrzednikProcess>& urzednik_pids,
+                  const std::vector<KasaWindow>& kasa_windows);
 
 void wait_rejestracja_all(std::vector<pid_t>& rejestracja_pids);
 void wait_urzednik_all(std::vector<UrzednikProcess>& urzednik_pids);
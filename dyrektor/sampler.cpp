@@ -0,0 +1,256 @@
+#include "sampler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "../ipcutils.h"
+#include "../logger.h"
+
+namespace sampler {
+
+constexpr uint32_t kMagic = 0x534d504c; // "SMPL"
+constexpr uint16_t kVersion = 1;
+constexpr long kMinPollMs = 1;
+constexpr long kMaxPollMs = 100;
+
+struct SamplerContext {
+    SharedState* state;
+    std::vector<SampledQueue> queues;
+    uint32_t interval_sec;
+};
+
+static SamplerContext context{};
+static pthread_t sampler_thread{};
+static bool sampler_started = false;
+static std::atomic<bool> sampler_running(false);
+
+// Per-day state of the sampler thread; fd == -1 while waiting for the office to open
+struct DayFile {
+    int fd = -1;
+    uint32_t day_tag = 0; // SharedState::day while the day is running
+    uint32_t next_sample = 0;
+    uint32_t last_issued[kDepartmentCount] = {};
+    uint32_t last_served[kDepartmentCount] = {};
+};
+
+std::string samples_path(uint32_t day_number, const char* extension) {
+    return "/tmp/so_projekt_samples_day_" + std::to_string(day_number) + "." + extension;
+}
+
+static uint32_t delta(uint32_t current, uint32_t& last) {
+    // Counters are zeroed by dyrektor at rollover, a smaller value starts a new baseline
+    uint32_t result = current >= last ? current - last : current;
+    last = current;
+    return result;
+}
+
+static void open_day(DayFile& file) {
+    const SharedState* state = context.state;
+    StateSnapshot snapshot = state->snapshot();
+    file.day_tag = snapshot.day;
+    file.next_sample = snapshot.simulated_time;
+    for (size_t i = 0; i < kDepartmentCount; ++i) {
+        file.last_issued[i] = state->ticket_counters[i].value.load(std::memory_order_relaxed);
+        file.last_served[i] = state->stats.served[i].load(std::memory_order_relaxed);
+    }
+
+    std::string path = samples_path(file.day_tag + 1, "bin");
+    file.fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file.fd == -1) {
+        perror("open samples file failed");
+        return;
+    }
+
+    FileHeader header{};
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.queue_count = static_cast<uint16_t>(context.queues.size());
+    header.day = file.day_tag + 1;
+    header.interval_sec = context.interval_sec;
+    for (size_t i = 0; i < context.queues.size(); ++i) {
+        std::strncpy(header.queue_names[i], context.queues[i].name.c_str(), kNameLength - 1);
+    }
+    iovec iov{&header, sizeof(header)};
+    if (ipc::write_all(file.fd, &iov, 1) == -1) {
+        perror("write samples header failed");
+        close(file.fd);
+        file.fd = -1;
+    }
+}
+
+static void take_sample(DayFile& file) {
+    const SharedState* state = context.state;
+    StateSnapshot snapshot = state->snapshot();
+    Record record{};
+    record.simulated_time = snapshot.simulated_time;
+    record.queue_length = snapshot.current_queue_length;
+    record.ticket_machines = snapshot.ticket_machines_num;
+    record.free_places = static_cast<int32_t>(state->admission.available());
+    for (size_t i = 0; i < kDepartmentCount; ++i) {
+        record.issued[i] = delta(state->ticket_counters[i].value.load(std::memory_order_relaxed), file.last_issued[i]);
+        record.served[i] = delta(state->stats.served[i].load(std::memory_order_relaxed), file.last_served[i]);
+    }
+    for (size_t i = 0; i < context.queues.size(); ++i) {
+        ipc::msg::QueueStat queue_stat{};
+        if (ipc::msg::stat(context.queues[i].msg_id, &queue_stat) == 0) {
+            record.queue_messages[i] = static_cast<uint32_t>(queue_stat.messages);
+            record.queue_bytes[i] = static_cast<uint32_t>(queue_stat.bytes);
+        }
+    }
+
+    iovec iov{&record, sizeof(record)};
+    if (ipc::write_all(file.fd, &iov, 1) == -1) {
+        perror("write samples record failed");
+    }
+}
+
+static void close_day(DayFile& file) {
+    uint32_t day_number = file.day_tag + 1;
+    if (close(file.fd) == -1) {
+        perror("close samples file failed");
+    }
+    file.fd = -1;
+
+    if (export_csv(day_number) == -1) {
+        Logger::log(LogSeverity::Err, Identity::Dyrektor, "Nie udalo sie wyeksportowac probek dnia.");
+    }
+    else {
+        Logger::log(LogSeverity::Notice, Identity::Dyrektor, "Zapisano probki dnia " + std::to_string(day_number) + ".");
+    }
+}
+
+static std::string format_clock(uint32_t seconds) {
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%02u:%02u:%02u", seconds / 3600, (seconds / 60) % 60, seconds % 60);
+    return buffer;
+}
+
+int export_csv(uint32_t day_number) {
+    std::string bin_path = samples_path(day_number, "bin");
+    int fd = open(bin_path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        perror("open samples file failed");
+        return -1;
+    }
+
+    FileHeader header{};
+    if (read(fd, &header, sizeof(header)) != static_cast<ssize_t>(sizeof(header)) || header.magic != kMagic ||
+        header.version != kVersion || header.queue_count > kMaxQueues) {
+        close(fd);
+        return -1;
+    }
+
+    std::string out = "czas,kolejka,wolne_miejsca,biletomaty";
+    for (size_t i = 0; i < kDepartmentCount; ++i) {
+        std::string dept(urzednik_role_to_string(static_cast<UrzednikRole>(i)).value_or("?"));
+        out += ",wydane_" + dept + ",obsluzone_" + dept;
+    }
+    for (size_t i = 0; i < header.queue_count; ++i) {
+        std::string name(header.queue_names[i], strnlen(header.queue_names[i], kNameLength));
+        out += "," + name + "_komunikaty," + name + "_bajty";
+    }
+    out += '\n';
+
+    Record record{};
+    while (read(fd, &record, sizeof(record)) == static_cast<ssize_t>(sizeof(record))) {
+        out += format_clock(record.simulated_time) + "," + std::to_string(record.queue_length) + "," +
+               std::to_string(record.free_places) + "," + std::to_string(record.ticket_machines);
+        for (size_t i = 0; i < kDepartmentCount; ++i) {
+            out += "," + std::to_string(record.issued[i]) + "," + std::to_string(record.served[i]);
+        }
+        for (size_t i = 0; i < header.queue_count; ++i) {
+            out += "," + std::to_string(record.queue_messages[i]) + "," + std::to_string(record.queue_bytes[i]);
+        }
+        out += '\n';
+    }
+    close(fd);
+
+    std::string csv_path = samples_path(day_number, "csv");
+    int csv_fd = open(csv_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (csv_fd == -1) {
+        perror("open samples csv failed");
+        return -1;
+    }
+    iovec iov{out.data(), out.size()};
+    int rc = ipc::write_all(csv_fd, &iov, 1);
+    if (rc == -1) {
+        perror("write samples csv failed");
+    }
+    if (close(csv_fd) == -1) {
+        perror("close samples csv failed");
+        return -1;
+    }
+    return rc;
+}
+
+// Half a sampling interval of real time, so a sample is never late by more than that
+static long poll_period_ms() {
+    uint32_t time_mul = context.state->time_mul > 0 ? context.state->time_mul : 1;
+    long period = static_cast<long>(context.interval_sec) * 1000 / static_cast<long>(time_mul) / 2;
+    return std::clamp(period, kMinPollMs, kMaxPollMs);
+}
+
+static void* sampler_thread_main(void*) {
+    ipc::block_signals({SIGINT, SIGTERM, SIGUSR1, SIGUSR2});
+
+    const SharedState* state = context.state;
+    DayFile file;
+    timespec poll = ipc::futex::millis(poll_period_ms());
+    while (sampler_running.load(std::memory_order_acquire)) {
+        StateSnapshot snapshot = state->snapshot();
+        if (file.fd == -1) {
+            if (snapshot.office_status == OfficeStatus::Open) {
+                open_day(file);
+            }
+        }
+        else if (snapshot.day != file.day_tag) {
+            close_day(file);
+        }
+        else if (snapshot.simulated_time >= file.next_sample) {
+            take_sample(file);
+            while (file.next_sample <= snapshot.simulated_time) {
+                file.next_sample += context.interval_sec;
+            }
+        }
+        nanosleep(&poll, nullptr);
+    }
+
+    if (file.fd != -1) {
+        take_sample(file);
+        close_day(file);
+    }
+    return nullptr;
+}
+
+int start(SharedState* shared_state, std::vector<SampledQueue> queues, uint32_t interval_sec) {
+    if (interval_sec == 0 || sampler_started) {
+        return 0;
+    }
+    if (queues.size() > kMaxQueues) {
+        queues.resize(kMaxQueues);
+    }
+    context = {shared_state, std::move(queues), interval_sec};
+
+    sampler_running = true;
+    if (ipc::thread::create(&sampler_thread, sampler_thread_main, nullptr) == -1) {
+        sampler_running = false;
+        return -1;
+    }
+    sampler_started = true;
+    return 0;
+}
+
+void stop() {
+    if (!sampler_started) {
+        return;
+    }
+    sampler_running = false;
+    ipc::thread::join(sampler_thread);
+    sampler_started = false;
+}
+
+} // namespace sampler
@@ -0,0 +1,53 @@
+#ifndef SO_PROJEKT_DYREKTOR_SAMPLER_H
+#define SO_PROJEKT_DYREKTOR_SAMPLER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../common.h"
+
+// Time series of queue depths and throughput, sampled by a dyrektor thread every `interval` simulated seconds.
+// Each day goes to /tmp/so_projekt_samples_day_N.bin (fixed-size records) and is exported to .csv once the day ends.
+namespace sampler {
+
+    constexpr size_t kMaxQueues = 16;
+    constexpr size_t kNameLength = 12;
+
+    struct SampledQueue {
+        std::string name;
+        int msg_id;
+    };
+
+    struct FileHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t queue_count;
+        uint32_t day;
+        uint32_t interval_sec;
+        char queue_names[kMaxQueues][kNameLength];
+    };
+
+    struct Record {
+        uint32_t simulated_time;
+        uint32_t queue_length; // SharedState::current_queue_length
+        int32_t free_places; // SharedState::admission
+        uint32_t ticket_machines;
+        uint32_t issued[kDepartmentCount]; // since the previous sample
+        uint32_t served[kDepartmentCount]; // since the previous sample
+        uint32_t queue_messages[kMaxQueues];
+        uint32_t queue_bytes[kMaxQueues];
+    };
+
+    std::string samples_path(uint32_t day_number, const char* extension);
+
+    // Writes the CSV export of a finished day file; returns -1 when the .bin file cannot be read
+    int export_csv(uint32_t day_number);
+
+    int start(SharedState* shared_state, std::vector<SampledQueue> queues, uint32_t interval_sec);
+
+    // Stops the thread and closes the current day (its CSV is exported as well)
+    void stop();
+
+} // namespace sampler
+
+#endif // SO_PROJEKT_DYREKTOR_SAMPLER_H
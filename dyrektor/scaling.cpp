@@ -0,0 +1,193 @@
+#include "scaling.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace scaling {
+
+    constexpr double kEwmaTauSec = 600.0; // arrival rate smoothing time constant
+    constexpr double kEwmaLeadSec = 300.0; // how far ahead the EWMA policy predicts the queue
+    constexpr double kPidKp = 1.0; // machines per 100% of wait above the target
+    constexpr double kPidKi = 1.0 / 600.0;
+    constexpr double kPidKd = 60.0;
+
+    static std::string format_number(double value) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.2f", value);
+        return buf;
+    }
+
+    // Bounds, dwell time and day resets shared by all policies; subclasses only say what they want
+    class BoundedPolicy : public Policy {
+    public:
+        explicit BoundedPolicy(const PolicyConfig& config) : config(config) {}
+
+        int desired(const Inputs& inputs, std::string& reason) final {
+            // The clock starts over every day, and the measurements with it
+            if (!started || inputs.day != day || inputs.simulated_time < last_time) {
+                started = true;
+                day = inputs.day;
+                last_time = inputs.simulated_time;
+                last_change = inputs.simulated_time;
+                last_arrivals = inputs.arrivals;
+                reset();
+            }
+            else if (inputs.simulated_time > last_time) {
+                observe(inputs, inputs.simulated_time - last_time, inputs.arrivals - last_arrivals);
+                last_time = inputs.simulated_time;
+                last_arrivals = inputs.arrivals;
+            }
+
+            int wanted = std::clamp(want(inputs, reason), config.min_machines, config.max_machines);
+            // A waiting queue gets its machines at once; only giving them back waits out the dwell time
+            bool held = wanted < inputs.current && inputs.current <= config.max_machines &&
+                        inputs.simulated_time - last_change < kMinDwellSec;
+            if (wanted == inputs.current || held) {
+                return inputs.current;
+            }
+            last_change = inputs.simulated_time;
+            return wanted;
+        }
+
+    protected:
+        virtual void reset() {}
+        virtual void observe(const Inputs& /*inputs*/, uint32_t /*elapsed_sec*/, uint32_t /*arrived*/) {}
+        virtual int want(const Inputs& inputs, std::string& reason) = 0;
+
+        double step(uint32_t capacity) const {
+            return std::max(1.0, static_cast<double>(capacity) / config.max_machines);
+        }
+
+        // Machines for `load` on the N / max_machines ladder; going down waits until load is half a step below
+        int stepped_level(double load, int current, uint32_t capacity) const {
+            double size = step(capacity);
+            int up = load <= 0 ? 1 : static_cast<int>(std::ceil(load / size));
+            if (up > current) {
+                return up;
+            }
+            int down = static_cast<int>(std::ceil((load + size / 2) / size));
+            return std::min(current, std::max(down, 1));
+        }
+
+        PolicyConfig config;
+
+    private:
+        bool started = false;
+        uint32_t day = 0;
+        uint32_t last_time = 0;
+        uint32_t last_change = 0;
+        uint32_t last_arrivals = 0;
+    };
+
+    class ThresholdPolicy : public BoundedPolicy {
+    public:
+        using BoundedPolicy::BoundedPolicy;
+
+    protected:
+        int want(const Inputs& inputs, std::string& reason) override {
+            reason = "threshold: kolejka " + std::to_string(inputs.queue_length) + ", krok " +
+                     format_number(step(inputs.capacity));
+            return stepped_level(inputs.queue_length, inputs.current, inputs.capacity);
+        }
+    };
+
+    // Arrival rate in petents per simulated second, smoothed over kEwmaTauSec whatever the sampling interval
+    class ArrivalRate {
+    public:
+        void reset() { rate = 0; }
+
+        void observe(uint32_t elapsed_sec, uint32_t arrived) {
+            double alpha = 1.0 - std::exp(-static_cast<double>(elapsed_sec) / kEwmaTauSec);
+            rate += alpha * (static_cast<double>(arrived) / elapsed_sec - rate);
+        }
+
+        double per_sec() const { return rate; }
+
+    private:
+        double rate = 0;
+    };
+
+    class EwmaPolicy : public BoundedPolicy {
+    public:
+        using BoundedPolicy::BoundedPolicy;
+
+    protected:
+        void reset() override { arrivals.reset(); }
+
+        void observe(const Inputs& /*inputs*/, uint32_t elapsed_sec, uint32_t arrived) override {
+            arrivals.observe(elapsed_sec, arrived);
+        }
+
+        int want(const Inputs& inputs, std::string& reason) override {
+            double predicted = inputs.queue_length + arrivals.per_sec() * kEwmaLeadSec;
+            reason = "ewma: kolejka " + std::to_string(inputs.queue_length) + ", przybycia " +
+                     format_number(arrivals.per_sec() * 60) + "/min, prognoza " + format_number(predicted) +
+                     ", krok " + format_number(step(inputs.capacity));
+            return stepped_level(predicted, inputs.current, inputs.capacity);
+        }
+
+    private:
+        ArrivalRate arrivals;
+    };
+
+    class PidPolicy : public BoundedPolicy {
+    public:
+        explicit PidPolicy(const PolicyConfig& config) : BoundedPolicy(config) {}
+
+    protected:
+        void reset() override {
+            arrivals.reset();
+            integral = 0;
+            last_error = 0;
+            derivative = 0;
+            wait_sec = 0;
+        }
+
+        void observe(const Inputs& inputs, uint32_t elapsed_sec, uint32_t arrived) override {
+            arrivals.observe(elapsed_sec, arrived);
+            auto target = static_cast<double>(std::max<uint32_t>(config.target_wait_sec, 1));
+
+            // Little's law; with no arrivals measured yet a non-empty queue counts as far over the target
+            double rate = arrivals.per_sec();
+            wait_sec = inputs.queue_length == 0 ? 0 : (rate > 0 ? inputs.queue_length / rate : 10 * target);
+            wait_sec = std::min(wait_sec, 10 * target);
+
+            double error = (wait_sec - target) / target;
+            // Anti-windup: the integral alone can at most span the whole machine range
+            double integral_limit = (config.max_machines - config.min_machines) / kPidKi;
+            integral = std::clamp(integral + error * elapsed_sec, -integral_limit, integral_limit);
+            derivative = (error - last_error) / elapsed_sec;
+            last_error = error;
+        }
+
+        int want(const Inputs& /*inputs*/, std::string& reason) override {
+            double p = kPidKp * last_error;
+            double i = kPidKi * integral;
+            double d = kPidKd * derivative;
+            reason = "pid: oczekiwanie " + format_number(wait_sec) + " s (cel " +
+                     std::to_string(config.target_wait_sec) + " s), P=" + format_number(p) + " I=" +
+                     format_number(i) + " D=" + format_number(d);
+            return static_cast<int>(std::lround(config.min_machines + p + i + d));
+        }
+
+    private:
+        ArrivalRate arrivals;
+        double integral = 0;
+        double last_error = 0;
+        double derivative = 0;
+        double wait_sec = 0;
+    };
+
+    std::unique_ptr<Policy> make_policy(const PolicyConfig& config) {
+        switch (config.kind) {
+            case PolicyKind::Ewma:
+                return std::make_unique<EwmaPolicy>(config);
+            case PolicyKind::Pid:
+                return std::make_unique<PidPolicy>(config);
+            case PolicyKind::Threshold:
+                break;
+        }
+        return std::make_unique<ThresholdPolicy>(config);
+    }
+
+} // namespace scaling
@@ -0,0 +1,72 @@
+#ifndef SO_PROJEKT_DYREKTOR_SCALING_H
+#define SO_PROJEKT_DYREKTOR_SCALING_H
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Ticket machine (rejestracja) scaling policies, asked by dyrektor's main loop how many machines it wants. All of them
+// stay within [min_machines, max_machines]. Scale-ups happen at once, but a machine is retired only kMinDwellSec of
+// simulated time after the last change, so a queue hovering around a threshold does not spawn and retire machines
+// every pass.
+namespace scaling {
+
+    constexpr int kMaxTicketMachines = 16;
+    constexpr uint32_t kMinDwellSec = 300;
+    // Kasa windows use the same policies on the payment queue: waiting payments per window before another one opens
+    constexpr int kKasaPaymentsPerWindow = 2;
+
+    enum class PolicyKind : uint8_t {
+        Threshold, // queue length against N / max_machines steps, with a half-step hysteresis band
+        Ewma, // the same steps applied to the queue predicted from an EWMA of the arrival rate
+        Pid, // PID controller driving the estimated ticket wait towards target_wait_sec
+    };
+
+    inline std::optional<PolicyKind> string_to_policy_kind(std::string_view str) {
+        if (str == "threshold") return PolicyKind::Threshold;
+        if (str == "ewma") return PolicyKind::Ewma;
+        if (str == "pid") return PolicyKind::Pid;
+        return std::nullopt;
+    }
+
+    inline std::string_view policy_kind_to_string(PolicyKind kind) {
+        switch (kind) {
+            case PolicyKind::Threshold: return "threshold";
+            case PolicyKind::Ewma: return "ewma";
+            case PolicyKind::Pid: return "pid";
+        }
+        return "threshold";
+    }
+
+    struct PolicyConfig {
+        PolicyKind kind = PolicyKind::Threshold;
+        int min_machines = 1;
+        int max_machines = 3;
+        uint32_t target_wait_sec = 120; // PID setpoint, simulated seconds
+    };
+
+    // What dyrektor measures on each pass of its main loop
+    struct Inputs {
+        uint32_t day;
+        uint32_t simulated_time; // seconds since midnight
+        uint32_t queue_length; // SharedState::current_queue_length
+        uint32_t arrivals; // SharedState::queue_arrivals, cumulative
+        uint32_t capacity; // N
+        int current; // machines running now
+    };
+
+    class Policy {
+    public:
+        virtual ~Policy() = default;
+
+        // Machines wanted now; when that differs from inputs.current, `reason` describes the inputs behind it
+        virtual int desired(const Inputs& inputs, std::string& reason) = 0;
+    };
+
+    std::unique_ptr<Policy> make_policy(const PolicyConfig& config);
+
+} // namespace scaling
+
+#endif // SO_PROJEKT_DYREKTOR_SCALING_H
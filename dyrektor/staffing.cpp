@@ -0,0 +1,106 @@
+#include "staffing.h"
+#include <string>
+#include "../ipcutils.h"
+#include "../logger.h"
+
+namespace staffing {
+
+    Autoscaler::Autoscaler(const ClerkCounts& start_counts, const ClerkCounts& max_counts) : max_counts(max_counts) {
+        for (size_t idx = 0; idx < kDepartmentCount; ++idx) {
+            scaled[idx] = max_counts[idx] > start_counts[idx];
+        }
+    }
+
+    bool Autoscaler::enabled() const {
+        for (bool department_scaled : scaled) {
+            if (department_scaled) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Autoscaler::start_window(const SharedState* shared_state, uint32_t day, uint32_t simulated_time) {
+        window_day = day;
+        window_start = simulated_time;
+        window_open = true;
+        for (size_t idx = 0; idx < kDepartmentCount; ++idx) {
+            departments[idx].served_at_start = shared_state->stats.served[idx].load(std::memory_order_relaxed);
+        }
+    }
+
+    static std::string department_name(UrzednikRole role) {
+        return std::string(urzednik_role_to_string(role).value_or("?"));
+    }
+
+    bool Autoscaler::evaluate(const SharedState* shared_state, std::vector<process::UrzednikQueue>& queues) {
+        StateSnapshot clock = shared_state->snapshot();
+        if (clock.office_status != OfficeStatus::Open) {
+            window_open = false;
+            return false;
+        }
+        // The served counters are reset at rollover, so a window never spans two days
+        if (!window_open || clock.day != window_day || clock.simulated_time < window_start) {
+            start_window(shared_state, clock.day, clock.simulated_time);
+            return false;
+        }
+        uint32_t elapsed_min = (clock.simulated_time - window_start) / 60;
+        if (elapsed_min < kWindowMinutes) {
+            return false;
+        }
+
+        bool changed = false;
+        for (auto& queue : queues) {
+            auto idx = static_cast<size_t>(queue.role);
+            if (!scaled[idx]) {
+                continue;
+            }
+            Department& department = departments[idx];
+            int max_count = max_counts[idx];
+
+            ipc::msg::QueueStat queue_stat{};
+            if (ipc::msg::stat(queue.msg_id, &queue_stat) == -1) {
+                continue;
+            }
+            auto depth = static_cast<uint32_t>(queue_stat.messages);
+            uint32_t served = shared_state->stats.served[idx].load(std::memory_order_relaxed) -
+                              department.served_at_start;
+
+            // Minutes the last petent in the queue would wait at the throughput seen in this window
+            uint32_t wait_min = 0;
+            if (depth > 0) {
+                wait_min = served > 0 ? depth * elapsed_min / served : UINT32_MAX;
+            }
+
+            bool overloaded = depth > static_cast<uint32_t>(queue.count) && wait_min > kTargetWaitMinutes;
+            if (overloaded && queue.count < max_count) {
+                department.idle_windows = 0;
+                queue.count++;
+                changed = true;
+                Logger::log(LogSeverity::Notice, Identity::Dyrektor,
+                            "Wydzial " + department_name(queue.role) + ": " + std::to_string(queue.count - 1) +
+                                " -> " + std::to_string(queue.count) + " urzednikow (kolejka " +
+                                std::to_string(depth) + ", obsluzono " + std::to_string(served) + " w " +
+                                std::to_string(elapsed_min) + " min, szac. oczekiwanie " +
+                                (wait_min == UINT32_MAX ? std::string("brak obslugi") :
+                                                          std::to_string(wait_min) + " min") + ").");
+                continue;
+            }
+
+            department.idle_windows = depth == 0 ? department.idle_windows + 1 : 0;
+            if (department.idle_windows >= kIdleWindows && queue.count > 1) {
+                department.idle_windows = 0;
+                queue.count--;
+                changed = true;
+                Logger::log(LogSeverity::Notice, Identity::Dyrektor,
+                            "Wydzial " + department_name(queue.role) + ": " + std::to_string(queue.count + 1) +
+                                " -> " + std::to_string(queue.count) + " urzednikow (kolejka pusta przez " +
+                                std::to_string(kIdleWindows * kWindowMinutes) + " min).");
+            }
+        }
+
+        start_window(shared_state, clock.day, clock.simulated_time);
+        return changed;
+    }
+
+} // namespace staffing
@@ -0,0 +1,50 @@
+#ifndef SO_PROJEKT_DYREKTOR_STAFFING_H
+#define SO_PROJEKT_DYREKTOR_STAFFING_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "../common.h"
+#include "process.h"
+
+// Clerk autoscaler run from dyrektor's main loop. Every kWindowMinutes of opening hours it estimates how long a
+// petent joining each department's queue would wait (Little's law: queue depth over the clerks' throughput in the
+// window) and adds a clerk while that exceeds kTargetWaitMinutes, or retires one after the queue has stayed empty
+// for kIdleWindows windows. Only departments whose --urzednicy-max exceeds their starting staff are scaled, by one
+// clerk per window, between 1 and that maximum.
+namespace staffing {
+
+    constexpr uint32_t kWindowMinutes = 15;
+    constexpr uint32_t kTargetWaitMinutes = 30;
+    constexpr int kIdleWindows = 2;
+
+    class Autoscaler {
+    public:
+        Autoscaler(const ClerkCounts& start_counts, const ClerkCounts& max_counts);
+
+        // False when no department may grow past its starting staff, i.e. --urzednicy-max was not given
+        bool enabled() const;
+
+        // Updates queue.count of the departments whose staffing should change and logs why; returns true when any
+        // count changed, so the caller can apply them with process::staff_department()
+        bool evaluate(const SharedState* shared_state, std::vector<process::UrzednikQueue>& queues);
+
+    private:
+        struct Department {
+            uint32_t served_at_start;
+            int idle_windows;
+        };
+
+        void start_window(const SharedState* shared_state, uint32_t day, uint32_t simulated_time);
+
+        ClerkCounts max_counts;
+        std::array<bool, kDepartmentCount> scaled{};
+        std::array<Department, kDepartmentCount> departments{};
+        uint32_t window_day = 0;
+        uint32_t window_start = 0;
+        bool window_open = false;
+    };
+
+} // namespace staffing
+
+#endif // SO_PROJEKT_DYREKTOR_STAFFING_H
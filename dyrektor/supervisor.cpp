@@ -0,0 +1,186 @@
+#include "supervisor.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace supervisor {
+
+    constexpr int kMaxEvents = 32;
+
+    // epoll_event::data carries the source in the upper half and, for pidfds, the worker's pid in the lower one
+    static uint64_t pack(Wake kind, pid_t pid = 0) {
+        return (static_cast<uint64_t>(kind) << 32) | static_cast<uint32_t>(pid);
+    }
+
+    static int add_fd(int epoll_fd, int fd, uint64_t data) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = data;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            perror("epoll_ctl failed");
+            return -1;
+        }
+        return 0;
+    }
+
+    EventLoop::~EventLoop() {
+        for (const auto& [pid, fd] : pidfds) {
+            close(fd);
+        }
+        for (int fd : {timer_fd, ack_event_fd, event_fd, signal_fd, epoll_fd}) {
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+    }
+
+    int EventLoop::open(std::initializer_list<int> signals) {
+        sigset_t mask;
+        sigemptyset(&mask);
+        for (int sig : signals) {
+            sigaddset(&mask, sig);
+        }
+        int rc = pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+        if (rc != 0) {
+            errno = rc;
+            perror("pthread_sigmask failed");
+            return -1;
+        }
+
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+        event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        ack_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (epoll_fd == -1 || signal_fd == -1 || event_fd == -1 || ack_event_fd == -1 || timer_fd == -1) {
+            perror("supervisor fd creation failed");
+            return -1;
+        }
+
+        if (add_fd(epoll_fd, signal_fd, pack(Wake::Signal)) == -1 ||
+            add_fd(epoll_fd, event_fd, pack(Wake::Clock)) == -1 ||
+            add_fd(epoll_fd, ack_event_fd, pack(Wake::DayEndAck)) == -1 ||
+            add_fd(epoll_fd, timer_fd, pack(Wake::Tick)) == -1) {
+            return -1;
+        }
+        return 0;
+    }
+
+    int EventLoop::watch(pid_t pid) {
+        if (pid <= 0 || pidfds.count(pid) > 0) {
+            return 0;
+        }
+        // No glibc wrapper before 2.36
+        auto fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+        if (fd == -1) {
+            // ESRCH: already reaped by the SIGCHLD sweep, which also makes dyrektor forget it
+            if (errno != ESRCH) {
+                perror("pidfd_open failed");
+            }
+            return -1;
+        }
+        if (add_fd(epoll_fd, fd, pack(Wake::ChildExit, pid)) == -1) {
+            close(fd);
+            return -1;
+        }
+        pidfds[pid] = fd;
+        return 0;
+    }
+
+    void EventLoop::unwatch(pid_t pid) {
+        auto it = pidfds.find(pid);
+        if (it == pidfds.end()) {
+            return;
+        }
+        // Closing the last reference to the fd removes it from the epoll set
+        close(it->second);
+        pidfds.erase(it);
+    }
+
+    int EventLoop::set_tick(uint32_t interval_ms) {
+        if (interval_ms == tick_ms) {
+            return 0;
+        }
+        itimerspec spec{};
+        spec.it_interval.tv_sec = interval_ms / 1000;
+        spec.it_interval.tv_nsec = static_cast<long>(interval_ms % 1000) * 1'000'000;
+        spec.it_value = spec.it_interval;
+        if (timerfd_settime(timer_fd, 0, &spec, nullptr) == -1) {
+            perror("timerfd_settime failed");
+            return -1;
+        }
+        tick_ms = interval_ms;
+        return 0;
+    }
+
+    int EventLoop::wait(std::vector<Event>& events, int timeout_ms) {
+        events.clear();
+        epoll_event ready[kMaxEvents];
+        int count = epoll_wait(epoll_fd, ready, kMaxEvents, timeout_ms);
+        if (count == -1) {
+            if (errno == EINTR) {
+                return 0;
+            }
+            perror("epoll_wait failed");
+            return -1;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            auto kind = static_cast<Wake>(ready[i].data.u64 >> 32);
+            switch (kind) {
+                case Wake::Signal: {
+                    signalfd_siginfo info{};
+                    while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                        events.push_back({Wake::Signal, static_cast<int>(info.ssi_signo), 0});
+                    }
+                    break;
+                }
+                case Wake::Clock: {
+                    uint64_t value = 0;
+                    if (read(event_fd, &value, sizeof(value)) == sizeof(value)) {
+                        events.push_back({Wake::Clock, 0, 0});
+                    }
+                    break;
+                }
+                case Wake::DayEndAck: {
+                    uint64_t acks = 0;
+                    if (read(ack_event_fd, &acks, sizeof(acks)) == sizeof(acks)) {
+                        events.push_back({Wake::DayEndAck, 0, 0});
+                    }
+                    break;
+                }
+                case Wake::Tick: {
+                    uint64_t expirations = 0;
+                    if (read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                        events.push_back({Wake::Tick, 0, 0});
+                    }
+                    break;
+                }
+                case Wake::ChildExit: {
+                    auto pid = static_cast<pid_t>(ready[i].data.u64 & 0xffffffffu);
+                    unwatch(pid);
+                    events.push_back({Wake::ChildExit, 0, pid});
+                    break;
+                }
+            }
+        }
+        return static_cast<int>(events.size());
+    }
+
+    void notify_clock_change(int fd) {
+        if (fd == -1) {
+            return;
+        }
+        uint64_t one = 1;
+        if (write(fd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+            perror("eventfd write failed");
+        }
+    }
+
+} // namespace supervisor
@@ -0,0 +1,74 @@
+#ifndef SO_PROJEKT_DYREKTOR_SUPERVISOR_H
+#define SO_PROJEKT_DYREKTOR_SUPERVISOR_H
+
+#include <cstdint>
+#include <initializer_list>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+// Event sources of dyrektor's main loop, multiplexed with one epoll instance: a signalfd for the shutdown signals
+// and SIGCHLD, a pidfd per worker, an eventfd the clock thread writes on opening, closing and day end, an eventfd the
+// workers write when they acknowledge a day end, and a timerfd ticking the autoscalers while the office is open. The
+// loop sleeps in epoll_wait between events and uses no CPU while nothing happens.
+namespace supervisor {
+
+    enum class Wake : uint8_t {
+        Signal, // `signal` was read from the signalfd
+        Clock, // the clock thread changed the office status or the day
+        Tick, // autoscaling timer
+        ChildExit, // the watched worker `pid` has exited (not yet reaped)
+        DayEndAck, // at least one worker has counted itself in SharedState::day_end_acks
+    };
+
+    struct Event {
+        Wake kind;
+        int signal;
+        pid_t pid;
+    };
+
+    class EventLoop {
+    public:
+        EventLoop() = default;
+        ~EventLoop();
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        // Blocks `signals` in the calling thread, so threads started afterwards inherit the mask, and reads them from
+        // a signalfd instead; children get an empty mask back before exec (see process.cpp)
+        int open(std::initializer_list<int> signals);
+
+        // eventfd for notify_clock_change()
+        int clock_fd() const { return event_fd; }
+
+        // eventfd for the workers' day-end acks; process.cpp hands it to the workers only, across their exec
+        int ack_fd() const { return ack_event_fd; }
+
+        // Starts watching a worker through a pidfd; pids already watched are skipped
+        int watch(pid_t pid);
+
+        // Arms the autoscaling timer with the given period, or disarms it for 0
+        int set_tick(uint32_t interval_ms);
+
+        // Sleeps until at least one event is ready (or timeout_ms passes, -1 waits forever) and replaces `events`
+        // with them; a signal interrupting the wait gives an empty list
+        int wait(std::vector<Event>& events, int timeout_ms = -1);
+
+    private:
+        void unwatch(pid_t pid);
+
+        int epoll_fd = -1;
+        int signal_fd = -1;
+        int event_fd = -1;
+        int ack_event_fd = -1;
+        int timer_fd = -1;
+        uint32_t tick_ms = 0;
+        std::unordered_map<pid_t, int> pidfds;
+    };
+
+    // Clock thread side of EventLoop::clock_fd()
+    void notify_clock_change(int fd);
+
+} // namespace supervisor
+
+#endif // SO_PROJEKT_DYREKTOR_SUPERVISOR_H
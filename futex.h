@@ -0,0 +1,195 @@
+#ifndef SO_PROJEKT_FUTEX_H
+#define SO_PROJEKT_FUTEX_H
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace ipc {
+
+    // Raw futex operations on 32-bit words living in shared memory (process-shared, no FUTEX_PRIVATE_FLAG)
+    namespace futex {
+        static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain 32-bit int");
+        static_assert(std::atomic<uint32_t>::is_always_lock_free, "futex word must be lock-free");
+
+        // Returns 0 when woken (or value already changed), 1 on timeout, -1 on error (EINTR included)
+        inline int wait(std::atomic<uint32_t>* word, uint32_t expected, const timespec* rel_timeout = nullptr) {
+            long rc = syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, rel_timeout,
+                              nullptr, 0);
+            if (rc == -1) {
+                if (errno == EAGAIN) {
+                    return 0;
+                }
+                if (errno == ETIMEDOUT) {
+                    return 1;
+                }
+                if (errno != EINTR) {
+                    perror("futex wait failed");
+                }
+                return -1;
+            }
+            return 0;
+        }
+
+        inline int wake(std::atomic<uint32_t>* word, int count = INT32_MAX) {
+            long rc = syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, count, nullptr, nullptr, 0);
+            if (rc == -1) {
+                perror("futex wake failed");
+                return -1;
+            }
+            return static_cast<int>(rc);
+        }
+
+        inline timespec millis(long ms) {
+            timespec ts{};
+            ts.tv_sec = ms / 1000;
+            ts.tv_nsec = (ms % 1000) * 1'000'000L;
+            return ts;
+        }
+    } // namespace futex
+
+    // Process-shared synchronization objects built on futex; they live inside shared memory (SharedState) and are
+    // initialized once by dyrektor. Uncontended paths are a single atomic, the kernel is entered only to sleep or
+    // to wake sleepers. Blocking calls return -1 with EINTR when a signal arrives, like semop() without SA_RESTART.
+    namespace sync {
+
+        // Counting semaphore with multi-unit acquire, so several units (a petent and its child) are taken at once
+        struct Semaphore {
+            std::atomic<uint32_t> value;
+            std::atomic<uint32_t> waiters;
+            std::atomic<uint32_t> wide_waiters; // sleepers that need more than one unit
+
+            void reset(uint32_t units) {
+                value.store(units, std::memory_order_seq_cst);
+                if (waiters.load(std::memory_order_seq_cst) != 0) {
+                    futex::wake(&value);
+                }
+            }
+
+            uint32_t available() const { return value.load(std::memory_order_relaxed); }
+
+            bool try_acquire(uint32_t units) {
+                uint32_t current = value.load(std::memory_order_relaxed);
+                while (current >= units) {
+                    if (value.compare_exchange_weak(current, current - units, std::memory_order_acquire,
+                                                    std::memory_order_relaxed)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            // Blocks until `units` are free and takes them all; -1 with EINTR when interrupted
+            int acquire(uint32_t units = 1) {
+                bool woken = false;
+                while (!try_acquire(units)) {
+                    uint32_t observed = value.load(std::memory_order_seq_cst);
+                    if (observed >= units) {
+                        continue;
+                    }
+                    // A wide waiter woken for too few units hands the wakeup on to a single-unit sleeper, otherwise
+                    // the free unit would stay unused until the next release
+                    if (woken && observed != 0 &&
+                        waiters.load(std::memory_order_seq_cst) > wide_waiters.load(std::memory_order_seq_cst)) {
+                        futex::wake(&value, 1);
+                    }
+                    waiters.fetch_add(1, std::memory_order_seq_cst);
+                    if (units > 1) {
+                        wide_waiters.fetch_add(1, std::memory_order_seq_cst);
+                    }
+                    int rc = futex::wait(&value, observed);
+                    int err = errno;
+                    if (units > 1) {
+                        wide_waiters.fetch_sub(1, std::memory_order_seq_cst);
+                    }
+                    waiters.fetch_sub(1, std::memory_order_seq_cst);
+                    if (rc == -1) {
+                        errno = err;
+                        return -1;
+                    }
+                    woken = units > 1;
+                }
+                return 0;
+            }
+
+            void release(uint32_t units = 1) {
+                value.fetch_add(units, std::memory_order_seq_cst);
+                if (waiters.load(std::memory_order_seq_cst) != 0) {
+                    futex::wake(&value, static_cast<int>(units));
+                }
+            }
+        };
+
+        // Three-state futex mutex (0 unlocked, 1 locked, 2 locked with sleepers), after Drepper's "Futexes Are
+        // Tricky". Not robust: a holder killed inside the critical section leaves it locked.
+        struct Mutex {
+            std::atomic<uint32_t> state;
+
+            void init() { state.store(0, std::memory_order_relaxed); }
+
+            bool try_lock() {
+                uint32_t expected = 0;
+                return state.compare_exchange_strong(expected, 1, std::memory_order_acquire);
+            }
+
+            void lock() {
+                uint32_t current = 0;
+                if (state.compare_exchange_strong(current, 1, std::memory_order_acquire)) {
+                    return;
+                }
+                if (current != 2) {
+                    current = state.exchange(2, std::memory_order_acquire);
+                }
+                while (current != 0) {
+                    futex::wait(&state, 2); // EINTR just retries: a lock is not a cancellation point here
+                    current = state.exchange(2, std::memory_order_acquire);
+                }
+            }
+
+            void unlock() {
+                if (state.fetch_sub(1, std::memory_order_release) != 1) {
+                    state.store(0, std::memory_order_release);
+                    futex::wake(&state, 1);
+                }
+            }
+        };
+
+        // Manual-reset event: wait() returns while it is set; set() wakes every waiter
+        struct Event {
+            std::atomic<uint32_t> state;
+
+            void init(bool initially_set) { state.store(initially_set ? 1 : 0, std::memory_order_relaxed); }
+
+            bool is_set() const { return state.load(std::memory_order_acquire) != 0; }
+
+            void set() {
+                if (state.exchange(1, std::memory_order_release) == 0) {
+                    futex::wake(&state);
+                }
+            }
+
+            void reset() { state.store(0, std::memory_order_release); }
+
+            // 0 once set, 1 on timeout, -1 with EINTR when interrupted
+            int wait(const timespec* rel_timeout = nullptr) const {
+                while (!is_set()) {
+                    int rc = futex::wait(const_cast<std::atomic<uint32_t>*>(&state), 0, rel_timeout);
+                    if (rc != 0) {
+                        return rc;
+                    }
+                }
+                return 0;
+            }
+        };
+
+    } // namespace sync
+
+} // namespace ipc
+
+#endif // SO_PROJEKT_FUTEX_H
@@ -1,19 +1,27 @@
 #ifndef SO_PROJEKT_IPCUTILS_H
 #define SO_PROJEKT_IPCUTILS_H
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <cstdio>
 #include <cerrno>
 #include <ctime>
 #include <csignal>
+#include <cstdlib>
 #include <initializer_list>
+#include <string>
 #include <pthread.h>
 #include <sys/ipc.h>
 #include <sys/msg.h>
-#include <sys/sem.h>
 #include <sys/shm.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
 #include "common.h"
+#include "futex.h"
+#include "posixmq.h"
+#include "shmqueue.h"
 
 namespace ipc {
 
@@ -30,6 +38,19 @@ namespace ipc {
         return 0;
     }
 
+    // Same, for a handler that needs the siginfo_t (sender, sigqueue() payload)
+    inline int install_signal_info_handler(int signum, void (*handler)(int, siginfo_t*, void*)) {
+        struct sigaction sa = {};
+        sa.sa_sigaction = handler;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = SA_SIGINFO; // w/o SA_RESTART
+        if (sigaction(signum, &sa, nullptr) == -1) {
+            perror("sigaction failed");
+            return -1;
+        }
+        return 0;
+    }
+
     // Block given signals in the current thread
     inline int block_signals(std::initializer_list<int> signals) {
         sigset_t mask;
@@ -46,18 +67,48 @@ namespace ipc {
         return 0;
     }
 
+    inline uint64_t monotonic_ns() {
+        timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000ULL + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    // writev() until every iovec is fully written; advances the iovec array in place
+    inline int write_all(int fd, iovec* iov, int count) {
+        while (count > 0) {
+            ssize_t written = writev(fd, iov, count);
+            if (written == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            while (count > 0 && static_cast<size_t>(written) >= iov->iov_len) {
+                written -= static_cast<ssize_t>(iov->iov_len);
+                iov++;
+                count--;
+            }
+            if (count > 0) {
+                iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+                iov->iov_len -= static_cast<size_t>(written);
+            }
+        }
+        return 0;
+    }
+
     constexpr const char* IPC_LOCK_FILE = "/tmp/so_projekt_ipc.lock"; // Must be created by Director at startup!
 
     enum class KeyType : int {
         SharedState = 'S',
-        SemaphoreSet = 'M',
         MsgQueueRejestracja = 'R',
         MsgQueueSA = 'A',
         MsgQueueSC = 'C',
         MsgQueueKM = 'K',
         MsgQueueML = 'L',
         MsgQueuePD = 'P',
-        MsgQueueKasa = '$'
+        MsgQueueKasa = '$',
+        LogShared = 'G',
+        MsgQueueReply = '0' // first reply shard; shard i uses '0' + i
     };
 
     // Generate SysV IPC key using ftok()
@@ -70,6 +121,15 @@ namespace ipc {
         return key;
     }
 
+    inline key_t make_reply_key(size_t shard) {
+        key_t key = ftok(IPC_LOCK_FILE, static_cast<int>(KeyType::MsgQueueReply) + static_cast<int>(shard));
+        if (key == -1) {
+            perror("ftok failed");
+            return -1;
+        }
+        return key;
+    }
+
     // Shared memory
     namespace shm {
 
@@ -126,6 +186,9 @@ namespace ipc {
     } // namespace shm
 
     // Message queues
+    // Every queue goes through one of three transports, chosen once per process: SysV msg queues (default),
+    // the shared-memory rings from shmqueue.h or POSIX mqueues from posixmq.h. Queue ids are msqids, shmq
+    // handles or pmq handles respectively.
     namespace msg {
 
         template <typename T>
@@ -134,7 +197,19 @@ namespace ipc {
             T data;
         };
 
+        inline MsgTransport transport = MsgTransport::SysV;
+
+        inline void set_transport(MsgTransport value) { transport = value; }
+
+        inline MsgTransport get_transport() { return transport; }
+
         inline int create(key_t key, mode_t permissions = 0660) {
+            if (transport == MsgTransport::Shm) {
+                return shmq::create(key, permissions);
+            }
+            if (transport == MsgTransport::Posix) {
+                return pmq::create(key, permissions);
+            }
             int msqid = msgget(key, IPC_CREAT | IPC_EXCL | permissions);
             if (msqid == -1) {
                 int err = errno;
@@ -146,6 +221,12 @@ namespace ipc {
         }
 
         inline int get(key_t key) {
+            if (transport == MsgTransport::Shm) {
+                return shmq::get(key);
+            }
+            if (transport == MsgTransport::Posix) {
+                return pmq::get(key);
+            }
             int msqid = msgget(key, 0);
             if (msqid == -1) {
                 perror("msgget failed");
@@ -156,6 +237,22 @@ namespace ipc {
 
         template <typename T>
         int send(int msqid, long msg_type, const T& data, int flags = 0) {
+            if (transport == MsgTransport::Shm) {
+                static_assert(sizeof(T) <= shmq::kMaxPayload, "message does not fit a shmq cell");
+                if (shmq::send(msqid, msg_type, &data, sizeof(T), flags) == -1) {
+                    perror("shmq send failed");
+                    return -1;
+                }
+                return 0;
+            }
+            if (transport == MsgTransport::Posix) {
+                static_assert(sizeof(T) <= pmq::kMaxPayload, "message does not fit a pmq frame");
+                if (pmq::send(msqid, msg_type, &data, sizeof(T), flags) == -1) {
+                    perror("mq_send failed");
+                    return -1;
+                }
+                return 0;
+            }
             MsgEnvelope<T> msg{msg_type, data};
             if (msgsnd(msqid, &msg, sizeof(T), flags) == -1) {
                 perror("msgsnd failed");
@@ -166,6 +263,26 @@ namespace ipc {
 
         template <typename T>
         int receive(int msqid, long msg_type, T* data, int flags = 0) {
+            if (transport == MsgTransport::Shm) {
+                static_assert(sizeof(T) <= shmq::kMaxPayload, "message does not fit a shmq cell");
+                if (shmq::receive(msqid, msg_type, data, sizeof(T), flags) == -1) {
+                    if (errno != EINTR && !((flags & IPC_NOWAIT) && errno == ENOMSG)) {
+                        perror("shmq receive failed");
+                    }
+                    return -1;
+                }
+                return 0;
+            }
+            if (transport == MsgTransport::Posix) {
+                static_assert(sizeof(T) <= pmq::kMaxPayload, "message does not fit a pmq frame");
+                if (pmq::receive(msqid, msg_type, data, sizeof(T), flags) == -1) {
+                    if (errno != EINTR && !((flags & IPC_NOWAIT) && errno == ENOMSG)) {
+                        perror("mq_receive failed");
+                    }
+                    return -1;
+                }
+                return 0;
+            }
             MsgEnvelope<T> msg{};
             if (msgrcv(msqid, &msg, sizeof(T), msg_type, flags) == -1) {
                 if (errno == EINTR) {
@@ -182,103 +299,137 @@ namespace ipc {
             return 0;
         }
 
-        inline int remove(int msqid) {
-            if (msgctl(msqid, IPC_RMID, nullptr) == -1) {
-                perror("msgctl IPC_RMID failed");
+        // Blocks (unless IPC_NOWAIT) for the first message, then takes up to max_count - 1 more that are already
+        // queued. Returns the number of messages stored in data, or -1 when not even the first one arrived.
+        template <typename T>
+        int receive_batch(int msqid, long msg_type, T* data, size_t max_count, int flags = 0) {
+            if (max_count == 0) {
+                return 0;
+            }
+            if (transport == MsgTransport::Shm) {
+                static_assert(sizeof(T) <= shmq::kMaxPayload, "message does not fit a shmq cell");
+                int count = shmq::receive_batch(msqid, msg_type, data, sizeof(T), max_count, flags);
+                if (count == -1 && errno != EINTR && !((flags & IPC_NOWAIT) && errno == ENOMSG)) {
+                    perror("shmq receive failed");
+                }
+                return count;
+            }
+            if (transport == MsgTransport::Posix) {
+                static_assert(sizeof(T) <= pmq::kMaxPayload, "message does not fit a pmq frame");
+                int count = pmq::receive_batch(msqid, msg_type, data, sizeof(T), max_count, flags);
+                if (count == -1 && errno != EINTR && !((flags & IPC_NOWAIT) && errno == ENOMSG)) {
+                    perror("mq_receive failed");
+                }
+                return count;
+            }
+            if (receive<T>(msqid, msg_type, &data[0], flags) == -1) {
                 return -1;
             }
-            return 0;
+            size_t count = 1;
+            MsgEnvelope<T> msg{};
+            while (count < max_count) {
+                if (msgrcv(msqid, &msg, sizeof(T), msg_type, flags | IPC_NOWAIT) == -1) {
+                    if (errno != ENOMSG && errno != EINTR) {
+                        perror("msgrcv failed");
+                    }
+                    break;
+                }
+                data[count++] = msg.data;
+            }
+            return static_cast<int>(count);
         }
 
-    } // namespace msg
-
-    // Semaphores
-    namespace sem {
+        // Sends the messages in order; returns how many were sent before the first failure (errno is kept)
+        template <typename T>
+        size_t send_batch(int msqid, const MsgEnvelope<T>* msgs, size_t count, int flags = 0) {
+            for (size_t i = 0; i < count; ++i) {
+                int rc = 0;
+                if (transport == MsgTransport::Shm) {
+                    static_assert(sizeof(T) <= shmq::kMaxPayload, "message does not fit a shmq cell");
+                    rc = shmq::send(msqid, msgs[i].mtype, &msgs[i].data, sizeof(T), flags);
+                }
+                else if (transport == MsgTransport::Posix) {
+                    static_assert(sizeof(T) <= pmq::kMaxPayload, "message does not fit a pmq frame");
+                    rc = pmq::send(msqid, msgs[i].mtype, &msgs[i].data, sizeof(T), flags);
+                }
+                else {
+                    rc = msgsnd(msqid, &msgs[i], sizeof(T), flags);
+                }
+                if (rc == -1) {
+                    int err = errno;
+                    perror(transport == MsgTransport::Shm     ? "shmq send failed"
+                           : transport == MsgTransport::Posix ? "mq_send failed"
+                                                              : "msgsnd failed");
+                    errno = err;
+                    return i;
+                }
+            }
+            return count;
+        }
 
-        // POSIX.1 expects a semun union for semctl
-        // See: man semctl(2)
-        union Semun {
-            int val;
-            struct semid_ds* buf;
-            unsigned short* array;
+        struct QueueStat {
+            uint64_t messages; // msg_qnum
+            uint64_t bytes; // msg_cbytes
         };
 
-        inline int create(key_t key, int nsems = 1, mode_t permissions = 0660) {
-            int semid = semget(key, nsems, IPC_CREAT | IPC_EXCL | permissions);
-            if (semid == -1) {
-                int err = errno;
-                perror("semget failed");
-                errno = err;
-                return -1;
+        // Current depth of a queue: msgctl(IPC_STAT) for SysV, a scan of the rings for shm, mq_getattr() for posix
+        inline int stat(int msqid, QueueStat* out) {
+            if (transport == MsgTransport::Shm) {
+                return shmq::stat(msqid, &out->messages, &out->bytes);
             }
-            return semid;
-        }
-
-        inline int get(key_t key, int nsems = 1) {
-            int semid = semget(key, nsems, 0);
-            if (semid == -1) {
-                perror("semget failed");
-                return -1;
+            if (transport == MsgTransport::Posix) {
+                return pmq::stat(msqid, &out->messages, &out->bytes);
             }
-            return semid;
-        }
-
-        inline int set_val(int semid, int sem_num, int value) {
-            Semun arg{};
-            arg.val = value;
-            if (semctl(semid, sem_num, SETVAL, arg) == -1) {
-                perror("semctl SETVAL failed");
+            msqid_ds info{};
+            if (msgctl(msqid, IPC_STAT, &info) == -1) {
+                perror("msgctl IPC_STAT failed");
                 return -1;
             }
+            out->messages = info.msg_qnum;
+            out->bytes = info.msg_cbytes;
             return 0;
         }
 
-        inline int get_val(int semid, int sem_num) {
-            int val = semctl(semid, sem_num, GETVAL);
-            if (val == -1) {
-                perror("semctl GETVAL failed");
-                return -1;
+        // Discard every pending message, whatever its type and size
+        inline void drain(int msqid) {
+            if (transport == MsgTransport::Shm) {
+                shmq::drain(msqid);
+                return;
             }
-            return val;
-        }
-
-        inline int set_all(int semid, unsigned short* values) {
-            Semun arg{};
-            arg.array = values;
-            if (semctl(semid, 0, SETALL, arg) == -1) {
-                perror("semctl SETALL failed");
-                return -1;
+            if (transport == MsgTransport::Posix) {
+                pmq::drain(msqid);
+                return;
+            }
+            struct { long mtype; char data[256]; } buf;
+            while (msgrcv(msqid, &buf, sizeof(buf.data), 0, IPC_NOWAIT | MSG_NOERROR) != -1) {
+                // keep draining
             }
-            return 0;
         }
 
-        inline int op(int semid, unsigned short sem_num, short sem_op, short sem_flg = 0) {
-            sembuf sb{};
-            sb.sem_num = sem_num;
-            sb.sem_op = sem_op;
-            sb.sem_flg = sem_flg;
-            if (semop(semid, &sb, 1) == -1) {
-                perror("semop failed");
-                return -1;
+        // Sets up what a handle would otherwise open on first use (posix lanes), so threads of one process can
+        // share it; SysV ids and shm rings need nothing
+        inline int preopen(int msqid) {
+            if (transport == MsgTransport::Posix) {
+                return pmq::open_lanes(msqid);
             }
             return 0;
         }
 
-        inline int wait(int semid, unsigned short sem_num, short sem_flg = 0) {
-            return op(semid, sem_num, -1, sem_flg);
-        }
-
-        inline int post(int semid, unsigned short sem_num, short sem_flg = 0) { return op(semid, sem_num, 1, sem_flg); }
-
-        inline int remove(int semid) {
-            if (semctl(semid, 0, IPC_RMID) == -1) {
-                perror("semctl IPC_RMID failed");
+        inline int remove(int msqid) {
+            if (transport == MsgTransport::Shm) {
+                return shmq::remove(msqid);
+            }
+            if (transport == MsgTransport::Posix) {
+                return pmq::remove(msqid);
+            }
+            if (msgctl(msqid, IPC_RMID, nullptr) == -1) {
+                perror("msgctl IPC_RMID failed");
                 return -1;
             }
             return 0;
         }
 
-    } // namespace sem
+    } // namespace msg
 
     namespace mutex {
         inline int init(pthread_mutex_t* mutex, bool process_shared = false) {
@@ -486,19 +637,20 @@ namespace ipc {
 } // namespace ipc
 
 namespace ipc::helper {
-    inline int create_or_reset_shm(key_t key) {
-        int shm_id = shm::create<SharedState>(key);
+    template <typename T = SharedState>
+    int create_or_reset_shm(key_t key) {
+        int shm_id = shm::create<T>(key);
         if (shm_id != -1) {
             return shm_id;
         }
         if (errno != EEXIST) {
             return -1;
         }
-        int old_id = shm::get<SharedState>(key);
+        int old_id = shmget(key, 0, 0); // size may differ from a previous build
         if (old_id != -1) {
             shm::remove(old_id);
         }
-        return shm::create<SharedState>(key);
+        return shm::create<T>(key);
     }
 
     inline int create_or_reset_msg(key_t key) {
@@ -509,6 +661,14 @@ namespace ipc::helper {
         if (errno != EEXIST) {
             return -1;
         }
+        if (msg::get_transport() == MsgTransport::Shm) {
+            shmq::unlink(key); // a leftover segment may have a different layout, so it is not attached
+            return msg::create(key);
+        }
+        if (msg::get_transport() == MsgTransport::Posix) {
+            pmq::unlink(key);
+            return msg::create(key);
+        }
         int old_id = msg::get(key);
         if (old_id != -1) {
             msg::remove(old_id);
@@ -516,21 +676,6 @@ namespace ipc::helper {
         return msg::create(key);
     }
 
-    inline int create_or_reset_sem(key_t key, int nsems) {
-        int sem_id = sem::create(key, nsems);
-        if (sem_id != -1) {
-            return sem_id;
-        }
-        if (errno != EEXIST) {
-            return -1;
-        }
-        int old_id = sem::get(key, nsems);
-        if (old_id != -1) {
-            sem::remove(old_id);
-        }
-        return sem::create(key, nsems);
-    }
-
     inline KeyType role_to_key(UrzednikRole role) {
         switch (role) {
             case UrzednikRole::SA:
@@ -548,48 +693,162 @@ namespace ipc::helper {
         }
     }
 
-    inline int get_role_queue(UrzednikRole role) {
-        key_t key = make_key(role_to_key(role));
-        if (key == -1) {
-            return -1;
+    // Segment ids handed down to spawned processes through the environment (inherited across fork/exec),
+    // so children attach the shared state and the log segment without ftok() + shmget()
+    constexpr const char* kStateShmEnv = "SO_PROJEKT_STATE_SHM";
+    constexpr const char* kLogShmEnv = "SO_PROJEKT_LOG_SHM";
+    constexpr const char* kArrivalEnv = "SO_PROJEKT_ARRIVAL_NS"; // ipc::monotonic_ns() of the generator's arrival
+
+    inline void publish_shm_id(const char* name, int shm_id) {
+        if (setenv(name, std::to_string(shm_id).c_str(), 1) == -1) {
+            perror("setenv failed");
         }
-        return msg::get(key);
     }
 
-    inline SharedState* get_shared_state(bool readonly, int* shm_id_out = nullptr) {
-        key_t key = make_key(KeyType::SharedState);
-        if (key == -1) {
-            return nullptr;
+    // Returns -1 when the variable is missing (e.g. a role started by hand)
+    inline int inherited_shm_id(const char* name) {
+        const char* value = getenv(name);
+        if (value == nullptr || *value == '\0') {
+            return -1;
         }
-        int shm_id = shm::get<SharedState>(key);
-        if (shm_id == -1) {
-            return nullptr;
+        char* end = nullptr;
+        long shm_id = std::strtol(value, &end, 10);
+        if (*end != '\0' || shm_id < 0) {
+            return -1;
         }
-        auto shared_state = shm::attach<SharedState>(shm_id, readonly);
-        if (!shared_state) {
+        return static_cast<int>(shm_id);
+    }
+
+    // 0 when the petent was not started by the generator
+    inline uint64_t inherited_arrival_ns() {
+        const char* value = getenv(kArrivalEnv);
+        if (value == nullptr || *value == '\0') {
+            return 0;
+        }
+        char* end = nullptr;
+        unsigned long long arrival_ns = std::strtoull(value, &end, 10);
+        return *end == '\0' ? static_cast<uint64_t>(arrival_ns) : 0;
+    }
+
+    // Process-local copy of SharedState::registry, taken by get_shared_state()
+    inline IpcRegistry registry{0, {}, {}, {}, {}};
+
+    inline bool has_registry() { return registry.published != 0; }
+
+    inline const MsgEndpoint* registry_endpoint(KeyType type) {
+        if (!has_registry()) {
             return nullptr;
         }
-        if (shm_id_out != nullptr) {
-            *shm_id_out = shm_id;
+        switch (type) {
+            case KeyType::MsgQueueRejestracja:
+                return &registry.rejestracja;
+            case KeyType::MsgQueueKasa:
+                return &registry.kasa;
+            case KeyType::MsgQueueSC:
+                return &registry.departments[static_cast<size_t>(UrzednikRole::SC)];
+            case KeyType::MsgQueueKM:
+                return &registry.departments[static_cast<size_t>(UrzednikRole::KM)];
+            case KeyType::MsgQueueML:
+                return &registry.departments[static_cast<size_t>(UrzednikRole::ML)];
+            case KeyType::MsgQueuePD:
+                return &registry.departments[static_cast<size_t>(UrzednikRole::PD)];
+            case KeyType::MsgQueueSA:
+                return &registry.departments[static_cast<size_t>(UrzednikRole::SA)];
+            default:
+                return nullptr;
         }
-        return shared_state;
     }
 
-    inline int get_semaphore_set(int nsems = 2) {
-        key_t key = make_key(KeyType::SemaphoreSet);
+    // Dyrektor side: what children need to reach a queue created in this process
+    inline MsgEndpoint make_endpoint(key_t key, int msg_id) {
+        // pmq lanes are named after the key, so the id only matters for SysV and shm
+        int id = msg::get_transport() == MsgTransport::Shm ? shmq::segment_id(msg_id) : msg_id;
+        return {key, id};
+    }
+
+    inline int get_msg_queue(KeyType type) {
+        if (const MsgEndpoint* endpoint = registry_endpoint(type)) {
+            if (msg::get_transport() == MsgTransport::Shm) {
+                return shmq::open(endpoint->key, endpoint->id);
+            }
+            if (msg::get_transport() == MsgTransport::Posix) {
+                return pmq::open(endpoint->key);
+            }
+            return endpoint->id;
+        }
+        key_t key = make_key(type);
         if (key == -1) {
             return -1;
         }
-        return sem::get(key, nsems);
+        return msg::get(key);
     }
 
-    inline int get_msg_queue(KeyType type) {
-        key_t key = make_key(type);
+    inline int get_role_queue(UrzednikRole role) { return get_msg_queue(role_to_key(role)); }
+
+    // The shm transport already picks a petent's mailbox bucket by petent_id % kMailboxBuckets; the shard comes from
+    // the bits above those, so every shard spreads over all of its buckets
+    inline size_t reply_shard(uint32_t petent_id) { return (petent_id / shmq::kMailboxBuckets) % kReplyShardCount; }
+
+    inline int get_reply_queue(size_t shard) {
+        if (has_registry()) {
+            const MsgEndpoint& endpoint = registry.replies[shard];
+            if (msg::get_transport() == MsgTransport::Shm) {
+                return shmq::open(endpoint.key, endpoint.id);
+            }
+            if (msg::get_transport() == MsgTransport::Posix) {
+                return pmq::open(endpoint.key);
+            }
+            return endpoint.id;
+        }
+        key_t key = make_reply_key(shard);
         if (key == -1) {
             return -1;
         }
         return msg::get(key);
     }
+
+    // Reply routing: the message goes to the petent's shard with mtype = petent pid
+    template <typename T>
+    int send_reply(uint32_t petent_id, const T& data, int flags = 0) {
+        int msg_id = get_reply_queue(reply_shard(petent_id));
+        if (msg_id == -1) {
+            return -1;
+        }
+        return msg::send<T>(msg_id, static_cast<long>(petent_id), data, flags);
+    }
+
+    template <typename T>
+    int receive_reply(uint32_t petent_id, T* data, int flags = 0) {
+        int msg_id = get_reply_queue(reply_shard(petent_id));
+        if (msg_id == -1) {
+            return -1;
+        }
+        return msg::receive<T>(msg_id, static_cast<long>(petent_id), data, flags);
+    }
+
+    inline SharedState* get_shared_state(bool readonly, int* shm_id_out = nullptr) {
+        int shm_id = inherited_shm_id(kStateShmEnv);
+        if (shm_id == -1) {
+            key_t key = make_key(KeyType::SharedState);
+            if (key == -1) {
+                return nullptr;
+            }
+            shm_id = shm::get<SharedState>(key);
+            if (shm_id == -1) {
+                return nullptr;
+            }
+        }
+        auto shared_state = shm::attach<SharedState>(shm_id, readonly);
+        if (!shared_state) {
+            return nullptr;
+        }
+        msg::set_transport(shared_state->msg_transport);
+        registry = shared_state->registry;
+        if (shm_id_out != nullptr) {
+            *shm_id_out = shm_id;
+        }
+        return shared_state;
+    }
 } // namespace ipc::helper
 
 
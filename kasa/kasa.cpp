@@ -6,6 +6,7 @@
 #include <string>
 #include <thread>
 #include <unistd.h>
+#include "../dayshift.h"
 #include "../ipcutils.h"
 #include "../logger.h"
 
@@ -28,15 +29,20 @@ static void payment_delay(int time_mul) {
     std::this_thread::sleep_for(std::chrono::milliseconds(scaled_ms));
 }
 
-int kasa_main() {
+int kasa_main(int window) {
     ipc::install_signal_handler(SIGTERM, handle_shutdown_signal);
     ipc::install_signal_handler(SIGUSR1, handle_finish_signal);
+    dayshift::install_day_end_handler();
     signal(SIGINT, SIG_IGN);
     signal(SIGUSR2, SIG_IGN);
 
-    Logger::log(LogSeverity::Info, Identity::Kasa, "Kasa uruchomiona.");
+    Logger::log<LogSeverity::Info>(Identity::Kasa, "Kasa uruchomiona.");
+    Logger::log<LogSeverity::Info>(Identity::Kasa,
+                                   [&] { return "Okienko kasy " + std::to_string(window) + " otwarte."; });
+    auto slot = static_cast<size_t>(window - 1);
 
-    auto shared_state = ipc::helper::get_shared_state(true);
+    // Writable for the day rollover acknowledgement
+    auto shared_state = ipc::helper::get_shared_state(false);
     if (!shared_state) {
         return 1;
     }
@@ -48,14 +54,27 @@ int kasa_main() {
         return 1;
     }
 
-    int msg_req_id = ipc::helper::get_msg_queue(ipc::KeyType::MsgQueueRejestracja);
-    if (msg_req_id == -1) {
-        Logger::log(LogSeverity::Err, Identity::Kasa, "Nie znaleziono kolejki rejestracji.");
-        ipc::shm::detach(shared_state);
-        return 1;
+    for (size_t shard = 0; shard < kReplyShardCount; ++shard) {
+        if (ipc::helper::get_reply_queue(shard) == -1) {
+            Logger::log(LogSeverity::Err, Identity::Kasa, "Nie znaleziono kolejek odpowiedzi dla petentow.");
+            ipc::shm::detach(shared_state);
+            return 1;
+        }
     }
 
-    while (kasa_running) {
+    dayshift::Shift shift(shared_state);
+    auto should_stop = [] { return !kasa_running || stop_after_current; };
+
+    // Windows share the queue: each takes the next payment request, whichever window the petent paid at before
+    while (kasa_running && !stop_after_current) {
+        if (shift.day_ended()) {
+            // Payments waiting in the queue are drained by dyrektor while the kasa sleeps
+            if (!shift.finish_day(should_stop)) {
+                break;
+            }
+            continue;
+        }
+
         KasaRequestMsg request{};
         int rc = ipc::msg::receive<KasaRequestMsg>(msg_kasa_id, kKasaRequestType, &request, 0);
         if (rc == -1) {
@@ -72,28 +91,39 @@ int kasa_main() {
 
         // Sentinel message (petent_id == 0) signals shutdown
         if (request.petent_id == 0) {
-            Logger::log(LogSeverity::Notice, Identity::Kasa, "Otrzymano sygnal zakonczenia.");
+            Logger::log<LogSeverity::Notice>(Identity::Kasa, "Otrzymano sygnal zakonczenia.");
             break;
         }
 
-        Logger::log(LogSeverity::Info, Identity::Kasa,
-                    "Petent " + std::to_string(request.petent_id) + " dokonuje oplaty.");
+        Logger::event<LogSeverity::Info>(Identity::Kasa, LogEvent::PaymentStarted, request.petent_id);
 
+        // Busy time is read off the simulation clock, so that it compares with the length of the day
+        uint32_t started = shared_state->simulated_time.load(std::memory_order_relaxed);
         payment_delay(static_cast<int>(shared_state->time_mul));
+        uint32_t finished = shared_state->simulated_time.load(std::memory_order_relaxed);
+        shared_state->stats.kasa_busy_sec[slot].fetch_add(finished > started ? finished - started : 0,
+                                                          std::memory_order_relaxed);
+        shared_state->stats.kasa_payments[slot].fetch_add(1, std::memory_order_relaxed);
 
-        // Send payment confirmation to petitioner via rejestracja queue (mtype = petent_id)
+        // Send payment confirmation to the petitioner's reply shard (mtype = petent_id)
         ServiceDoneMsg done{};
         done.petent_id = request.petent_id;
         done.department = request.department;
-        done.action = ServiceAction::Complete;
-
-        int send_flags = stop_after_current ? IPC_NOWAIT : 0;
-        if (ipc::msg::send<ServiceDoneMsg>(msg_req_id, static_cast<long>(request.petent_id), done, send_flags) == -1) {
+        done.action = ServiceAction::Paid;
+
+        // SIGUSR1 also retires a window mid-day, while its petent still waits: the confirmation is only given up
+        // at shutdown or once the day is over and the petent has gone
+        auto shutting_down = [&] { return !kasa_running || shared_state->evacuation.is_set(); };
+        int send_flags = shutting_down() ? IPC_NOWAIT : 0;
+        int sent = ipc::helper::send_reply<ServiceDoneMsg>(request.petent_id, done, send_flags);
+        while (sent == -1 && errno == EINTR && !shutting_down() && !shift.day_ended()) {
+            sent = ipc::helper::send_reply<ServiceDoneMsg>(request.petent_id, done, 0);
+        }
+        if (sent == -1) {
             Logger::log(LogSeverity::Err, Identity::Kasa,
                         "Blad wyslania potwierdzenia oplaty dla petenta " + std::to_string(request.petent_id) + ".");
         } else {
-            Logger::log(LogSeverity::Info, Identity::Kasa,
-                        "Petent " + std::to_string(request.petent_id) + " zakonczyl oplate.");
+            Logger::event<LogSeverity::Info>(Identity::Kasa, LogEvent::PaymentFinished, request.petent_id);
         }
 
         if (stop_after_current) {
@@ -102,6 +132,8 @@ int kasa_main() {
     }
 
     ipc::shm::detach(shared_state);
-    Logger::log(LogSeverity::Info, Identity::Kasa, "Kasa zakonczona.");
+    Logger::log<LogSeverity::Info>(Identity::Kasa,
+                                   [&] { return "Okienko kasy " + std::to_string(window) + " zamkniete."; });
+    Logger::log<LogSeverity::Info>(Identity::Kasa, "Kasa zakonczona.");
     return 0;
 }
@@ -1,6 +1,7 @@
 #ifndef SO_PROJEKT_KASA_H
 #define SO_PROJEKT_KASA_H
 
-int kasa_main();
+// One kasa window; `window` (1..kMaxKasaWindows) indexes its counters in DayStats
+int kasa_main(int window);
 
 #endif //SO_PROJEKT_KASA_H
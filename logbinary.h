@@ -0,0 +1,202 @@
+#ifndef SO_PROJEKT_LOGBINARY_H
+#define SO_PROJEKT_LOGBINARY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "common.h"
+#include "logevents.h"
+
+enum class LogFormat : uint32_t { Text, Binary };
+
+// Binary log layout: one FileHeader, then a stream of records.
+// Record = RecordHeader + arg_count typed arguments (tag byte + payload), all in host byte order.
+namespace logbin {
+
+    constexpr uint32_t kMagic = 0x424c4f53; // "SOLB"
+    constexpr uint16_t kVersion = 1;
+    constexpr uint8_t kNoRole = 0xFF;
+    constexpr size_t kMaxRecord = 480; // fits a log ring slot
+
+    struct FileHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t reserved;
+        int64_t realtime_offset_ns; // CLOCK_REALTIME - CLOCK_MONOTONIC when the file was created
+    };
+
+    struct RecordHeader {
+        uint16_t size; // whole record, header included
+        uint16_t event;
+        uint8_t severity;
+        uint8_t identity;
+        uint8_t role;
+        uint8_t arg_count;
+        uint32_t pid;
+        uint32_t reserved;
+        uint64_t timestamp_ns; // CLOCK_MONOTONIC
+        uint64_t tid;
+    };
+
+    static_assert(sizeof(FileHeader) == 16, "unexpected FileHeader padding");
+    static_assert(sizeof(RecordHeader) == 32, "unexpected RecordHeader padding");
+
+    enum class ArgType : uint8_t { Int = 1, Str = 2, Role = 3 };
+
+    inline int64_t clock_ns(clockid_t clock) {
+        timespec ts{};
+        clock_gettime(clock, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000LL + ts.tv_nsec;
+    }
+
+    inline FileHeader make_file_header() {
+        FileHeader header{};
+        header.magic = kMagic;
+        header.version = kVersion;
+        header.realtime_offset_ns = clock_ns(CLOCK_REALTIME) - clock_ns(CLOCK_MONOTONIC);
+        return header;
+    }
+
+    // Fixed-size, allocation-free record encoder
+    class RecordBuilder {
+    public:
+        RecordBuilder(uint16_t event, uint8_t severity, uint8_t identity, uint8_t role, uint32_t pid, uint64_t tid) {
+            RecordHeader header{};
+            header.event = event;
+            header.severity = severity;
+            header.identity = identity;
+            header.role = role;
+            header.pid = pid;
+            header.tid = tid;
+            header.timestamp_ns = static_cast<uint64_t>(clock_ns(CLOCK_MONOTONIC));
+            std::memcpy(buffer, &header, sizeof(header));
+            length = sizeof(header);
+        }
+
+        template <typename T>
+        void add(const T& value) {
+            if constexpr (std::is_same_v<T, UrzednikRole>) {
+                auto raw = static_cast<uint8_t>(value);
+                put(ArgType::Role, &raw, sizeof(raw));
+            }
+            else if constexpr (std::is_integral_v<T>) {
+                auto raw = static_cast<int64_t>(value);
+                put(ArgType::Int, &raw, sizeof(raw));
+            }
+            else {
+                std::string_view text(value);
+                if (text.size() > kMaxRecord) {
+                    text = text.substr(0, kMaxRecord);
+                }
+                auto text_length = static_cast<uint16_t>(text.size());
+                if (length + 1 + sizeof(text_length) > kMaxRecord) {
+                    return;
+                }
+                size_t room = kMaxRecord - length - 1 - sizeof(text_length);
+                if (text_length > room) {
+                    text_length = static_cast<uint16_t>(room);
+                }
+                buffer[length++] = static_cast<char>(ArgType::Str);
+                std::memcpy(buffer + length, &text_length, sizeof(text_length));
+                length += sizeof(text_length);
+                std::memcpy(buffer + length, text.data(), text_length);
+                length += text_length;
+                arg_count++;
+            }
+        }
+
+        const char* finish() {
+            auto* header = reinterpret_cast<RecordHeader*>(buffer);
+            header->size = static_cast<uint16_t>(length);
+            header->arg_count = arg_count;
+            return buffer;
+        }
+
+        size_t size() const { return length; }
+
+    private:
+        void put(ArgType type, const void* data, size_t data_length) {
+            if (length + 1 + data_length > kMaxRecord) {
+                return;
+            }
+            buffer[length++] = static_cast<char>(type);
+            std::memcpy(buffer + length, data, data_length);
+            length += data_length;
+            arg_count++;
+        }
+
+        alignas(8) char buffer[kMaxRecord];
+        size_t length = 0;
+        uint8_t arg_count = 0;
+    };
+
+    // Expands the event template with the record's arguments; returns false on a malformed record
+    inline bool decode_message(const RecordHeader& header, const char* args, size_t args_length, std::string& out) {
+        std::string_view format = log_event_format(static_cast<LogEvent>(header.event));
+        size_t offset = 0;
+        uint8_t decoded = 0;
+        out.clear();
+
+        auto next_arg = [&](std::string& text) -> bool {
+            if (decoded >= header.arg_count || offset >= args_length) {
+                return false;
+            }
+            auto type = static_cast<ArgType>(args[offset++]);
+            switch (type) {
+                case ArgType::Int:
+                {
+                    int64_t value = 0;
+                    if (offset + sizeof(value) > args_length) return false;
+                    std::memcpy(&value, args + offset, sizeof(value));
+                    offset += sizeof(value);
+                    text = std::to_string(value);
+                    break;
+                }
+                case ArgType::Role:
+                {
+                    if (offset + 1 > args_length) return false;
+                    auto role = static_cast<UrzednikRole>(static_cast<uint8_t>(args[offset++]));
+                    text = std::string(urzednik_role_to_string(role).value_or("?"));
+                    break;
+                }
+                case ArgType::Str:
+                {
+                    uint16_t text_length = 0;
+                    if (offset + sizeof(text_length) > args_length) return false;
+                    std::memcpy(&text_length, args + offset, sizeof(text_length));
+                    offset += sizeof(text_length);
+                    if (offset + text_length > args_length) return false;
+                    text.assign(args + offset, text_length);
+                    offset += text_length;
+                    break;
+                }
+                default:
+                    return false;
+            }
+            decoded++;
+            return true;
+        };
+
+        std::string arg_text;
+        for (size_t i = 0; i < format.size(); ++i) {
+            if (format[i] == '{' && i + 1 < format.size() && format[i + 1] == '}') {
+                if (!next_arg(arg_text)) {
+                    return false;
+                }
+                out += arg_text;
+                i++;
+            }
+            else {
+                out.push_back(format[i]);
+            }
+        }
+        return true;
+    }
+
+} // namespace logbin
+
+#endif // SO_PROJEKT_LOGBINARY_H
@@ -0,0 +1,59 @@
+#include "logdump.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../logbinary.h"
+#include "../logger.h"
+
+// Decodes a binary log back into the text format written by Logger in text mode
+int logdump_main(const std::string& input_path) {
+    std::ifstream input(input_path, std::ios::binary);
+    if (!input) {
+        std::cerr << "Blad: nie mozna otworzyc pliku " << input_path << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    logbin::FileHeader file_header{};
+    if (!input.read(reinterpret_cast<char*>(&file_header), sizeof(file_header)) ||
+        file_header.magic != logbin::kMagic) {
+        std::cerr << "Blad: " << input_path << " nie jest binarnym logiem so_projekt\n";
+        return 1;
+    }
+    if (file_header.version != logbin::kVersion) {
+        std::cerr << "Blad: nieobslugiwana wersja logu binarnego: " << file_header.version << "\n";
+        return 1;
+    }
+
+    std::vector<char> args;
+    std::string message;
+    size_t records = 0;
+    while (true) {
+        logbin::RecordHeader header{};
+        if (!input.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            break;
+        }
+        if (header.size < sizeof(header) || header.size > logbin::kMaxRecord) {
+            std::cerr << "Blad: uszkodzony rekord nr " << records + 1 << "\n";
+            return 1;
+        }
+        size_t args_length = header.size - sizeof(header);
+        args.resize(args_length);
+        if (args_length > 0 && !input.read(args.data(), static_cast<std::streamsize>(args_length))) {
+            std::cerr << "Blad: niepelny rekord nr " << records + 1 << "\n";
+            return 1;
+        }
+        if (!logbin::decode_message(header, args.data(), args_length, message)) {
+            std::cerr << "Blad: niepoprawne argumenty rekordu nr " << records + 1 << "\n";
+            return 1;
+        }
+        std::cout << Logger::format_decoded(header, file_header.realtime_offset_ns, message);
+        records++;
+    }
+
+    std::cout.flush();
+    return 0;
+}
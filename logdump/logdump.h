@@ -0,0 +1,8 @@
+#ifndef SO_PROJEKT_LOGDUMP_H
+#define SO_PROJEKT_LOGDUMP_H
+
+#include <string>
+
+int logdump_main(const std::string& input_path);
+
+#endif //SO_PROJEKT_LOGDUMP_H
@@ -0,0 +1,86 @@
+#ifndef SO_PROJEKT_LOGEVENTS_H
+#define SO_PROJEKT_LOGEVENTS_H
+
+#include <cstdint>
+#include <string_view>
+
+// Catalog of high-volume log messages. Binary records store only the event id and its typed
+// arguments; the text is produced from the template ("{}" = next argument) when formatting.
+enum class LogEvent : uint16_t {
+    Text = 0, // free-form message, single string argument
+    PetentStarted,
+    PetentTakesTicket,
+    PetentQueued,
+    PetentVipQueued,
+    TicketIssued,
+    TicketLimitReached,
+    ServiceStarted,
+    ServiceStartedVip,
+    ServiceFinished,
+    ServiceFinishedVip,
+    PetentRedirected,
+    PetentRedirectedVip,
+    SentToKasa,
+    ReturnedFromKasa,
+    PaymentStarted,
+    PaymentFinished,
+    GeneratePetent,
+    GeneratePetentVip,
+    GeneratePetentChild,
+    GeneratePetentVipChild,
+    Suppressed, // rate limiter summary: count, template of the suppressed event
+    Count
+};
+
+constexpr std::string_view log_event_format(LogEvent event) noexcept {
+    switch (event) {
+        case LogEvent::Text:
+            return "{}";
+        case LogEvent::PetentStarted:
+            return "Petent uruchomiony.";
+        case LogEvent::PetentTakesTicket:
+            return "Petent pobiera bilet w rejestracji.";
+        case LogEvent::PetentQueued:
+            return "Petent zglosil sie do urzednika z biletem {}.";
+        case LogEvent::PetentVipQueued:
+            return "Petent VIP - wchodzi do kolejki priorytetowej z biletem {}.";
+        case LogEvent::TicketIssued:
+            return "Wydano bilet nr {} do wydzialu.";
+        case LogEvent::TicketLimitReached:
+            return "Brak wolnych terminow w wydziale {}, bilet nie zostal wydany.";
+        case LogEvent::ServiceStarted:
+            return "Rozpoczecie obslugi petenta {} (bilet {}).";
+        case LogEvent::ServiceStartedVip:
+            return "Rozpoczecie obslugi petenta VIP {} (bilet {}).";
+        case LogEvent::ServiceFinished:
+            return "Zakonczono obsluge petenta {}.";
+        case LogEvent::ServiceFinishedVip:
+            return "Zakonczono obsluge petenta VIP {}.";
+        case LogEvent::PetentRedirected:
+            return "Przekierowano petenta {} do innego wydzialu.";
+        case LogEvent::PetentRedirectedVip:
+            return "Przekierowano petenta VIP {} do innego wydzialu.";
+        case LogEvent::SentToKasa:
+            return "Petent {} skierowany do kasy.";
+        case LogEvent::ReturnedFromKasa:
+            return "Petent {} wrocil z kasy.";
+        case LogEvent::PaymentStarted:
+            return "Petent {} dokonuje oplaty.";
+        case LogEvent::PaymentFinished:
+            return "Petent {} zakonczyl oplate.";
+        case LogEvent::GeneratePetent:
+            return "Generuje petenta do wydzialu {}.";
+        case LogEvent::GeneratePetentVip:
+            return "Generuje petenta VIP do wydzialu {}.";
+        case LogEvent::GeneratePetentChild:
+            return "Generuje petenta z dzieckiem do wydzialu {}.";
+        case LogEvent::GeneratePetentVipChild:
+            return "Generuje petenta VIP z dzieckiem do wydzialu {}.";
+        case LogEvent::Suppressed:
+            return "Pominieto {} podobnych wpisow: \"{}\"";
+        default:
+            return "?";
+    }
+}
+
+#endif // SO_PROJEKT_LOGEVENTS_H
@@ -1,26 +1,73 @@
 #ifndef SO_PROJEKT_LOGGER_H
 #define SO_PROJEKT_LOGGER_H
 
+#include <array>
 #include <chrono>
 #include <cstdio>
 #include <cstring>
 #include <fcntl.h>
 #include <iomanip>
+#include <optional>
+#include <pthread.h>
 #include <sstream>
 #include <string>
 #include <string_view>
 #include <sys/file.h>
+#include <sys/shm.h>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <unistd.h>
 #include "common.h"
+#include "logbinary.h"
+#include "logevents.h"
+#include "logring.h"
 
 constexpr bool LOG_TO_STDOUT = true;
 
 enum class LogSeverity { Emerg, Alert, Crit, Err, Warning, Notice, Info, Debug };
 
+// Least severe level kept by the templated Logger calls; anything below compiles to nothing.
+// Build with e.g. `make LOG_MIN_SEVERITY=5` to strip Info and Debug from the binary.
+#ifndef SO_PROJEKT_LOG_MIN_SEVERITY
+#define SO_PROJEKT_LOG_MIN_SEVERITY 7
+#endif
+constexpr LogSeverity LOG_COMPILED_MIN_SEVERITY = static_cast<LogSeverity>(SO_PROJEKT_LOG_MIN_SEVERITY);
+
+using SeverityThresholds = std::array<LogSeverity, kIdentityCount>;
+
+inline SeverityThresholds all_severities(LogSeverity severity) {
+    SeverityThresholds thresholds{};
+    thresholds.fill(severity);
+    return thresholds;
+}
+
+inline std::optional<LogSeverity> string_to_log_severity(std::string_view str) {
+    if (str == "emerg") return LogSeverity::Emerg;
+    if (str == "alert") return LogSeverity::Alert;
+    if (str == "crit") return LogSeverity::Crit;
+    if (str == "err") return LogSeverity::Err;
+    if (str == "warning") return LogSeverity::Warning;
+    if (str == "notice") return LogSeverity::Notice;
+    if (str == "info") return LogSeverity::Info;
+    if (str == "debug") return LogSeverity::Debug;
+    return std::nullopt;
+}
+
+struct LogOptions {
+    logring::RingOptions ring;
+    LogFormat format = LogFormat::Text;
+    SeverityThresholds min_severity = all_severities(LogSeverity::Debug);
+    std::array<lograte::Limit, kIdentityCount> limits{};
+};
+
 class Logger {
 private:
     inline static std::string log_file_path = "./so_projekt.log";
+    inline static std::string binary_file_path = "./so_projekt.bin";
+    inline static LogFormat format = LogFormat::Text;
+    inline static logring::LogShared* shared_log = nullptr;
+    inline static SeverityThresholds min_severity = all_severities(LogSeverity::Debug);
 
     static constexpr std::string_view severity_to_string(LogSeverity severity) noexcept {
         switch (severity) {
@@ -59,6 +106,8 @@ private:
                 return "GENERATOR";
             case Identity::Kasa:
                 return "KASA";
+            case Identity::LogDump:
+                return "LOGDUMP";
             default:
                 return "UNKNOWN";
         }
@@ -81,13 +130,21 @@ private:
         }
     }
 
-    // Get it in ISO 8601 format w/ offset
-    static std::string get_current_timestamp() {
-        auto now = std::chrono::system_clock::now();
-        auto time_t_now = std::chrono::system_clock::to_time_t(now);
+    // Get it in ISO 8601 format w/ offset; the text only changes once a second, so each thread caches it
+    static const std::string& get_current_timestamp() {
+        thread_local std::time_t cached_second = -1;
+        thread_local std::string cached_timestamp;
+        std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        if (now != cached_second) {
+            cached_timestamp = format_timestamp(now);
+            cached_second = now;
+        }
+        return cached_timestamp;
+    }
 
+    static std::string format_timestamp(std::time_t time_value) {
         std::tm timeinfo{};
-        localtime_r(&time_t_now, &timeinfo);
+        localtime_r(&time_value, &timeinfo);
 
         std::ostringstream ss;
         ss << std::put_time(&timeinfo, "%Y-%m-%dT%H:%M:%S");
@@ -102,24 +159,29 @@ private:
         return ss.str();
     }
 
-    static void write_log(const std::string& message, bool to_stdout = LOG_TO_STDOUT) {
-        if (to_stdout) {
-            fflush(stdout);
-            int fd = STDOUT_FILENO;
+    static bool ring_active() { return shared_log != nullptr && shared_log->ring_enabled; }
 
-            // Try to lock stdout if possible; ignore lock failures and still write
-            // Realistically, any messages under PIPE_BUF (4KB on modern Linux) will be atomic anyway
-            flock(fd, LOCK_EX);
+    static void write_log(const std::string& message, bool to_stdout = LOG_TO_STDOUT) {
+        // Hand the record to dyrektor's flusher instead of doing the file I/O here
+        if (ring_active()) {
+            uint16_t flags = logring::kSlotToFile | (to_stdout ? logring::kSlotToStdout : 0);
+            logring::push(shared_log, message.data(), message.size(), flags);
+            return;
+        }
 
-            ssize_t bytes_written = write(fd, message.c_str(), message.length());
-            if (bytes_written == -1) {
-                perror("Failed to write to stdout");
-            }
+        write_direct(message, to_stdout);
+    }
 
-            flock(fd, LOCK_UN);
+    static void write_binary(const char* record, size_t length) {
+        if (ring_active()) {
+            logring::push(shared_log, record, length, logring::kSlotBinary);
+            return;
         }
+        append_locked(binary_file_path, record, length);
+    }
 
-        int fd = open(log_file_path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    static void append_locked(const std::string& path, const char* data, size_t length) {
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
         if (fd == -1) {
             perror("Failed to open log file");
             return;
@@ -131,7 +193,7 @@ private:
             return;
         }
 
-        ssize_t bytes_written = write(fd, message.c_str(), message.length());
+        ssize_t bytes_written = write(fd, data, length);
         if (bytes_written == -1) {
             perror("Failed to write to log file");
         }
@@ -141,33 +203,305 @@ private:
         close(fd);
     }
 
+    static void write_stdout(const std::string& message) {
+        fflush(stdout);
+        int fd = STDOUT_FILENO;
+
+        // Try to lock stdout if possible; ignore lock failures and still write
+        // Realistically, any messages under PIPE_BUF (4KB on modern Linux) will be atomic anyway
+        flock(fd, LOCK_EX);
+
+        ssize_t bytes_written = write(fd, message.c_str(), message.length());
+        if (bytes_written == -1) {
+            perror("Failed to write to stdout");
+        }
+
+        flock(fd, LOCK_UN);
+    }
+
+    // Binary mode keeps warnings and worse readable on the console
+    static void echo_to_stdout(LogSeverity severity, const std::string& line, bool to_stdout) {
+        if (!to_stdout || severity > LogSeverity::Warning) {
+            return;
+        }
+        if (ring_active()) {
+            logring::push(shared_log, line.data(), line.size(), logring::kSlotToStdout);
+            return;
+        }
+        write_stdout(line);
+    }
+
+    static std::string build_line(const std::string& timestamp, long pid, const std::string& tid, LogSeverity severity,
+                                  Identity identity, const UrzednikRole* role, std::string_view message) {
+        std::string line;
+        line.reserve(timestamp.size() + tid.size() + message.size() + 64);
+        line.append(timestamp).append(" [PID:").append(std::to_string(pid)).append("] [TID:").append(tid).append("] ");
+        line.append(severity_to_string(severity)).append(" ").append(identity_to_string(identity));
+        if (role != nullptr) {
+            line.append("(").append(role_to_string(*role)).append(")");
+        }
+        line.append(": ").append(message).push_back('\n');
+        return line;
+    }
+
+    static const std::string& current_tid() {
+        thread_local std::string cached_tid = [] {
+            std::ostringstream ss;
+            ss << std::this_thread::get_id();
+            return ss.str();
+        }();
+        return cached_tid;
+    }
+
+    // Lazy messages are passed as callables and only invoked once the record is known to be emitted
+    template <typename Message>
+    static decltype(auto) resolve_message(Message&& message) {
+        if constexpr (std::is_invocable_v<Message>) {
+            return std::forward<Message>(message)();
+        }
+        else {
+            return std::forward<Message>(message);
+        }
+    }
+
+    template <typename T>
+    static void append_arg_text(std::string& out, const T& value) {
+        if constexpr (std::is_same_v<T, UrzednikRole>) {
+            out += role_to_string(value);
+        }
+        else if constexpr (std::is_integral_v<T>) {
+            out += std::to_string(value);
+        }
+        else {
+            out += std::string_view(value);
+        }
+    }
+
+    template <typename... Args>
+    static std::string format_event(LogEvent event, const Args&... args) {
+        std::string_view pattern = log_event_format(event);
+        std::string out;
+        size_t pos = 0;
+        [[maybe_unused]] auto substitute = [&](const auto& value) {
+            size_t marker = pattern.find("{}", pos);
+            if (marker == std::string_view::npos) {
+                return;
+            }
+            out.append(pattern.substr(pos, marker - pos));
+            append_arg_text(out, value);
+            pos = marker + 2;
+        };
+        (substitute(args), ...);
+        out.append(pattern.substr(pos));
+        return out;
+    }
+
+    template <typename... Args>
+    static void write_event(LogSeverity severity, Identity identity, const UrzednikRole* role, LogEvent event,
+                            const Args&... args) {
+        // Err..Notice always pass; Info/Debug events go through the shared rate limiter and sampler
+        if (shared_log != nullptr && severity > LogSeverity::Notice && lograte::is_limited(event)) {
+            if (!lograte::admit(shared_log->rate, identity, event)) {
+                return;
+            }
+            write_suppressed(identity, role, event);
+        }
+
+        if (format == LogFormat::Binary) {
+            logbin::RecordBuilder record(static_cast<uint16_t>(event), static_cast<uint8_t>(severity),
+                                         static_cast<uint8_t>(identity),
+                                         role != nullptr ? static_cast<uint8_t>(*role) : logbin::kNoRole,
+                                         static_cast<uint32_t>(getpid()), static_cast<uint64_t>(pthread_self()));
+            (record.add(args), ...);
+            write_binary(record.finish(), record.size());
+            if (severity <= LogSeverity::Warning) {
+                echo_to_stdout(severity,
+                               build_line(get_current_timestamp(), getpid(), current_tid(), severity, identity, role,
+                                          format_event(event, args...)),
+                               LOG_TO_STDOUT);
+            }
+            return;
+        }
+
+        write_log(build_line(get_current_timestamp(), getpid(), current_tid(), severity, identity, role,
+                             format_event(event, args...)));
+    }
+
+    // Summary of records dropped by the limiter, written at most once per window for each event
+    static void write_suppressed(Identity identity, const UrzednikRole* role, LogEvent event, bool force = false) {
+        uint64_t suppressed = lograte::take_suppressed(shared_log->rate, identity, event, force);
+        if (suppressed > 0) {
+            write_event(LogSeverity::Notice, identity, role, LogEvent::Suppressed, suppressed, log_event_format(event));
+        }
+    }
+
 public:
+    static bool enabled(LogSeverity severity, Identity identity) {
+        return severity <= min_severity[static_cast<size_t>(identity)];
+    }
+
+    static void write_direct(const std::string& message, bool to_stdout = LOG_TO_STDOUT) {
+        if (to_stdout) {
+            write_stdout(message);
+        }
+        append_locked(log_file_path, message.data(), message.size());
+    }
+
+    static std::string format_line(LogSeverity severity, Identity identity, const std::string& message) {
+        return build_line(get_current_timestamp(), getpid(), current_tid(), severity, identity, nullptr, message);
+    }
+
+    // Rebuilds the text line of a decoded binary record
+    static std::string format_decoded(const logbin::RecordHeader& header, int64_t realtime_offset_ns,
+                                      std::string_view message) {
+        int64_t wall_ns = static_cast<int64_t>(header.timestamp_ns) + realtime_offset_ns;
+        auto role = static_cast<UrzednikRole>(header.role);
+        return build_line(format_timestamp(static_cast<std::time_t>(wall_ns / 1'000'000'000LL)), header.pid,
+                          std::to_string(header.tid), static_cast<LogSeverity>(header.severity),
+                          static_cast<Identity>(header.identity), header.role == logbin::kNoRole ? nullptr : &role,
+                          message);
+    }
+
     // Identity only log
     static void log(LogSeverity severity, Identity identity, const std::string& message, bool to_stdout = LOG_TO_STDOUT) {
-        std::ostringstream ss;
-        ss << get_current_timestamp() << " "
-           << "[PID:" << getpid() << "] "
-           << "[TID:" << std::this_thread::get_id() << "] " << severity_to_string(severity) << " "
-           << identity_to_string(identity) << ": " << message << '\n';
-
-        write_log(ss.str(), to_stdout);
+        if (!enabled(severity, identity)) {
+            return;
+        }
+        if (format == LogFormat::Binary) {
+            write_event(severity, identity, nullptr, LogEvent::Text, message);
+            return;
+        }
+        write_log(format_line(severity, identity, message), to_stdout);
     }
 
     // Identity and urzednik role log
     static void log(LogSeverity severity, Identity identity, UrzednikRole role, const std::string& message, bool to_stdout = LOG_TO_STDOUT) {
-        std::ostringstream ss;
-        ss << get_current_timestamp() << " "
-           << "[PID:" << getpid() << "] "
-           << "[TID:" << std::this_thread::get_id() << "] " << severity_to_string(severity) << " "
-           << identity_to_string(identity) << "(" << role_to_string(role) << "): " << message << '\n';
+        if (!enabled(severity, identity)) {
+            return;
+        }
+        if (format == LogFormat::Binary) {
+            write_event(severity, identity, &role, LogEvent::Text, message);
+            return;
+        }
+        write_log(build_line(get_current_timestamp(), getpid(), current_tid(), severity, identity, &role, message),
+                  to_stdout);
+    }
+
+    // Catalogued event: typed arguments, text is only produced in text mode
+    template <typename... Args>
+    static void event(LogSeverity severity, Identity identity, LogEvent event, const Args&... args) {
+        if (enabled(severity, identity)) {
+            write_event(severity, identity, nullptr, event, args...);
+        }
+    }
 
-        write_log(ss.str(), to_stdout);
+    template <typename... Args>
+    static void event(LogSeverity severity, Identity identity, UrzednikRole role, LogEvent event, const Args&... args) {
+        if (enabled(severity, identity)) {
+            write_event(severity, identity, &role, event, args...);
+        }
+    }
+
+    // Templated variants: severity is checked at compile time against LOG_COMPILED_MIN_SEVERITY, then against the
+    // runtime threshold of the identity; the message (string or callable returning one) is only built when emitted
+    template <LogSeverity Severity, typename Message>
+    static void log(Identity identity, Message&& message) {
+        if constexpr (Severity <= LOG_COMPILED_MIN_SEVERITY) {
+            if (enabled(Severity, identity)) {
+                log(Severity, identity, resolve_message(std::forward<Message>(message)));
+            }
+        }
+    }
+
+    template <LogSeverity Severity, typename Message>
+    static void log(Identity identity, UrzednikRole role, Message&& message) {
+        if constexpr (Severity <= LOG_COMPILED_MIN_SEVERITY) {
+            if (enabled(Severity, identity)) {
+                log(Severity, identity, role, resolve_message(std::forward<Message>(message)));
+            }
+        }
+    }
+
+    template <LogSeverity Severity, typename... Args>
+    static void event(Identity identity, LogEvent event, const Args&... args) {
+        if constexpr (Severity <= LOG_COMPILED_MIN_SEVERITY) {
+            if (enabled(Severity, identity)) {
+                write_event(Severity, identity, nullptr, event, args...);
+            }
+        }
+    }
+
+    template <LogSeverity Severity, typename... Args>
+    static void event(Identity identity, UrzednikRole role, LogEvent event, const Args&... args) {
+        if constexpr (Severity <= LOG_COMPILED_MIN_SEVERITY) {
+            if (enabled(Severity, identity)) {
+                write_event(Severity, identity, &role, event, args...);
+            }
+        }
     }
 
     // Set log file
     static void set_log_file(const std::string& path) { log_file_path = path; }
 
-    // Clear log file
+    static const std::string& get_log_file() { return log_file_path; }
+
+    static const std::string& get_binary_file() { return binary_file_path; }
+
+    static void set_format(LogFormat log_format) { format = log_format; }
+
+    static LogFormat get_format() { return format; }
+
+    static void set_min_severity(const SeverityThresholds& thresholds) { min_severity = thresholds; }
+
+    // Dyrektor at shutdown: write summaries left behind by processes that already exited
+    static void flush_suppressed() {
+        if (shared_log == nullptr) {
+            return;
+        }
+        for (size_t identity = 0; identity < kIdentityCount; ++identity) {
+            for (size_t event = 0; event < lograte::kEventCount; ++event) {
+                if (lograte::is_limited(static_cast<LogEvent>(event))) {
+                    write_suppressed(static_cast<Identity>(identity), nullptr, static_cast<LogEvent>(event), true);
+                }
+            }
+        }
+    }
+
+    // Route records through the shared-memory ring (dyrektor passes the segment it created)
+    static void use_shared_log(logring::LogShared* shared) { shared_log = shared; }
+
+    // Child processes: attach dyrektor's log segment if it exists, otherwise keep writing directly
+    static void attach_shared_log() {
+        int shm_id = ipc::helper::inherited_shm_id(ipc::helper::kLogShmEnv);
+        if (shm_id == -1) {
+            key_t key = ftok(ipc::IPC_LOCK_FILE, static_cast<int>(ipc::KeyType::LogShared));
+            if (key == -1) {
+                return;
+            }
+            shm_id = shmget(key, sizeof(logring::LogShared), 0);
+            if (shm_id == -1) {
+                return;
+            }
+        }
+        void* addr = shmat(shm_id, nullptr, 0);
+        if (addr == (void*)-1) {
+            return;
+        }
+        shared_log = static_cast<logring::LogShared*>(addr);
+        format = shared_log->binary_format ? LogFormat::Binary : LogFormat::Text;
+        for (size_t i = 0; i < kIdentityCount; ++i) {
+            min_severity[i] = static_cast<LogSeverity>(shared_log->min_severity[i]);
+        }
+    }
+
+    static void detach_shared_log() {
+        if (shared_log != nullptr) {
+            shmdt(shared_log);
+            shared_log = nullptr;
+        }
+    }
+
+    // Clear log file (binary mode: start a fresh binary log with its header)
     static void clear_log() {
         int fd = open(log_file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
         if (fd == -1) {
@@ -175,6 +509,20 @@ public:
             return;
         }
         close(fd);
+
+        if (format != LogFormat::Binary) {
+            return;
+        }
+        fd = open(binary_file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1) {
+            perror("Failed to clear binary log file");
+            return;
+        }
+        logbin::FileHeader header = logbin::make_file_header();
+        if (write(fd, &header, sizeof(header)) == -1) {
+            perror("Failed to write binary log header");
+        }
+        close(fd);
     }
 };
 
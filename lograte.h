@@ -0,0 +1,116 @@
+#ifndef SO_PROJEKT_LOGRATE_H
+#define SO_PROJEKT_LOGRATE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <new>
+#include "common.h"
+#include "logevents.h"
+
+// Per-identity rate limiting and sampling of catalogued log events.
+// State lives in the shared log segment so that short-lived processes (one per petent) share one budget per event.
+namespace lograte {
+
+    constexpr size_t kEventCount = static_cast<size_t>(LogEvent::Count);
+    constexpr int64_t kSummaryWindowNs = 1'000'000'000LL; // at most one summary per event and second
+
+    struct Limit {
+        uint32_t rate_per_sec = 0; // 0 = unlimited; burst is one second worth of records
+        uint32_t sample_every = 1; // keep 1 in N records
+    };
+
+    struct EventState {
+        std::atomic<int64_t> tat_ns; // token bucket as GCRA: theoretical arrival time of the next record
+        std::atomic<uint64_t> seen;
+        std::atomic<uint64_t> suppressed;
+        std::atomic<int64_t> summary_ns; // when the last summary window was closed
+    };
+
+    struct State {
+        Limit limits[kIdentityCount];
+        EventState events[kIdentityCount][kEventCount];
+
+        State() {
+            for (auto& per_identity : events) {
+                for (auto& event : per_identity) {
+                    new (&event.tat_ns) std::atomic<int64_t>(0);
+                    new (&event.seen) std::atomic<uint64_t>(0);
+                    new (&event.suppressed) std::atomic<uint64_t>(0);
+                    new (&event.summary_ns) std::atomic<int64_t>(0);
+                }
+            }
+        }
+    };
+
+    // Free-form text and the summaries themselves are never limited
+    constexpr bool is_limited(LogEvent event) noexcept {
+        return event != LogEvent::Text && event != LogEvent::Suppressed && event < LogEvent::Count;
+    }
+
+    inline int64_t monotonic_ns() {
+        timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000LL + ts.tv_nsec;
+    }
+
+    inline bool take_token(EventState& state, const Limit& limit) {
+        const int64_t interval = 1'000'000'000LL / limit.rate_per_sec;
+        const int64_t tolerance = interval * limit.rate_per_sec;
+        const int64_t now = monotonic_ns();
+        int64_t tat = state.tat_ns.load(std::memory_order_relaxed);
+        while (true) {
+            int64_t start = tat > now ? tat : now;
+            if (start + interval - now > tolerance) {
+                return false;
+            }
+            if (state.tat_ns.compare_exchange_weak(tat, start + interval, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+
+    // Returns false when the record should be dropped; dropped records are counted for the next summary
+    inline bool admit(State& state, Identity identity, LogEvent event) {
+        auto identity_idx = static_cast<size_t>(identity);
+        const Limit& limit = state.limits[identity_idx];
+        if (limit.rate_per_sec == 0 && limit.sample_every <= 1) {
+            return true;
+        }
+
+        EventState& event_state = state.events[identity_idx][static_cast<size_t>(event)];
+        bool keep = true;
+        if (limit.sample_every > 1) {
+            keep = event_state.seen.fetch_add(1, std::memory_order_relaxed) % limit.sample_every == 0;
+        }
+        if (keep && limit.rate_per_sec != 0) {
+            keep = take_token(event_state, limit);
+        }
+        if (!keep) {
+            event_state.suppressed.fetch_add(1, std::memory_order_relaxed);
+        }
+        return keep;
+    }
+
+    // Closes the summary window once it is over (or right away when forced) and returns the number of records
+    // dropped in it; 0 means there is nothing to report yet
+    inline uint64_t take_suppressed(State& state, Identity identity, LogEvent event, bool force = false) {
+        EventState& event_state = state.events[static_cast<size_t>(identity)][static_cast<size_t>(event)];
+        if (event_state.suppressed.load(std::memory_order_relaxed) == 0) {
+            return 0;
+        }
+        if (!force) {
+            int64_t now = monotonic_ns();
+            int64_t window_start = event_state.summary_ns.load(std::memory_order_relaxed);
+            if (now - window_start < kSummaryWindowNs ||
+                !event_state.summary_ns.compare_exchange_strong(window_start, now, std::memory_order_relaxed)) {
+                return 0;
+            }
+        }
+        return event_state.suppressed.exchange(0, std::memory_order_relaxed);
+    }
+
+} // namespace lograte
+
+#endif // SO_PROJEKT_LOGRATE_H
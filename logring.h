@@ -0,0 +1,230 @@
+#ifndef SO_PROJEKT_LOGRING_H
+#define SO_PROJEKT_LOGRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <signal.h>
+#include <unistd.h>
+#include "ipcutils.h"
+#include "lograte.h"
+
+// Shared-memory log segment created by dyrektor next to SharedState.
+// Every process pushes finished records into a bounded multi-producer ring (per-slot sequence numbers,
+// a CAS on enqueue_pos to claim a slot); the flusher thread in dyrektor is the single consumer.
+namespace logring {
+
+    constexpr uint32_t kSlotCount = 4096; // must be a power of two
+    constexpr uint32_t kSlotMask = kSlotCount - 1;
+    constexpr size_t kSlotPayload = 500;
+    constexpr long kBlockSliceMs = 100;
+    constexpr int kBlockMaxSlices = 10; // ~1s without flusher progress -> drop (dyrektor gone)
+    constexpr long kStalledSlotMs = 1000; // a claimed slot still unpublished after this is given up by the flusher
+    // Set in Slot::seq while the producer that claimed the slot copies its record in; the slot is not given up then
+    constexpr uint64_t kSlotWriting = 1ULL << 63;
+
+    enum class FullPolicy : uint32_t { Block, Drop };
+
+    struct RingOptions {
+        bool enabled = false;
+        FullPolicy full_policy = FullPolicy::Block;
+    };
+
+    enum SlotFlags : uint16_t { kSlotToStdout = 1, kSlotToFile = 2, kSlotBinary = 4 };
+
+    struct Slot {
+        std::atomic<uint64_t> seq;
+        std::atomic<uint64_t> writer; // writer_tag() of the producer holding the slot in kSlotWriting
+        uint16_t length;
+        uint16_t flags;
+        char data[kSlotPayload];
+    };
+
+    struct LogShared {
+        // Written once by dyrektor before any child is spawned
+        uint32_t ring_enabled;
+        FullPolicy full_policy;
+        uint32_t binary_format;
+        uint8_t min_severity[kIdentityCount]; // LogSeverity threshold per Identity
+        lograte::State rate;
+
+        alignas(64) std::atomic<uint64_t> enqueue_pos;
+        alignas(64) std::atomic<uint64_t> dequeue_pos; // written by the flusher only
+        alignas(64) std::atomic<uint32_t> published; // futex word, bumped after every publish
+        std::atomic<uint32_t> consumer_sleeping;
+        alignas(64) std::atomic<uint32_t> consumed; // futex word, bumped after every flushed batch
+        std::atomic<uint32_t> producers_waiting;
+        alignas(64) std::atomic<uint64_t> dropped;
+
+        Slot slots[kSlotCount];
+
+        LogShared(const RingOptions& options, bool binary) :
+            ring_enabled(options.enabled ? 1 : 0), full_policy(options.full_policy), binary_format(binary ? 1 : 0),
+            enqueue_pos(0), dequeue_pos(0),
+            published(0), consumer_sleeping(0), consumed(0), producers_waiting(0), dropped(0) {
+            for (uint32_t i = 0; i < kSlotCount; ++i) {
+                new (&slots[i].seq) std::atomic<uint64_t>(i);
+                new (&slots[i].writer) std::atomic<uint64_t>(0);
+                slots[i].length = 0;
+                slots[i].flags = 0;
+            }
+            std::memset(min_severity, 7, sizeof(min_severity)); // LogSeverity::Debug
+        }
+    };
+
+    // Low half of the slot's position and the writer's pid; a tag left by an earlier lap never matches the head
+    inline uint64_t writer_tag(uint64_t pos, pid_t pid) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(pos)) << 32) | static_cast<uint32_t>(pid);
+    }
+
+    inline void wake_consumer(LogShared* shared) {
+        shared->published.fetch_add(1, std::memory_order_release);
+        if (shared->consumer_sleeping.load(std::memory_order_acquire) != 0) {
+            ipc::futex::wake(&shared->published, 1);
+        }
+    }
+
+    // Returns false when the record was dropped (ring full under Drop policy, flusher not progressing, or the slot
+    // given up by the flusher before this producer started writing it)
+    inline bool push(LogShared* shared, const char* data, size_t length, uint16_t flags) {
+        // A cut text record keeps its newline, so it does not run into the next line
+        bool keep_newline = false;
+        if (length > kSlotPayload) {
+            keep_newline = (flags & kSlotBinary) == 0 && data[length - 1] == '\n';
+            length = kSlotPayload;
+        }
+
+        int blocked_slices = 0;
+        uint64_t pos = shared->enqueue_pos.load(std::memory_order_relaxed);
+        Slot* slot = nullptr;
+        while (true) {
+            slot = &shared->slots[pos & kSlotMask];
+            uint64_t seq = slot->seq.load(std::memory_order_acquire);
+            bool writing = (seq & kSlotWriting) != 0;
+            auto diff = static_cast<int64_t>(seq & ~kSlotWriting) - static_cast<int64_t>(pos);
+            if (diff == 0 && !writing) {
+                if (shared->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+                continue;
+            }
+            // Claimed by another producer meanwhile (its slot of this lap may already be in kSlotWriting)
+            if (diff >= 0) {
+                pos = shared->enqueue_pos.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            // Ring full
+            if (shared->full_policy == FullPolicy::Drop || blocked_slices >= kBlockMaxSlices) {
+                shared->dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            uint32_t consumed = shared->consumed.load(std::memory_order_acquire);
+            uint64_t head = shared->dequeue_pos.load(std::memory_order_acquire);
+            shared->producers_waiting.fetch_add(1, std::memory_order_acq_rel);
+            if (head + kSlotCount <= pos) {
+                timespec slice = ipc::futex::millis(kBlockSliceMs);
+                if (ipc::futex::wait(&shared->consumed, consumed, &slice) == 1) {
+                    blocked_slices++;
+                }
+            }
+            shared->producers_waiting.fetch_sub(1, std::memory_order_acq_rel);
+            pos = shared->enqueue_pos.load(std::memory_order_relaxed);
+        }
+
+        // Fails only when the flusher has given the slot up (skip_stalled) and counted the drop; from here on the
+        // slot stays ours until published, so nothing is written into a slot the next lap may already own
+        uint64_t claimed = pos;
+        if (!slot->seq.compare_exchange_strong(claimed, pos | kSlotWriting, std::memory_order_acquire,
+                                               std::memory_order_relaxed)) {
+            return false;
+        }
+        slot->writer.store(writer_tag(pos, getpid()), std::memory_order_relaxed);
+        std::memcpy(slot->data, data, length);
+        if (keep_newline) {
+            slot->data[length - 1] = '\n';
+        }
+        slot->length = static_cast<uint16_t>(length);
+        slot->flags = flags;
+        slot->seq.store(pos + 1, std::memory_order_release);
+        wake_consumer(shared);
+        return true;
+    }
+
+    // Consumer side: number of contiguous published slots starting at the current head (at most max_count)
+    inline uint32_t ready_count(const LogShared* shared, uint32_t max_count) {
+        uint64_t head = shared->dequeue_pos.load(std::memory_order_relaxed);
+        uint32_t count = 0;
+        while (count < max_count) {
+            const Slot& slot = shared->slots[(head + count) & kSlotMask];
+            if (slot.seq.load(std::memory_order_acquire) != head + count + 1) {
+                break;
+            }
+            count++;
+        }
+        return count;
+    }
+
+    // Consumer side: a producer has claimed the head slot but not published it (yet)
+    inline bool head_stalled(const LogShared* shared) {
+        uint64_t head = shared->dequeue_pos.load(std::memory_order_relaxed);
+        uint64_t seq = shared->slots[head & kSlotMask].seq.load(std::memory_order_acquire);
+        return shared->enqueue_pos.load(std::memory_order_acquire) > head && (seq & ~kSlotWriting) == head;
+    }
+
+    // Consumer side: gives up the stalled head slot and counts it as dropped. A producer killed after its CAS on
+    // enqueue_pos (evacuation kills petents) would otherwise hold every later record back forever. A slot not yet
+    // being written is taken back at once: a producer that was only slow then fails to start writing and loses its
+    // record. A slot being written is taken back only once its writer no longer exists, so no live producer ever
+    // writes into a slot the next lap may own. Returns false when the slot is kept or was published meanwhile.
+    inline bool skip_stalled(LogShared* shared) {
+        uint64_t head = shared->dequeue_pos.load(std::memory_order_relaxed);
+        Slot& slot = shared->slots[head & kSlotMask];
+        uint64_t expected = slot.seq.load(std::memory_order_acquire);
+        if ((expected & ~kSlotWriting) != head) {
+            return false;
+        }
+        if ((expected & kSlotWriting) != 0) {
+            // The writer stores its tag right after taking the slot; until then it is not known to be gone
+            uint64_t writer = slot.writer.load(std::memory_order_relaxed);
+            auto pid = static_cast<pid_t>(static_cast<uint32_t>(writer));
+            if (writer != writer_tag(head, pid) || kill(pid, 0) == 0 || errno != ESRCH) {
+                return false;
+            }
+        }
+        if (!slot.seq.compare_exchange_strong(expected, head + kSlotCount, std::memory_order_acq_rel)) {
+            return false;
+        }
+        shared->dequeue_pos.store(head + 1, std::memory_order_release);
+        shared->dropped.fetch_add(1, std::memory_order_relaxed);
+        shared->consumed.fetch_add(1, std::memory_order_release);
+        if (shared->producers_waiting.load(std::memory_order_acquire) != 0) {
+            ipc::futex::wake(&shared->consumed);
+        }
+        return true;
+    }
+
+    inline const Slot& slot_at(const LogShared* shared, uint32_t offset) {
+        uint64_t head = shared->dequeue_pos.load(std::memory_order_relaxed);
+        return shared->slots[(head + offset) & kSlotMask];
+    }
+
+    // Hand `count` slots back to producers and wake any that wait on a full ring
+    inline void release(LogShared* shared, uint32_t count) {
+        uint64_t head = shared->dequeue_pos.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < count; ++i) {
+            shared->slots[(head + i) & kSlotMask].seq.store(head + i + kSlotCount, std::memory_order_release);
+        }
+        shared->dequeue_pos.store(head + count, std::memory_order_release);
+        shared->consumed.fetch_add(1, std::memory_order_release);
+        if (shared->producers_waiting.load(std::memory_order_acquire) != 0) {
+            ipc::futex::wake(&shared->consumed);
+        }
+    }
+
+} // namespace logring
+
+#endif // SO_PROJEKT_LOGRING_H
@@ -1,10 +1,16 @@
 #include <array>
 #include <iostream>
 #include <optional>
+#include <random>
+#include <string>
+#include <vector>
 #include "common.h"
+#include "des/des.h"
 #include "dyrektor/dyrektor.h"
 #include "kasa/kasa.h"
+#include "logdump/logdump.h"
 #include "logger.h"
+#include "placement.h"
 #include "petent/generator.h"
 #include "petent/petent.h"
 #include "rejestracja/rejestracja.h"
@@ -14,7 +20,7 @@ void print_usage(char* program_name) {
     std::cerr << "Uzycie: " << program_name << " <argumenty>\n\n"
               << "Ogolne argumenty:\n"
               << "  --role <rola>  "
-              << "Okresla role (dyrektor/petent/rejestracja/urzednik/generator)\n"
+              << "Okresla role (dyrektor/petent/rejestracja/urzednik/generator/logdump)\n"
               << "  --time-mul <mnoznik>  "
               << "Mnoznik czasu symulacji, domyslnie 1000\n"
               << "Argumenty dyrektora:\n"
@@ -27,17 +33,69 @@ void print_usage(char* program_name) {
               << "  --X1 <limit>    "
               << "Limit przyjec dla urzednikow SA (na urzednika), domyslnie 2000\n"
               << "  --X2 <limit>    "
-              << "Limit przyjec dla urzednika SC, domyslnie 1000\n"
+              << "Limit przyjec dla urzednikow SC (na urzednika), domyslnie 1000\n"
               << "  --X3 <limit>    "
-              << "Limit przyjec dla urzednika KM, domyslnie 1000\n"
+              << "Limit przyjec dla urzednikow KM (na urzednika), domyslnie 1000\n"
               << "  --X4 <limit>    "
-              << "Limit przyjec dla urzednika ML, domyslnie 1000\n"
+              << "Limit przyjec dla urzednikow ML (na urzednika), domyslnie 1000\n"
               << "  --X5 <limit>    "
-              << "Limit przyjec dla urzednika PD, domyslnie 1000\n"
+              << "Limit przyjec dla urzednikow PD (na urzednika), domyslnie 1000\n"
+              << "  --urzednicy [wydzial=]<liczba>  "
+              << "Liczba urzednikow wydzialu (wszystkich bez wydzialu), domyslnie SA=2, pozostale 1\n"
+              << "  --urzednicy-max [wydzial=]<liczba>  "
+              << "Wlacza autoskalowanie urzednikow wydzialu wg dlugosci kolejki i czasu oczekiwania, do podanej "
+                 "liczby\n"
+              << "  --rejestracja-policy <threshold|ewma|pid>  "
+              << "Polityka skalowania biletomatow: progi kolejki, prognoza z EWMA naplywu albo regulator PID "
+                 "czasu oczekiwania, domyslnie threshold\n"
+              << "  --rejestracja-min <liczba>  "
+              << "Minimalna liczba biletomatow (1-" << scaling::kMaxTicketMachines << "), domyslnie 1\n"
+              << "  --rejestracja-max <liczba>  "
+              << "Maksymalna liczba biletomatow (1-" << scaling::kMaxTicketMachines << "), domyslnie 3\n"
+              << "  --rejestracja-target-wait <sek>  "
+              << "Docelowy czas oczekiwania na bilet dla polityki pid, domyslnie 120\n"
+              << "  --kasy <liczba>  "
+              << "Liczba okienek kasy obslugujacych wspolna kolejke oplat (1-" << kMaxKasaWindows << "), domyslnie 1\n"
+              << "  --kasy-max <liczba>  "
+              << "Wlacza autoskalowanie okienek kasy wg dlugosci kolejki oplat, do podanej liczby\n"
+              << "  --cpus <rola>=<lista>  "
+              << "Procesory roli, np. rejestracja=1 lub SA=2-3,6 (role: dyrektor, rejestracja, kasa, generator, "
+                 "petent, urzednik albo wydzial SC/KM/ML/PD/SA); opcja moze sie powtarzac, domyslnie bez przypiecia\n"
+              << "  --realtime <none|fifo|rr>  "
+              << "Klasa czasu rzeczywistego zegara i biletomatow, gdy proces ma uprawnienia, domyslnie none\n"
+              << "  --realtime-priority <1-99>  "
+              << "Priorytet dla --realtime, domyslnie 10\n"
               << "  --gen-from-dyrektor  "
               << "Uruchamia generator petentow jako proces potomny dyrektora\n"
+              << "  --des  "
+              << "Symulacja zdarzeniowa w czasie wirtualnym, w jednym procesie i bez opoznien; zapisuje te same "
+                 "podsumowania dni\n"
+              << "  --des-days <liczba>  "
+              << "Liczba dni symulacji zdarzeniowej, domyslnie 1\n"
+              << "  --des-seed <liczba>  "
+              << "Ziarno generatora losowego symulacji zdarzeniowej (powtarzalne wyniki), domyslnie losowe\n"
               << "  --one-day  "
               << "Uruchamia tylko jeden dzien symulacji (tryb testowy)\n"
+              << "  --log-ring  "
+              << "Zapis logow przez bufor w pamieci wspoldzielonej oprozniany przez dyrektora\n"
+              << "  --log-ring-full <block|drop>  "
+              << "Zachowanie przy pelnym buforze logow, domyslnie block\n"
+              << "  --log-format <text|binary>  "
+              << "Format logu; binary zapisuje ./so_projekt.bin, domyslnie text\n"
+              << "  --log-level [rola=]<poziom>  "
+              << "Minimalny poziom logu (emerg..debug) dla wszystkich lub jednej roli, domyslnie debug\n"
+              << "  --log-rate [rola=]<wpisy/s>  "
+              << "Limit wpisow Info/Debug na sekunde dla kazdego rodzaju komunikatu, domyslnie bez limitu\n"
+              << "  --log-sample [rola=]<N>  "
+              << "Zapisuje co N-ty wpis Info/Debug danego rodzaju, domyslnie 1\n"
+              << "  --transport <sysv|shm|posix>  "
+              << "Kolejki komunikatow: SysV, pierscienie w pamieci wspoldzielonej albo kolejki POSIX, domyslnie sysv\n"
+              << "  --sample-interval <sek>  "
+              << "Co ile sekund czasu symulacji zapisywac probki kolejek do /tmp/so_projekt_samples_day_N, "
+                 "domyslnie 0 (wylaczone)\n"
+              << "Argumenty logdump:\n"
+              << "  --log-in <plik>  "
+              << "Binarny log do zdekodowania, domyslnie ./so_projekt.bin\n"
               << "Argumenty generatora petentow:\n"
               << "  --gen-min-delay <sek>  "
               << "Minimalne opoznienie miedzy petentami, domyslnie 1\n"
@@ -45,9 +103,16 @@ void print_usage(char* program_name) {
               << "Maksymalne opoznienie miedzy petentami, domyslnie 5\n"
               << "  --gen-max-count <liczba>  "
               << "Maksymalna liczba wygenerowanych petentow (opcjonalnie)\n"
+              << "  --petent-host <process|thread|zygote>  "
+              << "Petenci jako osobne procesy (exec), watki generatora albo procesy z zygoty, domyslnie process\n"
+              << "  --petent-threads <liczba>  "
+              << "Maksymalna liczba petentow obslugiwanych naraz przez watki generatora, domyslnie 4096\n"
               << "Argumenty urzednika:\n"
               << "  --dept <SC|KM|ML|PD|SA>  "
-              << "Wydzial urzednika/petenta\n";
+              << "Wydzial urzednika/petenta\n"
+              << "Argumenty kasy:\n"
+              << "  --window <numer>  "
+              << "Numer okienka kasy (1-" << kMaxKasaWindows << ")\n";
 }
 
 struct Config {
@@ -69,6 +134,105 @@ struct Config {
     bool vip = false;
     bool has_child = false;
     std::optional<UrzednikRole> urzednik_role;
+    LogOptions log_options;
+    MsgTransport transport = MsgTransport::SysV;
+    int sample_interval_sec = 0;
+    PetentHost petent_host = PetentHost::Process;
+    int petent_threads = 4096;
+    ClerkCounts clerk_counts = {1, 1, 1, 1, 2}; // SC, KM, ML, PD, SA
+    ClerkCounts clerk_max = {}; // 0: no autoscaling, the department keeps clerk_counts
+    scaling::PolicyConfig ticket_scaling;
+    // Kasa windows, scaled on the payment queue by the threshold policy; max 0 means no autoscaling (min windows)
+    scaling::PolicyConfig kasa_scaling{scaling::PolicyKind::Threshold, 1, 0};
+    int kasa_window = 1;
+    bool des = false;
+    int des_days = 1;
+    std::optional<uint64_t> des_seed;
+    PlacementConfig placement{};
+    std::string log_input = "./so_projekt.bin";
+
+    // "[rola=]wartosc": returns the roles the option applies to (all when no role is given)
+    static std::optional<std::vector<Identity>> parse_identity_option(const std::string& option, std::string_view arg,
+                                                                      std::string_view& value) {
+        std::vector<Identity> targets;
+        size_t separator = arg.find('=');
+        if (separator == std::string_view::npos) {
+            for (size_t idx = 0; idx < kIdentityCount; ++idx) {
+                targets.push_back(static_cast<Identity>(idx));
+            }
+            value = arg;
+            return targets;
+        }
+        auto target = string_to_identity(arg.substr(0, separator));
+        if (!target) {
+            std::cerr << "Blad: Nieznana rola w " << option << ": " << arg << "\n";
+            return std::nullopt;
+        }
+        targets.push_back(*target);
+        value = arg.substr(separator + 1);
+        return targets;
+    }
+
+    // "[wydzial=]liczba" for the per-department clerk options; no department sets all of them
+    static bool parse_clerk_option(const std::string& option, std::string_view arg, ClerkCounts& counts) {
+        std::vector<UrzednikRole> targets = {UrzednikRole::SC, UrzednikRole::KM, UrzednikRole::ML, UrzednikRole::PD,
+                                             UrzednikRole::SA};
+        std::string_view value = arg;
+        size_t separator = arg.find('=');
+        if (separator != std::string_view::npos) {
+            auto target = string_to_urzednik_role(arg.substr(0, separator));
+            if (!target) {
+                std::cerr << "Blad: Nieznany wydzial w " << option << ": " << arg << "\n";
+                return false;
+            }
+            targets = {*target};
+            value = arg.substr(separator + 1);
+        }
+        int count = std::stoi(std::string(value));
+        if (count < 1 || count > kMaxClerksPerDepartment) {
+            std::cerr << "Blad: " << option << " musi byc w zakresie 1-" << kMaxClerksPerDepartment << "\n";
+            return false;
+        }
+        for (UrzednikRole target : targets) {
+            counts[static_cast<size_t>(target)] = count;
+        }
+        return true;
+    }
+
+    // "rola=lista" for --cpus; "urzednik" sets every department
+    static bool parse_cpus_option(std::string_view arg, PlacementConfig& placement) {
+        size_t separator = arg.find('=');
+        cpu_set_t cpus;
+        if (separator == std::string_view::npos || !placement::parse_cpu_list(arg.substr(separator + 1), cpus)) {
+            std::cerr << "Blad: --cpus oczekuje <rola>=<lista procesorow>: " << arg << "\n";
+            return false;
+        }
+        std::string_view role = arg.substr(0, separator);
+        std::vector<std::pair<std::string_view, cpu_set_t*>> roles = {{"dyrektor", &placement.dyrektor},
+                                                                      {"rejestracja", &placement.rejestracja},
+                                                                      {"kasa", &placement.kasa},
+                                                                      {"generator", &placement.generator},
+                                                                      {"petent", &placement.petent}};
+        for (size_t idx = 0; idx < kDepartmentCount; ++idx) {
+            auto dept = urzednik_role_to_string(static_cast<UrzednikRole>(idx)).value_or("?");
+            roles.emplace_back(dept, &placement.urzednik[idx]);
+            roles.emplace_back("urzednik", &placement.urzednik[idx]);
+        }
+        std::vector<cpu_set_t*> targets;
+        for (const auto& [name, target] : roles) {
+            if (name == role) {
+                targets.push_back(target);
+            }
+        }
+        if (targets.empty()) {
+            std::cerr << "Blad: Nieznana rola w --cpus: " << arg << "\n";
+            return false;
+        }
+        for (cpu_set_t* target : targets) {
+            *target = cpus;
+        }
+        return true;
+    }
 
     static std::optional<Config> parse_arguments(int argc, char* argv[]) {
         Config config;
@@ -171,9 +335,197 @@ struct Config {
             else if (arg == "--gen-from-dyrektor") {
                 config.spawn_generator = true;
             }
+            else if (arg == "--des") {
+                config.des = true;
+            }
+            else if (arg == "--des-days" && i + 1 < argc) {
+                config.des_days = std::stoi(argv[++i]);
+                if (config.des_days < 1) {
+                    std::cerr << "Blad: --des-days musi byc >= 1\n";
+                    return std::nullopt;
+                }
+            }
+            else if (arg == "--des-seed" && i + 1 < argc) {
+                config.des_seed = std::stoull(argv[++i]);
+            }
             else if (arg == "--one-day") {
                 config.one_day = true;
             }
+            else if (arg == "--log-ring") {
+                config.log_options.ring.enabled = true;
+            }
+            else if (arg == "--log-ring-full" && i + 1 < argc) {
+                std::string policy = argv[++i];
+                if (policy == "block") {
+                    config.log_options.ring.full_policy = logring::FullPolicy::Block;
+                }
+                else if (policy == "drop") {
+                    config.log_options.ring.full_policy = logring::FullPolicy::Drop;
+                }
+                else {
+                    std::cerr << "Blad: --log-ring-full musi byc block lub drop\n";
+                    return std::nullopt;
+                }
+            }
+            else if (arg == "--log-format" && i + 1 < argc) {
+                std::string log_format = argv[++i];
+                if (log_format == "text") {
+                    config.log_options.format = LogFormat::Text;
+                }
+                else if (log_format == "binary") {
+                    config.log_options.format = LogFormat::Binary;
+                }
+                else {
+                    std::cerr << "Blad: --log-format musi byc text lub binary\n";
+                    return std::nullopt;
+                }
+            }
+            else if (arg == "--transport" && i + 1 < argc) {
+                auto transport = string_to_msg_transport(argv[++i]);
+                if (!transport) {
+                    std::cerr << "Blad: --transport musi byc sysv, shm lub posix\n";
+                    return std::nullopt;
+                }
+                config.transport = *transport;
+            }
+            else if (arg == "--sample-interval" && i + 1 < argc) {
+                config.sample_interval_sec = std::stoi(argv[++i]);
+                if (config.sample_interval_sec < 0) {
+                    std::cerr << "Blad: --sample-interval musi byc >= 0\n";
+                    return std::nullopt;
+                }
+            }
+            else if (arg == "--petent-host" && i + 1 < argc) {
+                auto petent_host = string_to_petent_host(argv[++i]);
+                if (!petent_host) {
+                    std::cerr << "Blad: --petent-host musi byc process, thread lub zygote\n";
+                    return std::nullopt;
+                }
+                config.petent_host = *petent_host;
+            }
+            else if (arg == "--petent-threads" && i + 1 < argc) {
+                config.petent_threads = std::stoi(argv[++i]);
+                if (config.petent_threads < 1) {
+                    std::cerr << "Blad: --petent-threads musi byc >= 1\n";
+                    return std::nullopt;
+                }
+            }
+            else if (arg == "--urzednicy" && i + 1 < argc) {
+                if (!parse_clerk_option(arg, argv[++i], config.clerk_counts)) {
+                    return std::nullopt;
+                }
+            }
+            else if (arg == "--urzednicy-max" && i + 1 < argc) {
+                if (!parse_clerk_option(arg, argv[++i], config.clerk_max)) {
+                    return std::nullopt;
+                }
+            }
+            else if (arg == "--rejestracja-policy" && i + 1 < argc) {
+                auto kind = scaling::string_to_policy_kind(argv[++i]);
+                if (!kind) {
+                    std::cerr << "Blad: --rejestracja-policy musi byc threshold, ewma lub pid\n";
+                    return std::nullopt;
+                }
+                config.ticket_scaling.kind = *kind;
+            }
+            else if ((arg == "--rejestracja-min" || arg == "--rejestracja-max") && i + 1 < argc) {
+                int machines = std::stoi(argv[++i]);
+                if (machines < 1 || machines > scaling::kMaxTicketMachines) {
+                    std::cerr << "Blad: " << arg << " musi byc w zakresie 1-" << scaling::kMaxTicketMachines << "\n";
+                    return std::nullopt;
+                }
+                if (arg == "--rejestracja-min") {
+                    config.ticket_scaling.min_machines = machines;
+                }
+                else {
+                    config.ticket_scaling.max_machines = machines;
+                }
+            }
+            else if (arg == "--rejestracja-target-wait" && i + 1 < argc) {
+                int target_wait = std::stoi(argv[++i]);
+                if (target_wait < 1) {
+                    std::cerr << "Blad: --rejestracja-target-wait musi byc >= 1\n";
+                    return std::nullopt;
+                }
+                config.ticket_scaling.target_wait_sec = static_cast<uint32_t>(target_wait);
+            }
+            else if ((arg == "--kasy" || arg == "--kasy-max") && i + 1 < argc) {
+                int windows = std::stoi(argv[++i]);
+                if (windows < 1 || windows > kMaxKasaWindows) {
+                    std::cerr << "Blad: " << arg << " musi byc w zakresie 1-" << kMaxKasaWindows << "\n";
+                    return std::nullopt;
+                }
+                if (arg == "--kasy") {
+                    config.kasa_scaling.min_machines = windows;
+                }
+                else {
+                    config.kasa_scaling.max_machines = windows;
+                }
+            }
+            else if (arg == "--window" && i + 1 < argc) {
+                config.kasa_window = std::stoi(argv[++i]);
+                if (config.kasa_window < 1 || config.kasa_window > kMaxKasaWindows) {
+                    std::cerr << "Blad: --window musi byc w zakresie 1-" << kMaxKasaWindows << "\n";
+                    return std::nullopt;
+                }
+            }
+            else if (arg == "--cpus" && i + 1 < argc) {
+                if (!parse_cpus_option(argv[++i], config.placement)) {
+                    return std::nullopt;
+                }
+            }
+            else if (arg == "--realtime" && i + 1 < argc) {
+                auto policy = string_to_realtime_policy(argv[++i]);
+                if (!policy) {
+                    std::cerr << "Blad: --realtime musi byc none, fifo lub rr\n";
+                    return std::nullopt;
+                }
+                config.placement.realtime = *policy;
+            }
+            else if (arg == "--realtime-priority" && i + 1 < argc) {
+                int priority = std::stoi(argv[++i]);
+                if (priority < 1 || priority > 99) {
+                    std::cerr << "Blad: --realtime-priority musi byc w zakresie 1-99\n";
+                    return std::nullopt;
+                }
+                config.placement.realtime_priority = priority;
+            }
+            else if (arg == "--log-level" && i + 1 < argc) {
+                std::string_view level_arg;
+                auto targets = parse_identity_option(arg, argv[++i], level_arg);
+                auto level = string_to_log_severity(level_arg);
+                if (!targets || !level) {
+                    std::cerr << "Blad: Nieprawidlowy poziom logu: " << argv[i] << "\n";
+                    return std::nullopt;
+                }
+                for (Identity target : *targets) {
+                    config.log_options.min_severity[static_cast<size_t>(target)] = *level;
+                }
+            }
+            else if ((arg == "--log-rate" || arg == "--log-sample") && i + 1 < argc) {
+                std::string_view value_arg;
+                auto targets = parse_identity_option(arg, argv[++i], value_arg);
+                if (!targets) {
+                    return std::nullopt;
+                }
+                int value = std::stoi(std::string(value_arg));
+                if (value < 0 || (arg == "--log-sample" && value < 1)) {
+                    std::cerr << "Blad: Nieprawidlowa wartosc " << arg << ": " << value_arg << "\n";
+                    return std::nullopt;
+                }
+                for (Identity target : *targets) {
+                    lograte::Limit& limit = config.log_options.limits[static_cast<size_t>(target)];
+                    if (arg == "--log-rate") {
+                        limit.rate_per_sec = static_cast<uint32_t>(value);
+                    }
+                    else {
+                        limit.sample_every = static_cast<uint32_t>(value);
+                    }
+                }
+            }
+            else if (arg == "--log-in" && i + 1 < argc) {
+                config.log_input = argv[++i];
+            }
             else if (arg == "--vip") {
                 config.vip = true;
             }
@@ -205,10 +557,45 @@ struct Config {
             return std::nullopt;
         }
 
+        if (config.ticket_scaling.min_machines > config.ticket_scaling.max_machines) {
+            std::cerr << "Blad: --rejestracja-min nie moze byc wiekszy niz --rejestracja-max\n";
+            return std::nullopt;
+        }
+
+        if (config.kasa_scaling.max_machines == 0) {
+            config.kasa_scaling.max_machines = config.kasa_scaling.min_machines;
+        }
+        else if (config.kasa_scaling.max_machines < config.kasa_scaling.min_machines) {
+            std::cerr << "Blad: --kasy-max nie moze byc mniejszy niz --kasy\n";
+            return std::nullopt;
+        }
+
+        for (size_t idx = 0; idx < kDepartmentCount; ++idx) {
+            if (config.clerk_max[idx] == 0) {
+                config.clerk_max[idx] = config.clerk_counts[idx];
+            }
+            else if (config.clerk_max[idx] < config.clerk_counts[idx]) {
+                std::cerr << "Blad: --urzednicy-max nie moze byc mniejszy niz --urzednicy\n";
+                return std::nullopt;
+            }
+        }
+
         return config;
     }
 };
 
+static std::string format_clerk_counts(const ClerkCounts& counts) {
+    std::string out;
+    for (size_t idx = 0; idx < kDepartmentCount; ++idx) {
+        if (idx > 0) {
+            out += ",";
+        }
+        out += std::string(urzednik_role_to_string(static_cast<UrzednikRole>(idx)).value_or("?")) + ":" +
+               std::to_string(counts[idx]);
+    }
+    return out;
+}
+
 int main(int argc, char* argv[]) {
     Logger::set_log_file("./so_projekt.log");
     auto config = Config::parse_arguments(argc, argv);
@@ -217,26 +604,57 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    if (config->role == Identity::LogDump) {
+        return logdump_main(config->log_input);
+    }
+
     if (config->role == Identity::Dyrektor) {
+        Logger::set_format(config->log_options.format);
+        Logger::set_min_severity(config->log_options.min_severity);
         Logger::clear_log();
     }
+    else {
+        Logger::attach_shared_log();
+    }
 
-    Logger::log(LogSeverity::Debug, config->role, "Config:" 
-        " Tp=" + std::to_string(config->Tp) +
-        " Tk=" + std::to_string(config->Tk) +
-        " N=" + std::to_string(config->building_capacity) +
-        " X1=" + std::to_string(config->X1) +
-        " X2=" + std::to_string(config->X2) +
-        " X3=" + std::to_string(config->X3) +
-        " X4=" + std::to_string(config->X4) +
-        " X5=" + std::to_string(config->X5) +
-        " time_mul=" + std::to_string(config->time_mul) +
-        " gen_min_delay=" + std::to_string(config->gen_min_delay_sec) +
-        " gen_max_delay=" + std::to_string(config->gen_max_delay_sec) +
-        " gen_max_count=" + std::to_string(config->gen_max_count) +
-        " gen_from_dyrektor=" + std::to_string(config->spawn_generator) +
-        " one_day=" + std::to_string(config->one_day)
-    );
+    // Spawned roles read their parameters from SharedState::config, so only dyrektor's argv is meaningful
+    if (config->role == Identity::Dyrektor) {
+        Logger::log<LogSeverity::Debug>(config->role, [&] { return "Config:"
+            " Tp=" + std::to_string(config->Tp) +
+            " Tk=" + std::to_string(config->Tk) +
+            " N=" + std::to_string(config->building_capacity) +
+            " X1=" + std::to_string(config->X1) +
+            " X2=" + std::to_string(config->X2) +
+            " X3=" + std::to_string(config->X3) +
+            " X4=" + std::to_string(config->X4) +
+            " X5=" + std::to_string(config->X5) +
+            " time_mul=" + std::to_string(config->time_mul) +
+            " gen_min_delay=" + std::to_string(config->gen_min_delay_sec) +
+            " gen_max_delay=" + std::to_string(config->gen_max_delay_sec) +
+            " gen_max_count=" + std::to_string(config->gen_max_count) +
+            " gen_from_dyrektor=" + std::to_string(config->spawn_generator) +
+            " one_day=" + std::to_string(config->one_day) +
+            " log_ring=" + std::to_string(config->log_options.ring.enabled) +
+            " log_binary=" + std::to_string(config->log_options.format == LogFormat::Binary) +
+            " transport=" + std::string(msg_transport_to_string(config->transport)) +
+            " sample_interval=" + std::to_string(config->sample_interval_sec) +
+            " petent_host=" + std::string(petent_host_to_string(config->petent_host)) +
+            " petent_threads=" + std::to_string(config->petent_threads) +
+            " urzednicy=" + format_clerk_counts(config->clerk_counts) +
+            " urzednicy_max=" + format_clerk_counts(config->clerk_max) +
+            " rejestracja_policy=" + std::string(scaling::policy_kind_to_string(config->ticket_scaling.kind)) +
+            " rejestracja_min=" + std::to_string(config->ticket_scaling.min_machines) +
+            " rejestracja_max=" + std::to_string(config->ticket_scaling.max_machines) +
+            " rejestracja_target_wait=" + std::to_string(config->ticket_scaling.target_wait_sec) +
+            " kasy=" + std::to_string(config->kasa_scaling.min_machines) +
+            " kasy_max=" + std::to_string(config->kasa_scaling.max_machines) +
+            " des=" + std::to_string(config->des) +
+            " des_days=" + std::to_string(config->des_days) +
+            " cpus=" + placement::describe(config->placement) +
+            " realtime=" + std::string(realtime_policy_to_string(config->placement.realtime)) +
+            " realtime_priority=" + std::to_string(config->placement.realtime_priority);
+        });
+    }
 
     switch (config->role) {
         case Identity::Dyrektor:
@@ -248,9 +666,19 @@ int main(int argc, char* argv[]) {
                 static_cast<uint32_t>(config->X4),
                 static_cast<uint32_t>(config->X5)
             };
+            if (config->des) {
+                uint64_t seed = config->des_seed ? *config->des_seed : std::random_device{}();
+                des::run({{config->Tp, config->Tk}, department_limits, config->clerk_counts, config->gen_min_delay_sec,
+                          config->gen_max_delay_sec, config->gen_max_count, config->building_capacity,
+                          config->ticket_scaling.min_machines, config->kasa_scaling, config->des_days, seed});
+                break;
+            }
             dyrektor_main({config->Tp, config->Tk}, department_limits, config->time_mul,
                           config->gen_min_delay_sec, config->gen_max_delay_sec, config->gen_max_count,
-                          config->spawn_generator, config->one_day, config->building_capacity);
+                          config->spawn_generator, config->one_day, config->building_capacity, config->log_options,
+                          config->transport, config->sample_interval_sec, config->petent_host,
+                          config->petent_threads, config->clerk_counts, config->clerk_max,
+                          config->ticket_scaling, config->kasa_scaling, config->placement);
             break;
         }
         case Identity::Rejestracja:
@@ -271,14 +699,16 @@ int main(int argc, char* argv[]) {
             petent_main(*config->urzednik_role, config->vip, config->has_child);
             break;
         case Identity::Generator:
-            generator_main(config->gen_min_delay_sec, config->gen_max_delay_sec, config->time_mul,
-                           config->gen_max_count);
+            generator_main();
             break;
         case Identity::Kasa:
-            kasa_main();
+            kasa_main(config->kasa_window);
+            break;
+        case Identity::LogDump:
             break;
     }
 
     Logger::log(LogSeverity::Debug, config->role, "Koniec dzialania procesu.");
+    Logger::detach_shared_log();
     return 0;
 }
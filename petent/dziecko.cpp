@@ -11,9 +11,9 @@ static void* child_thread_func(void* arg) {
     // Signals should go to the main thread
     ipc::block_signals({SIGUSR2, SIGTERM, SIGINT});
 
-    Logger::log(LogSeverity::Info, Identity::Petent,
-                "Dziecko (rodzic PID: " + std::to_string(data->parent_pid) +
-                ") wchodzi do urzedu z rodzicem.");
+    Logger::log<LogSeverity::Info>(Identity::Petent, [&] {
+        return "Dziecko (rodzic PID: " + std::to_string(data->parent_pid) + ") wchodzi do urzedu z rodzicem.";
+    });
 
     ipc::mutex::lock(&data->mutex);
     while (!data->done && !(*data->evacuating)) {
@@ -21,13 +21,13 @@ static void* child_thread_func(void* arg) {
     }
 
     if (*data->evacuating) {
-        Logger::log(LogSeverity::Notice, Identity::Petent,
-                    "Dziecko (rodzic PID: " + std::to_string(data->parent_pid) +
-                    ") - ewakuacja z rodzicem.");
+        Logger::log<LogSeverity::Notice>(Identity::Petent, [&] {
+            return "Dziecko (rodzic PID: " + std::to_string(data->parent_pid) + ") - ewakuacja z rodzicem.";
+        });
     } else {
-        Logger::log(LogSeverity::Info, Identity::Petent,
-                    "Dziecko (rodzic PID: " + std::to_string(data->parent_pid) +
-                    ") opuszcza urzad z rodzicem.");
+        Logger::log<LogSeverity::Info>(Identity::Petent, [&] {
+            return "Dziecko (rodzic PID: " + std::to_string(data->parent_pid) + ") opuszcza urzad z rodzicem.";
+        });
     }
     ipc::mutex::unlock(&data->mutex);
 
@@ -1,4 +1,7 @@
 #include "generator.h"
+#include "host.h"
+#include "zygote.h"
+#include <algorithm>
 #include <chrono>
 #include <csignal>
 #include <string>
@@ -9,11 +12,19 @@
 #include "../common.h"
 #include "../ipcutils.h"
 #include "../logger.h"
+#include "../placement.h"
 
 static volatile sig_atomic_t generator_running = 1;
+static volatile sig_atomic_t evacuation_requested = 0;
+
+// While the generator waits for hosted petents to leave, and while the hosting slots are all taken
+constexpr int kHostPollMs = 10;
 
 static void handle_shutdown_signal(int) { generator_running = 0; }
 
+// Only installed when petents are hosted as threads; the hosted petents are evacuated from the main loop
+static void handle_evacuation_signal(int) { evacuation_requested = 1; }
+
 static UrzednikRole choose_department() {
     int roll = rng::random_int(1, 100);
     if (roll <= 60) {
@@ -31,40 +42,58 @@ static UrzednikRole choose_department() {
     return UrzednikRole::PD;
 }
 
-static pid_t spawn_petent() {
+struct PetentProfile {
+    UrzednikRole department;
+    bool is_vip;
+    bool has_child;
+};
+
+static PetentProfile draw_petent() {
+    PetentProfile profile{};
+    profile.department = choose_department();
+    profile.is_vip = rng::random_int(1, 10) == 1;
+    profile.has_child = rng::random_int(1, 10) == 1;
+
+    LogEvent generated = LogEvent::GeneratePetent;
+    if (profile.is_vip && profile.has_child) generated = LogEvent::GeneratePetentVipChild;
+    else if (profile.is_vip) generated = LogEvent::GeneratePetentVip;
+    else if (profile.has_child) generated = LogEvent::GeneratePetentChild;
+    Logger::event(profile.is_vip ? LogSeverity::Notice : LogSeverity::Info, Identity::Generator, generated,
+                  profile.department);
+    return profile;
+}
+
+static pid_t spawn_petent(const cpu_set_t& petent_cpus) {
+    // Stamped before the fork so the petent's startup latency includes fork and exec
+    uint64_t arrival_ns = ipc::monotonic_ns();
     pid_t pid = fork();
     if (pid == -1) {
         perror("fork failed");
         return -1;
     }
     if (pid == 0) {
-        UrzednikRole department = choose_department();
-        auto dept_name = urzednik_role_to_string(department);
+        // Before exec, which keeps the set; the generator's own set would otherwise be inherited
+        placement::pin_self(petent_cpus);
+        PetentProfile profile = draw_petent();
+        auto dept_name = urzednik_role_to_string(profile.department);
         if (!dept_name) {
             Logger::log(LogSeverity::Err, Identity::Generator, "Nieznany wydzial petenta.");
             _exit(1);
         }
 
-        bool is_vip = rng::random_int(1, 10) == 1;
-        bool has_child = rng::random_int(1, 10) == 1;
-
-        // Build log message
-        std::string log_msg = "Generuje petenta";
-        if (is_vip) log_msg += " VIP";
-        if (has_child) log_msg += " z dzieckiem";
-        log_msg += " do wydzialu " + std::string(*dept_name) + ".";
-        Logger::log(is_vip ? LogSeverity::Notice : LogSeverity::Info,
-                    Identity::Generator, log_msg);
-
         // Build exec arguments dynamically
         std::string dept_str(*dept_name);
         std::vector<const char*> args = {
             "so_projekt", "--role", "petent", "--dept", dept_str.c_str()
         };
-        if (is_vip) args.push_back("--vip");
-        if (has_child) args.push_back("--child");
+        if (profile.is_vip) args.push_back("--vip");
+        if (profile.has_child) args.push_back("--child");
         args.push_back(nullptr);
 
+        if (setenv(ipc::helper::kArrivalEnv, std::to_string(arrival_ns).c_str(), 1) == -1) {
+            perror("setenv failed");
+        }
+
         execv("/proc/self/exe", const_cast<char* const*>(args.data()));
         perror("exec failed");
         _exit(1);
@@ -72,6 +101,27 @@ static pid_t spawn_petent() {
     return pid;
 }
 
+static int host_petent() {
+    uint64_t arrival_ns = ipc::monotonic_ns();
+    PetentProfile profile = draw_petent();
+    return petent_host::spawn(profile.department, profile.is_vip, profile.has_child, arrival_ns);
+}
+
+static int request_petent() {
+    uint64_t arrival_ns = ipc::monotonic_ns();
+    PetentProfile profile = draw_petent();
+    return petent_zygote::request(profile.department, profile.is_vip, profile.has_child, arrival_ns);
+}
+
+// Forwards an evacuation that reached the generator to its hosted petents, and joins the ones that have left
+static void tend_hosted_petents() {
+    if (evacuation_requested) {
+        evacuation_requested = 0;
+        petent_host::evacuate();
+    }
+    petent_host::reap();
+}
+
 static void reap_children() {
     int status = 0;
     while (waitpid(-1, &status, WNOHANG) > 0) {
@@ -92,7 +142,7 @@ static void sleep_scaled_seconds(int seconds, int time_mul) {
     std::this_thread::sleep_for(std::chrono::milliseconds(base_ms * seconds));
 }
 
-int generator_main(int min_delay_sec, int max_delay_sec, int time_mul, int max_count) {
+int generator_main() {
     ipc::install_signal_handler(SIGTERM, handle_shutdown_signal);
     ipc::install_signal_handler(SIGINT, SIG_IGN);
     ipc::install_signal_handler(SIGUSR2, SIG_IGN);
@@ -104,6 +154,15 @@ int generator_main(int min_delay_sec, int max_delay_sec, int time_mul, int max_c
         return 1;
     }
 
+    // Already pinned when spawned by dyrektor; a generator started on its own applies its set here
+    placement::pin_self(shared_state->config.placement.generator);
+    const cpu_set_t petent_cpus = shared_state->config.placement.petent;
+
+    int min_delay_sec = shared_state->config.gen_min_delay_sec;
+    int max_delay_sec = shared_state->config.gen_max_delay_sec;
+    int time_mul = shared_state->config.time_mul;
+    int max_count = shared_state->config.gen_max_count;
+
     if (min_delay_sec < 0) {
         min_delay_sec = 0;
     }
@@ -111,21 +170,64 @@ int generator_main(int min_delay_sec, int max_delay_sec, int time_mul, int max_c
         max_delay_sec = min_delay_sec;
     }
 
-    int generated_count = 0;
     if (max_count == 0) {
         Logger::log(LogSeverity::Notice, Identity::Generator, "Limit petentow ustawiony na 0 - generator konczy prace.");
         ipc::shm::detach(shared_state);
         return 0;
     }
 
+    // Hosted petents write to SharedState, so the read-only attachment is swapped for a writable one
+    PetentHost petent_host = shared_state->config.petent_host;
+    bool hosting = petent_host == PetentHost::Thread;
+    if (hosting) {
+        size_t max_hosted = static_cast<size_t>(std::max(shared_state->config.petent_threads, 1));
+        ipc::shm::detach(shared_state);
+        shared_state = ipc::helper::get_shared_state(false);
+        if (!shared_state) {
+            return 1;
+        }
+        if (petent_host::start(shared_state, max_hosted) == -1) {
+            Logger::log(LogSeverity::Err, Identity::Generator, "Nie udalo sie przygotowac watkow petentow.");
+            ipc::shm::detach(shared_state);
+            return 1;
+        }
+        ipc::install_signal_handler(SIGUSR2, handle_evacuation_signal);
+        Logger::log(LogSeverity::Info, Identity::Generator,
+                    "Petenci obslugiwani jako watki generatora (max " + std::to_string(max_hosted) + ").");
+    }
+    if (petent_host == PetentHost::Zygote) {
+        // A zygote that died must surface as a failed request, not kill the generator
+        ipc::install_signal_handler(SIGPIPE, SIG_IGN);
+        if (petent_zygote::start() == -1) {
+            Logger::log(LogSeverity::Err, Identity::Generator, "Nie udalo sie uruchomic zygoty petentow.");
+            ipc::shm::detach(shared_state);
+            return 1;
+        }
+        Logger::log(LogSeverity::Info, Identity::Generator, "Petenci tworzeni przez zygote generatora.");
+    }
+
+    int generated_count = 0;
+
     while (generator_running) {
         if (max_count > 0 && generated_count >= max_count) {
             Logger::log(LogSeverity::Notice, Identity::Generator,
                         "Osiagnieto limit generowania petentow: " + std::to_string(max_count) + ".");
             break;
         }
-        if (shared_state->office_status == OfficeStatus::Open) {
-            if (spawn_petent() == -1) {
+        if (hosting) {
+            tend_hosted_petents();
+            if (petent_host::full()) {
+                // Every hosting slot is taken: the next arrival waits until a hosted petent leaves
+                std::this_thread::sleep_for(std::chrono::milliseconds(kHostPollMs));
+                continue;
+            }
+        }
+        if (shared_state->is_open()) {
+            if (hosting && host_petent() == -1) {
+                Logger::log(LogSeverity::Err, Identity::Generator, "Nie udalo sie utworzyc watku petenta.");
+            } else if (petent_host == PetentHost::Zygote && request_petent() == -1) {
+                Logger::log(LogSeverity::Err, Identity::Generator, "Nie udalo sie przekazac petenta do zygoty.");
+            } else if (petent_host == PetentHost::Process && spawn_petent(petent_cpus) == -1) {
                 Logger::log(LogSeverity::Err, Identity::Generator, "Nie udalo sie utworzyc procesu petenta.");
             } else {
                 generated_count++;
@@ -133,7 +235,9 @@ int generator_main(int min_delay_sec, int max_delay_sec, int time_mul, int max_c
             int delay_sec = rng::random_int(min_delay_sec, max_delay_sec);
             sleep_scaled_seconds(delay_sec, time_mul);
         } else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            // Sleeps until the clock opens the office; the timeout keeps reaping exited petents meanwhile
+            timespec timeout = ipc::futex::millis(200);
+            shared_state->office_open.wait(&timeout);
         }
 
         reap_children();
@@ -146,6 +250,17 @@ int generator_main(int min_delay_sec, int max_delay_sec, int time_mul, int max_c
         killpg(getpgrp(), SIGUSR2);
     }
 
+    // Hosted petents leave like child processes do: on their own, or evacuated once the generator is stopped
+    while (hosting && petent_host::hosted() > 0) {
+        if (!generator_running) {
+            evacuation_requested = 1;
+        }
+        tend_hosted_petents();
+        std::this_thread::sleep_for(std::chrono::milliseconds(kHostPollMs));
+    }
+    petent_host::shutdown();
+    petent_zygote::stop();
+
     // Wait for all children to exit.
     while (true) {
         int status = 0;
@@ -1,6 +1,7 @@
 #ifndef SO_PROJEKT_GENERATOR_H
 #define SO_PROJEKT_GENERATOR_H
 
-int generator_main(int min_delay_sec, int max_delay_sec, int time_mul, int max_count);
+// Delays, time multiplier and petent limit come from SharedState::config
+int generator_main();
 
 #endif // SO_PROJEKT_GENERATOR_H
@@ -0,0 +1,150 @@
+#include "host.h"
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <memory>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+#include "petent.h"
+#include "../ipcutils.h"
+#include "../logger.h"
+
+namespace petent_host {
+
+// A visit needs a few KiB of stack; the 8 MiB default is what caps the thread count, not the work
+constexpr size_t kStackSize = 128 * 1024;
+
+enum class SlotState : uint8_t { Free, Running, Left };
+
+struct Slot {
+    std::atomic<SlotState> state;
+    pthread_t thread;
+    volatile sig_atomic_t evacuating;
+    UrzednikRole department;
+    bool is_vip;
+    bool has_child;
+    uint64_t arrival_ns;
+};
+
+static SharedState* host_state = nullptr;
+static std::unique_ptr<Slot[]> slots;
+static std::vector<size_t> free_slots;
+static std::vector<size_t> running;
+static pthread_attr_t thread_attr;
+
+// Interrupts a hosted petent's blocking call (no SA_RESTART); the flag it should look at is set beforehand
+static void handle_wake_signal(int) {}
+
+static int wake_signal() { return SIGRTMIN; }
+
+static void* hosted_petent_main(void* arg) {
+    auto* slot = static_cast<Slot*>(arg);
+
+    // Evacuation and shutdown signals belong to the generator thread, which forwards them as wake_signal()
+    ipc::block_signals({SIGUSR2, SIGTERM, SIGINT});
+
+    Logger::event<LogSeverity::Info>(Identity::Petent, LogEvent::PetentStarted);
+    auto petent_id = static_cast<pid_t>(syscall(SYS_gettid));
+    petent_visit(host_state, petent_id, slot->department, slot->is_vip, slot->has_child, slot->arrival_ns,
+                 &slot->evacuating);
+
+    slot->state.store(SlotState::Left, std::memory_order_release);
+    return nullptr;
+}
+
+int start(SharedState* shared_state, size_t max_petents) {
+    host_state = shared_state;
+
+    if (petent_prepare_queues() == -1) {
+        return -1;
+    }
+
+    if (pthread_attr_init(&thread_attr) != 0 || pthread_attr_setstacksize(&thread_attr, kStackSize) != 0) {
+        perror("pthread_attr failed");
+        return -1;
+    }
+    // Hosted petents keep to the petent CPU set while the generator thread stays on its own
+    const cpu_set_t& petent_cpus = shared_state->config.placement.petent;
+    if (CPU_COUNT(&petent_cpus) > 0 &&
+        pthread_attr_setaffinity_np(&thread_attr, sizeof(petent_cpus), &petent_cpus) != 0) {
+        perror("pthread_attr_setaffinity_np failed");
+    }
+    if (ipc::install_signal_handler(wake_signal(), handle_wake_signal) == -1) {
+        return -1;
+    }
+
+    slots = std::make_unique<Slot[]>(max_petents);
+    free_slots.reserve(max_petents);
+    for (size_t i = max_petents; i > 0; --i) {
+        free_slots.push_back(i - 1);
+    }
+    running.reserve(max_petents);
+    return 0;
+}
+
+bool full() { return free_slots.empty(); }
+
+size_t hosted() { return running.size(); }
+
+int spawn(UrzednikRole department, bool is_vip, bool has_child, uint64_t arrival_ns) {
+    if (free_slots.empty()) {
+        errno = EAGAIN;
+        return -1;
+    }
+    size_t index = free_slots.back();
+    Slot& slot = slots[index];
+    slot.evacuating = 0;
+    slot.department = department;
+    slot.is_vip = is_vip;
+    slot.has_child = has_child;
+    slot.arrival_ns = arrival_ns;
+    slot.state.store(SlotState::Running, std::memory_order_relaxed);
+    if (ipc::thread::create(&slot.thread, hosted_petent_main, &slot, &thread_attr) == -1) {
+        slot.state.store(SlotState::Free, std::memory_order_relaxed);
+        return -1;
+    }
+    free_slots.pop_back();
+    running.push_back(index);
+    return 0;
+}
+
+void reap() {
+    size_t kept = 0;
+    for (size_t index : running) {
+        Slot& slot = slots[index];
+        if (slot.state.load(std::memory_order_acquire) == SlotState::Left) {
+            ipc::thread::join(slot.thread);
+            slot.state.store(SlotState::Free, std::memory_order_relaxed);
+            free_slots.push_back(index);
+            continue;
+        }
+        // The first wake-up may have landed before the petent entered its blocking call
+        if (slot.evacuating) {
+            pthread_kill(slot.thread, wake_signal());
+        }
+        running[kept++] = index;
+    }
+    running.resize(kept);
+}
+
+void evacuate() {
+    for (size_t index : running) {
+        Slot& slot = slots[index];
+        slot.evacuating = 1;
+        pthread_kill(slot.thread, wake_signal());
+    }
+}
+
+void shutdown() {
+    if (!slots) {
+        return;
+    }
+    pthread_attr_destroy(&thread_attr);
+    slots.reset();
+    free_slots.clear();
+    running.clear();
+}
+
+} // namespace petent_host
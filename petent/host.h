@@ -0,0 +1,35 @@
+#ifndef SO_PROJEKT_PETENT_HOST_H
+#define SO_PROJEKT_PETENT_HOST_H
+
+#include <cstddef>
+#include <cstdint>
+#include "../common.h"
+
+// Petents hosted as threads of the generator (--petent-host thread) instead of a fork + exec each. Every hosted
+// petent runs petent_visit() on its own small-stack thread and is addressed by its thread id. Evacuation (SIGUSR2 to
+// the process group) reaches the generator, which raises each hosted petent's flag and interrupts its blocking call.
+// All functions are called from the generator's main thread only.
+namespace petent_host {
+
+    // Resolves every queue a petent uses before any thread exists, so hosted threads only read shared handles
+    int start(SharedState* shared_state, size_t max_petents);
+
+    bool full();
+
+    size_t hosted();
+
+    // -1 when the thread cannot be created
+    int spawn(UrzednikRole department, bool is_vip, bool has_child, uint64_t arrival_ns);
+
+    // Joins petents that have left; evacuating ones that are still blocked are interrupted again
+    void reap();
+
+    // Raises the evacuation flag of every hosted petent and interrupts its blocking call
+    void evacuate();
+
+    // Releases the slots once hosted() is 0
+    void shutdown();
+
+} // namespace petent_host
+
+#endif // SO_PROJEKT_PETENT_HOST_H
@@ -5,6 +5,7 @@
 #include <cstring>
 #include <string>
 #include <unistd.h>
+#include <vector>
 #include "../ipcutils.h"
 #include "../logger.h"
 
@@ -12,73 +13,66 @@ static volatile sig_atomic_t petent_evacuating = 0;
 
 static void handle_evacuation_signal(int) { petent_evacuating = 1; }
 
-static void log_evacuation() {
-    Logger::log(LogSeverity::Notice, Identity::Petent, "Ewakuacja - petent opuszcza budynek.");
+static void log_evacuation(SharedState* shared_state) {
+    shared_state->stats.evacuated.fetch_add(1, std::memory_order_relaxed);
+    Logger::log<LogSeverity::Notice>(Identity::Petent, "Ewakuacja - petent opuszcza budynek.");
 }
 
-int petent_main(UrzednikRole department, bool is_vip, bool has_child) {
-    ipc::install_signal_handler(SIGUSR2, handle_evacuation_signal);
-    ipc::install_signal_handler(SIGTERM, handle_evacuation_signal);
-    ipc::install_signal_handler(SIGINT, handle_evacuation_signal);
-
-    Logger::log(LogSeverity::Info, Identity::Petent, "Petent uruchomiony.");
-
-    auto shared_state = ipc::helper::get_shared_state(false);
-    if (!shared_state) {
-        return 1;
+static void record_latency(LatencyStat& stat, uint64_t arrival_ns) {
+    uint64_t now_ns = ipc::monotonic_ns();
+    if (arrival_ns != 0 && now_ns >= arrival_ns) {
+        stat.record((now_ns - arrival_ns) / 1000);
     }
+}
 
-    int sem_id = ipc::helper::get_semaphore_set(2);
-    if (sem_id == -1) {
-        ipc::shm::detach(shared_state);
-        return 1;
+int petent_prepare_queues() {
+    std::vector<int> queues = {ipc::helper::get_msg_queue(ipc::KeyType::MsgQueueRejestracja),
+                               ipc::helper::get_msg_queue(ipc::KeyType::MsgQueueKasa)};
+    for (size_t i = 0; i < kDepartmentCount; ++i) {
+        queues.push_back(ipc::helper::get_role_queue(static_cast<UrzednikRole>(i)));
+    }
+    for (size_t shard = 0; shard < kReplyShardCount; ++shard) {
+        queues.push_back(ipc::helper::get_reply_queue(shard));
+    }
+    for (int msg_id : queues) {
+        if (msg_id == -1 || ipc::msg::preopen(msg_id) == -1) {
+            return -1;
+        }
     }
+    return 0;
+}
+
+int petent_visit(SharedState* shared_state, pid_t petent_id, UrzednikRole department, bool is_vip, bool has_child,
+                 uint64_t arrival_ns, volatile sig_atomic_t* evacuating) {
+    record_latency(shared_state->stats.petent_startup, arrival_ns);
 
     int msg_req_id = ipc::helper::get_msg_queue(ipc::KeyType::MsgQueueRejestracja);
     if (msg_req_id == -1) {
-        ipc::shm::detach(shared_state);
         return 1;
     }
 
-    if (petent_evacuating) {
-        log_evacuation();
-        ipc::shm::detach(shared_state);
+    // The flag covers a petent whose handler was not installed yet when the evacuation signal went out
+    if (*evacuating || shared_state->evacuation.is_set()) {
+        log_evacuation(shared_state);
         return 0;
     }
 
-    if (shared_state->office_status == OfficeStatus::Closed) {
-        Logger::log(LogSeverity::Notice, Identity::Petent, "Urzad zamkniety - petent wychodzi.");
-        ipc::shm::detach(shared_state);
+    if (!shared_state->is_open()) {
+        Logger::log<LogSeverity::Notice>(Identity::Petent, "Urzad zamkniety - petent wychodzi.");
         return 0;
     }
 
-    if (ipc::sem::wait(sem_id, 0) == -1) {
-        if (errno == EINTR && petent_evacuating) {
-            log_evacuation();
-            ipc::shm::detach(shared_state);
+    // Parent and child are admitted together, so a parent never holds a place while waiting for the child's
+    const uint32_t places = has_child ? 2 : 1;
+    if (shared_state->admission.acquire(places) == -1) {
+        if (errno == EINTR && *evacuating) {
+            log_evacuation(shared_state);
             return 0;
         }
         Logger::log(LogSeverity::Err, Identity::Petent, "Blad oczekiwania na miejsce w kolejce.");
-        ipc::shm::detach(shared_state);
         return 1;
     }
 
-    // +1 capacity if has a child
-    if (has_child) {
-        if (ipc::sem::wait(sem_id, 0) == -1) {
-            if (errno == EINTR && petent_evacuating) {
-                log_evacuation();
-                ipc::sem::post(sem_id, 0); // release parent's slot
-                ipc::shm::detach(shared_state);
-                return 0;
-            }
-            Logger::log(LogSeverity::Err, Identity::Petent, "Blad oczekiwania na miejsce dla dziecka.");
-            ipc::sem::post(sem_id, 0); // release parent's slot
-            ipc::shm::detach(shared_state);
-            return 1;
-        }
-    }
-
     // Child thread state
     bool child_spawned = false;
     ChildThreadData child_data{};
@@ -89,42 +83,29 @@ int petent_main(UrzednikRole department, bool is_vip, bool has_child) {
         if (child_spawned) {
             child_signal_done(&child_data);
             child_join_and_cleanup(&child_data, child_thread);
-            ipc::sem::post(sem_id, 0); // release child's capacity slot
+            shared_state->admission.release(1); // release child's place
         }
     };
 
     if (has_child) {
-        if (child_init(&child_data, getpid(), &petent_evacuating) == -1) {
+        if (child_init(&child_data, petent_id, evacuating) == -1) {
             Logger::log(LogSeverity::Err, Identity::Petent, "Blad inicjalizacji watku dziecka.");
-            ipc::sem::post(sem_id, 0); // release child's slot
-            ipc::sem::post(sem_id, 0); // release parent's slot
-            ipc::shm::detach(shared_state);
+            shared_state->admission.release(places);
             return 1;
         }
         if (child_start(&child_data, &child_thread) == -1) {
             Logger::log(LogSeverity::Err, Identity::Petent, "Blad uruchomienia watku dziecka.");
             ipc::mutex::destroy(&child_data.mutex);
             ipc::cond::destroy(&child_data.cond);
-            ipc::sem::post(sem_id, 0); // release child's slot
-            ipc::sem::post(sem_id, 0); // release parent's slot
-            ipc::shm::detach(shared_state);
+            shared_state->admission.release(places);
             return 1;
         }
         child_spawned = true;
-        Logger::log(LogSeverity::Info, Identity::Petent, "Petent wchodzi do urzedu z dzieckiem.");
+        Logger::log<LogSeverity::Info>(Identity::Petent, "Petent wchodzi do urzedu z dzieckiem.");
     }
 
-    if (ipc::sem::wait(sem_id, 1) == -1) {
-        Logger::log(LogSeverity::Err, Identity::Petent, "Blad blokady stanu wspoldzielonego.");
-    }
-    else {
-        shared_state->current_queue_length++;
-        if (ipc::sem::post(sem_id, 1) == -1) {
-            Logger::log(LogSeverity::Err, Identity::Petent, "Blad odblokowania stanu wspoldzielonego.");
-        }
-    }
+    shared_state->enter_queue();
 
-    pid_t petent_id = getpid();
     TicketRequestMsg request{};
     request.petent_id = petent_id;
     request.department = department;
@@ -132,40 +113,37 @@ int petent_main(UrzednikRole department, bool is_vip, bool has_child) {
     request.has_child = has_child ? 1 : 0;
 
     if (is_vip) {
-        Logger::log(LogSeverity::Notice, Identity::Petent, "Petent VIP - wysylam zadanie biletu.");
+        Logger::log<LogSeverity::Notice>(Identity::Petent, "Petent VIP - wysylam zadanie biletu.");
     }
 
+    record_latency(shared_state->stats.petent_first_send, arrival_ns);
     if (ipc::msg::send<TicketRequestMsg>(msg_req_id, kTicketRequestType, request) == -1) {
         Logger::log(LogSeverity::Err, Identity::Petent, "Blad wyslania prosby o bilet.");
-        if (ipc::sem::wait(sem_id, 1) == 0) {
-            if (shared_state->current_queue_length > 0) {
-                shared_state->current_queue_length--;
-            }
-            ipc::sem::post(sem_id, 1);
-        }
-        ipc::sem::post(sem_id, 0);
+        shared_state->leave_queue(1);
+        shared_state->admission.release(1);
         cleanup_child();
-        ipc::shm::detach(shared_state);
         return 1;
     }
 
-    Logger::log(LogSeverity::Info, Identity::Petent, "Petent pobiera bilet w rejestracji.");
+    Logger::event<LogSeverity::Info>(Identity::Petent, LogEvent::PetentTakesTicket);
+    Logger::log<LogSeverity::Debug>(Identity::Petent, [&] {
+        return "Petent " + std::to_string(petent_id) + " czeka na odpowiedzi w shardzie " +
+               std::to_string(ipc::helper::reply_shard(static_cast<uint32_t>(petent_id))) + ".";
+    });
 
     TicketIssuedMsg issued{};
     while (true) {
-        if (petent_evacuating) {
-            log_evacuation();
+        if (*evacuating) {
+            log_evacuation(shared_state);
             cleanup_child();
-            ipc::shm::detach(shared_state);
             return 0;
         }
-        int rc = ipc::msg::receive<TicketIssuedMsg>(msg_req_id, static_cast<long>(petent_id), &issued, 0);
+        int rc = ipc::helper::receive_reply<TicketIssuedMsg>(petent_id, &issued);
         if (rc == -1) {
             if (errno == EINTR) {
-                if (petent_evacuating) {
-                    log_evacuation();
+                if (*evacuating) {
+                    log_evacuation(shared_state);
                     cleanup_child();
-                    ipc::shm::detach(shared_state);
                     return 0;
                 }
                 continue;
@@ -173,30 +151,26 @@ int petent_main(UrzednikRole department, bool is_vip, bool has_child) {
             std::string error = "Blad odbioru biletu: " + std::string(std::strerror(errno));
             Logger::log(LogSeverity::Err, Identity::Petent, error);
             cleanup_child();
-            ipc::shm::detach(shared_state);
             return 1;
         }
         break;
     }
 
     if (issued.reject_reason == TicketRejectReason::OfficeClosed) {
-        Logger::log(LogSeverity::Notice, Identity::Petent, "Urzad zamkniety - bilet nie zostal wydany.");
+        Logger::log<LogSeverity::Notice>(Identity::Petent, "Urzad zamkniety - bilet nie zostal wydany.");
         // Building slot already freed by rejestracja (parent only); free child slot
         cleanup_child();
-        ipc::shm::detach(shared_state);
         return 0;
     }
     if (issued.reject_reason == TicketRejectReason::LimitReached) {
-        Logger::log(LogSeverity::Notice, Identity::Petent, "Brak wolnych terminow - bilet nie zostal wydany.");
+        Logger::log<LogSeverity::Notice>(Identity::Petent, "Brak wolnych terminow - bilet nie zostal wydany.");
         // Building slot already freed by rejestracja (parent only); free child slot
         cleanup_child();
-        ipc::shm::detach(shared_state);
         return 0;
     }
     if (issued.ticket_number == 0) {
-        Logger::log(LogSeverity::Notice, Identity::Petent, "Bilet nie zostal wydany.");
+        Logger::log<LogSeverity::Notice>(Identity::Petent, "Bilet nie zostal wydany.");
         cleanup_child();
-        ipc::shm::detach(shared_state);
         return 0;
     }
 
@@ -204,7 +178,6 @@ int petent_main(UrzednikRole department, bool is_vip, bool has_child) {
     if (dept_msg_id == -1) {
         Logger::log(LogSeverity::Err, Identity::Petent, "Nie znaleziono kolejki urzednika.");
         cleanup_child();
-        ipc::shm::detach(shared_state);
         return 1;
     }
 
@@ -212,33 +185,25 @@ int petent_main(UrzednikRole department, bool is_vip, bool has_child) {
     if (ipc::msg::send<TicketIssuedMsg>(dept_msg_id, queue_mtype, issued) == -1) {
         Logger::log(LogSeverity::Err, Identity::Petent, "Blad wyslania biletu do urzednika.");
         cleanup_child();
-        ipc::shm::detach(shared_state);
         return 1;
     }
 
-    if (issued.is_vip) {
-        Logger::log(LogSeverity::Info, Identity::Petent,
-                    "Petent VIP - wchodzi do kolejki priorytetowej z biletem " + std::to_string(issued.ticket_number) + ".");
-    } else {
-        Logger::log(LogSeverity::Info, Identity::Petent,
-                    "Petent zglosil sie do urzednika z biletem " + std::to_string(issued.ticket_number) + ".");
-    }
+    Logger::event<LogSeverity::Info>(Identity::Petent, issued.is_vip ? LogEvent::PetentVipQueued : LogEvent::PetentQueued,
+                                     issued.ticket_number);
 
     ServiceDoneMsg done{};
     while (true) {
-        if (petent_evacuating) {
-            log_evacuation();
+        if (*evacuating) {
+            log_evacuation(shared_state);
             cleanup_child();
-            ipc::shm::detach(shared_state);
             return 0;
         }
-        int rc = ipc::msg::receive<ServiceDoneMsg>(msg_req_id, static_cast<long>(petent_id), &done, 0);
+        int rc = ipc::helper::receive_reply<ServiceDoneMsg>(petent_id, &done);
         if (rc == -1) {
             if (errno == EINTR) {
-                if (petent_evacuating) {
-                    log_evacuation();
+                if (*evacuating) {
+                    log_evacuation(shared_state);
                     cleanup_child();
-                    ipc::shm::detach(shared_state);
                     return 0;
                 }
                 continue;
@@ -246,19 +211,17 @@ int petent_main(UrzednikRole department, bool is_vip, bool has_child) {
             std::string error = "Blad odbioru potwierdzenia obslugi: " + std::string(std::strerror(errno));
             Logger::log(LogSeverity::Err, Identity::Petent, error);
             cleanup_child();
-            ipc::shm::detach(shared_state);
             return 1;
         }
 
         if (done.action == ServiceAction::GoToKasa) {
-            Logger::log(LogSeverity::Info, Identity::Petent,
-                        "Petent skierowany do kasy - udaje sie dokonac oplaty.");
+            Logger::log<LogSeverity::Info>(Identity::Petent,
+                                           "Petent skierowany do kasy - udaje sie dokonac oplaty.");
 
             int msg_kasa_id = ipc::helper::get_msg_queue(ipc::KeyType::MsgQueueKasa);
             if (msg_kasa_id == -1) {
                 Logger::log(LogSeverity::Err, Identity::Petent, "Nie znaleziono kolejki kasy.");
                 cleanup_child();
-                ipc::shm::detach(shared_state);
                 return 1;
             }
 
@@ -268,58 +231,94 @@ int petent_main(UrzednikRole department, bool is_vip, bool has_child) {
             if (ipc::msg::send<KasaRequestMsg>(msg_kasa_id, kKasaRequestType, pay) == -1) {
                 Logger::log(LogSeverity::Err, Identity::Petent, "Blad wyslania zadania oplaty do kasy.");
                 cleanup_child();
-                ipc::shm::detach(shared_state);
                 return 1;
             }
 
             ServiceDoneMsg kasa_done{};
             bool paid = false;
             while (!paid) {
-                if (petent_evacuating) {
-                    log_evacuation();
+                if (*evacuating) {
+                    log_evacuation(shared_state);
                     cleanup_child();
-                    ipc::shm::detach(shared_state);
                     return 0;
                 }
-                int crc = ipc::msg::receive<ServiceDoneMsg>(msg_req_id, static_cast<long>(petent_id), &kasa_done, 0);
+                int crc = ipc::helper::receive_reply<ServiceDoneMsg>(petent_id, &kasa_done);
                 if (crc == -1) {
                     if (errno == EINTR) {
-                        if (petent_evacuating) {
-                            log_evacuation();
+                        if (*evacuating) {
+                            log_evacuation(shared_state);
                             cleanup_child();
-                            ipc::shm::detach(shared_state);
                             return 0;
                         }
                         continue;
                     }
                     Logger::log(LogSeverity::Err, Identity::Petent, "Blad odbioru potwierdzenia oplaty.");
                     cleanup_child();
-                    ipc::shm::detach(shared_state);
                     return 1;
                 }
-                paid = true;
+                if (kasa_done.action == ServiceAction::Released) {
+                    Logger::log<LogSeverity::Notice>(Identity::Petent,
+                                                     "Koniec dnia - petent opuszcza kase bez zalatwienia sprawy.");
+                    cleanup_child();
+                    return 0;
+                }
+                // Only the kasa's confirmation counts as payment
+                paid = kasa_done.action == ServiceAction::Paid;
             }
 
-            Logger::log(LogSeverity::Info, Identity::Petent,
-                        "Petent dokonal oplaty - wraca do urzednika.");
+            Logger::log<LogSeverity::Info>(Identity::Petent,
+                                           "Petent dokonal oplaty - wraca do urzednika.");
 
-            KasaRequestMsg ret{};
-            ret.petent_id = petent_id;
-            ret.department = done.department;
-            if (ipc::msg::send<KasaRequestMsg>(dept_msg_id, kKasaReturnQueueType, ret) == -1) {
+            // The ticket goes back to the department, where any of its clerks finishes the matter
+            TicketIssuedMsg ret = issued;
+            ret.from_kasa = 1;
+            if (ipc::msg::send<TicketIssuedMsg>(dept_msg_id, kKasaReturnQueueType, ret) == -1) {
                 Logger::log(LogSeverity::Err, Identity::Petent, "Blad powiadomienia urzednika o powrocie z kasy.");
                 cleanup_child();
-                ipc::shm::detach(shared_state);
                 return 1;
             }
 
             continue;
         }
 
+        if (done.action == ServiceAction::Released) {
+            Logger::log<LogSeverity::Notice>(Identity::Petent,
+                                             "Koniec dnia - petent po oplacie nie zostal obsluzony.");
+        }
         break;
     }
 
     cleanup_child();
-    ipc::shm::detach(shared_state);
     return 0;
 }
+
+static void install_petent_handlers() {
+    ipc::install_signal_handler(SIGUSR2, handle_evacuation_signal);
+    ipc::install_signal_handler(SIGTERM, handle_evacuation_signal);
+    ipc::install_signal_handler(SIGINT, handle_evacuation_signal);
+}
+
+int petent_main(UrzednikRole department, bool is_vip, bool has_child) {
+    install_petent_handlers();
+
+    Logger::event<LogSeverity::Info>(Identity::Petent, LogEvent::PetentStarted);
+
+    auto shared_state = ipc::helper::get_shared_state(false);
+    if (!shared_state) {
+        return 1;
+    }
+
+    int rc = petent_visit(shared_state, getpid(), department, is_vip, has_child, ipc::helper::inherited_arrival_ns(),
+                          &petent_evacuating);
+    ipc::shm::detach(shared_state);
+    return rc;
+}
+
+int petent_forked_main(SharedState* shared_state, UrzednikRole department, bool is_vip, bool has_child,
+                       uint64_t arrival_ns) {
+    install_petent_handlers();
+
+    Logger::event<LogSeverity::Info>(Identity::Petent, LogEvent::PetentStarted);
+
+    return petent_visit(shared_state, getpid(), department, is_vip, has_child, arrival_ns, &petent_evacuating);
+}
@@ -1,8 +1,26 @@
 #ifndef SO_PROJEKT_PETENT_H
 #define SO_PROJEKT_PETENT_H
 
+#include <csignal>
+#include <cstdint>
+#include <sys/types.h>
 #include "../common.h"
 
 int petent_main(UrzednikRole department, bool is_vip = false, bool has_child = false);
 
+// Petent process forked from the zygote, which already holds the writable SharedState attachment
+int petent_forked_main(SharedState* shared_state, UrzednikRole department, bool is_vip, bool has_child,
+                       uint64_t arrival_ns);
+
+// One petent's visit, from entering the building to leaving it. Runs in its own process (petent_main, a zygote's
+// child) or as a thread hosted by the generator; `petent_id` addresses the replies, `arrival_ns` (ipc::monotonic_ns()
+// when the generator drew the petent, 0 if unknown) feeds the startup latency stats and `evacuating` is raised to
+// make the petent leave.
+int petent_visit(SharedState* shared_state, pid_t petent_id, UrzednikRole department, bool is_vip, bool has_child,
+                 uint64_t arrival_ns, volatile sig_atomic_t* evacuating);
+
+// Resolves every queue a visit uses (and opens posix lanes up front), so visits started later in this process or its
+// forked children only read the handle tables
+int petent_prepare_queues();
+
 #endif //SO_PROJEKT_PETENT_H
@@ -0,0 +1,135 @@
+#include "zygote.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "petent.h"
+#include "../ipcutils.h"
+#include "../logger.h"
+#include "../placement.h"
+
+namespace petent_zygote {
+
+// One arrival; small enough (< PIPE_BUF) for every write to land in the pipe whole
+struct Request {
+    uint64_t arrival_ns;
+    UrzednikRole department;
+    bool is_vip;
+    bool has_child;
+};
+
+static int request_fd = -1;
+
+// Reads one whole request; 0 on EOF (the generator closed the pipe), -1 on error
+static int read_request(int fd, Request* request) {
+    auto* out = reinterpret_cast<char*>(request);
+    size_t done = 0;
+    while (done < sizeof(Request)) {
+        ssize_t n = read(fd, out + done, sizeof(Request) - done);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            perror("read failed");
+            return -1;
+        }
+        if (n == 0) {
+            return 0;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return 1;
+}
+
+static void fork_petent(SharedState* shared_state, int fd, const Request& request) {
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork failed");
+        Logger::log(LogSeverity::Err, Identity::Generator, "Nie udalo sie utworzyc procesu petenta.");
+        return;
+    }
+    if (pid == 0) {
+        close(fd);
+        ipc::install_signal_handler(SIGCHLD, SIG_DFL);
+        int rc = petent_forked_main(shared_state, request.department, request.is_vip, request.has_child,
+                                    request.arrival_ns);
+        _exit(rc);
+    }
+}
+
+[[noreturn]] static void zygote_main(int fd) {
+    // The generator forwards nothing: evacuation reaches the petents through the process group, and the zygote
+    // itself leaves once the generator closes the pipe
+    ipc::install_signal_handler(SIGUSR2, SIG_IGN);
+    ipc::install_signal_handler(SIGTERM, SIG_IGN);
+    ipc::install_signal_handler(SIGINT, SIG_IGN);
+    // Petents are reaped by the kernel; wait() below then blocks until the last one is gone
+    ipc::install_signal_handler(SIGCHLD, SIG_IGN);
+
+    // The generator's attachment is read-only, petents write their stats and counters
+    auto shared_state = ipc::helper::get_shared_state(false);
+    if (!shared_state || petent_prepare_queues() == -1) {
+        Logger::log(LogSeverity::Err, Identity::Generator, "Zygota petentow nie mogla sie przygotowac.");
+        _exit(1);
+    }
+    // Petents forked from here inherit the set
+    placement::pin_self(shared_state->config.placement.petent);
+    Logger::log(LogSeverity::Info, Identity::Generator, "Zygota petentow gotowa.");
+
+    Request request{};
+    while (read_request(fd, &request) == 1) {
+        fork_petent(shared_state, fd, request);
+    }
+    close(fd);
+
+    while (wait(nullptr) != -1 || errno == EINTR) {
+    }
+    ipc::shm::detach(shared_state);
+    _exit(0);
+}
+
+int start() {
+    int fds[2];
+    if (pipe(fds) == -1) {
+        perror("pipe failed");
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork failed");
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(fds[1]);
+        zygote_main(fds[0]);
+    }
+    close(fds[0]);
+    request_fd = fds[1];
+    return 0;
+}
+
+int request(UrzednikRole department, bool is_vip, bool has_child, uint64_t arrival_ns) {
+    if (request_fd == -1) {
+        errno = EBADF;
+        return -1;
+    }
+    Request request{arrival_ns, department, is_vip, has_child};
+    ssize_t n = write(request_fd, &request, sizeof(request));
+    if (n != static_cast<ssize_t>(sizeof(request))) {
+        if (n == -1 && errno != EINTR) {
+            perror("write failed");
+        }
+        return -1;
+    }
+    return 0;
+}
+
+void stop() {
+    if (request_fd != -1) {
+        close(request_fd);
+        request_fd = -1;
+    }
+}
+
+} // namespace petent_zygote
@@ -0,0 +1,25 @@
+#ifndef SO_PROJEKT_PETENT_ZYGOTE_H
+#define SO_PROJEKT_PETENT_ZYGOTE_H
+
+#include <cstdint>
+#include "../common.h"
+
+// Petents forked from a pre-initialised zygote (--petent-host zygote) instead of a fork + exec each. The zygote is a
+// child of the generator that has already attached SharedState and resolved every queue; each request read from its
+// pipe becomes one fork() running petent_forked_main(), so an arrival costs no exec, no dynamic loading and no
+// attach. Petents stay separate processes in the generator's process group, so evacuation reaches them as before.
+// All functions are called from the generator only.
+namespace petent_zygote {
+
+    // Forks the zygote; -1 when the pipe or the fork fails
+    int start();
+
+    // -1 when the zygote is gone or the request could not be written
+    int request(UrzednikRole department, bool is_vip, bool has_child, uint64_t arrival_ns);
+
+    // Closes the request pipe; the zygote waits for its petents and exits, to be reaped by the generator
+    void stop();
+
+} // namespace petent_zygote
+
+#endif // SO_PROJEKT_PETENT_ZYGOTE_H
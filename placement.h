@@ -0,0 +1,147 @@
+#ifndef SO_PROJEKT_PLACEMENT_H
+#define SO_PROJEKT_PLACEMENT_H
+
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <string_view>
+#include "common.h"
+
+// CPU affinity and real-time scheduling of the roles (PlacementConfig). Dyrektor fits the configured sets to the CPUs
+// it may use and checks once whether the real-time class is permitted; the spawning side then pins each child between
+// fork and exec, where affinity and scheduling policy survive. Nothing here logs: the pre-exec children must stay
+// quiet, so dyrektor reports what it had to drop.
+namespace placement {
+
+    // "0-3,6" (CPU numbers and ranges); an empty or malformed list, or a CPU past CPU_SETSIZE, is rejected
+    inline bool parse_cpu_list(std::string_view list, cpu_set_t& cpus) {
+        CPU_ZERO(&cpus);
+        if (list.empty()) {
+            return false;
+        }
+        while (!list.empty()) {
+            size_t comma = list.find(',');
+            std::string_view item = list.substr(0, comma);
+            list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+
+            size_t dash = item.find('-');
+            std::string first(item.substr(0, dash));
+            std::string last(dash == std::string_view::npos ? first : std::string(item.substr(dash + 1)));
+            if (first.empty() || last.empty() || first.find_first_not_of("0123456789") != std::string::npos ||
+                last.find_first_not_of("0123456789") != std::string::npos || first.size() > 5 || last.size() > 5) {
+                return false;
+            }
+            int from = std::stoi(first);
+            int to = std::stoi(last);
+            if (from > to || to >= CPU_SETSIZE) {
+                return false;
+            }
+            for (int cpu = from; cpu <= to; ++cpu) {
+                CPU_SET(cpu, &cpus);
+            }
+        }
+        return true;
+    }
+
+    inline std::string format_cpu_list(const cpu_set_t& cpus) {
+        std::string out;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (!CPU_ISSET(cpu, &cpus)) {
+                continue;
+            }
+            int last = cpu;
+            while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &cpus)) {
+                ++last;
+            }
+            if (!out.empty()) {
+                out += ",";
+            }
+            out += std::to_string(cpu) + (last > cpu ? "-" + std::to_string(last) : "");
+            cpu = last;
+        }
+        return out.empty() ? "-" : out;
+    }
+
+    // Restricts `cpus` to the ones dyrektor may run on. Returns false when a non-empty set had none of them left;
+    // the set is then empty, and the role is not pinned.
+    inline bool fit_to_allowed(cpu_set_t& cpus, const cpu_set_t& allowed) {
+        if (CPU_COUNT(&cpus) == 0) {
+            return true;
+        }
+        CPU_AND(&cpus, &cpus, &allowed);
+        return CPU_COUNT(&cpus) > 0;
+    }
+
+    // Pins the calling thread; threads and children started afterwards inherit the set. An empty set is a no-op.
+    inline int pin_self(const cpu_set_t& cpus) {
+        if (CPU_COUNT(&cpus) == 0) {
+            return 0;
+        }
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (rc != 0) {
+            errno = rc;
+            return -1;
+        }
+        return 0;
+    }
+
+    // Moves the calling thread to SCHED_FIFO/SCHED_RR (RealtimePolicy::None is a no-op); EPERM without
+    // CAP_SYS_NICE or a sufficient RLIMIT_RTPRIO
+    inline int set_realtime(RealtimePolicy policy, int priority) {
+        if (policy == RealtimePolicy::None) {
+            return 0;
+        }
+        sched_param param{};
+        param.sched_priority = priority;
+        int rc = pthread_setschedparam(pthread_self(), policy == RealtimePolicy::Fifo ? SCHED_FIFO : SCHED_RR, &param);
+        if (rc != 0) {
+            errno = rc;
+            return -1;
+        }
+        return 0;
+    }
+
+    // Whether set_realtime() would succeed: tries it on the calling thread and restores its previous policy and
+    // parameters right after
+    inline bool realtime_permitted(RealtimePolicy policy, int priority) {
+        int previous_policy = SCHED_OTHER;
+        sched_param previous{};
+        int rc = pthread_getschedparam(pthread_self(), &previous_policy, &previous);
+        if (rc != 0) {
+            errno = rc;
+            return false;
+        }
+        if (set_realtime(policy, priority) == -1) {
+            return false;
+        }
+        pthread_setschedparam(pthread_self(), previous_policy, &previous);
+        return true;
+    }
+
+    // Non-empty sets only, e.g. "rejestracja:1,SA:2-3"; for dyrektor's config log line
+    inline std::string describe(const PlacementConfig& config) {
+        std::string out;
+        auto add = [&out](std::string_view role, const cpu_set_t& cpus) {
+            if (CPU_COUNT(&cpus) == 0) {
+                return;
+            }
+            if (!out.empty()) {
+                out += ",";
+            }
+            out += std::string(role) + ":" + format_cpu_list(cpus);
+        };
+        add("dyrektor", config.dyrektor);
+        add("rejestracja", config.rejestracja);
+        add("kasa", config.kasa);
+        add("generator", config.generator);
+        add("petent", config.petent);
+        for (size_t idx = 0; idx < kDepartmentCount; ++idx) {
+            add(urzednik_role_to_string(static_cast<UrzednikRole>(idx)).value_or("?"), config.urzednik[idx]);
+        }
+        return out.empty() ? "-" : out;
+    }
+
+} // namespace placement
+
+#endif // SO_PROJEKT_PLACEMENT_H
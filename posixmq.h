@@ -0,0 +1,697 @@
+#ifndef SO_PROJEKT_POSIXMQ_H
+#define SO_PROJEKT_POSIXMQ_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <new>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include "futex.h"
+#include "shmqueue.h"
+
+// POSIX message queue replacement for one SysV message queue (selected with --transport posix).
+// One logical queue is a family of mqueues named after its IPC key:
+//  - lane "p": mtypes 1 and 2, mapped to mq priorities so that VIP (1) is always received before normal (2)
+//  - lane "r": mtype 3 (petents returning from kasa)
+//  - segment "b": addressed replies (mtype = petent pid) do not go through an mqueue, which can only be popped
+//    from the head, but to the mailbox buckets of shmqueue.h in a POSIX shared memory segment. A receiver takes
+//    only frames addressed to it and sleeps on its bucket's futex.
+// Lane descriptors are non-blocking and pollable: blocking calls wait in poll()/epoll_wait() with a timeout, so a
+// removed queue (mq_unlink() does not wake anybody) is noticed within kWaitSliceMs. The mailbox segment carries its
+// own removed flag instead.
+namespace pmq {
+
+    constexpr size_t kMaxPayload = 16; // largest message struct in common.h
+    constexpr long kPriorityTypes = 2;
+    constexpr long kReturnType = 3;
+    constexpr size_t kLaneCount = 2;
+    constexpr size_t kPriorityLane = 0;
+    constexpr size_t kReturnLane = 1;
+    constexpr long kLaneDepth[kLaneCount] = {256, 32};
+    constexpr uint32_t kMailboxBuckets = 64;
+    constexpr int kWaitSliceMs = 200;
+    constexpr int kMaxHandles = 16;
+
+    struct Frame {
+        long mtype;
+        uint32_t length;
+        alignas(8) char data[kMaxPayload];
+    };
+
+    struct Mailboxes {
+        std::atomic<uint32_t> removed;
+        alignas(64) std::atomic<uint32_t> space_seq; // futex word, bumped whenever a mailbox slot frees up
+        std::atomic<uint32_t> space_waiters;
+        shmq::MailboxBucket buckets[kMailboxBuckets];
+
+        Mailboxes() : removed(0), space_seq(0), space_waiters(0) {
+            for (shmq::MailboxBucket& bucket : buckets) {
+                new (&bucket.seq) std::atomic<uint32_t>(0);
+                new (&bucket.waiters) std::atomic<uint32_t>(0);
+                for (shmq::MailboxSlot& slot : bucket.slots) {
+                    new (&slot.owner) std::atomic<int64_t>(shmq::kSlotFree);
+                }
+            }
+        }
+    };
+
+    // Per-process table of opened queues; handles returned to ipc::msg are indexes into it.
+    // Lanes and the mailbox segment are opened on first use, so a petent only pays for what it touches.
+    struct Attachment {
+        key_t key;
+        bool open;
+        mqd_t lanes[kLaneCount];
+        int epoll_fd; // priority and return lanes, for receives that span both
+        Mailboxes* mailboxes;
+    };
+
+    inline Attachment attachments[kMaxHandles];
+    inline int attachment_count = 0;
+
+    inline std::string lane_name(key_t key, size_t lane) {
+        char name[48];
+        std::snprintf(name, sizeof(name), "/so_projekt_%08x_%c", static_cast<unsigned>(key),
+                      lane == kPriorityLane ? 'p' : 'r');
+        return name;
+    }
+
+    inline std::string mailbox_name(key_t key) {
+        char name[48];
+        std::snprintf(name, sizeof(name), "/so_projekt_%08x_b", static_cast<unsigned>(key));
+        return name;
+    }
+
+    // Multiplicative hash over the whole pid: reply shards already split pids by pid % kReplyShardCount, so
+    // pid % buckets would leave most buckets of a shard unused
+    inline shmq::MailboxBucket& bucket_for(Mailboxes& mailboxes, long mtype) {
+        return mailboxes.buckets[((static_cast<uint32_t>(mtype) * 2654435761u) >> 16) % kMailboxBuckets];
+    }
+
+    inline Attachment* attachment_for(int handle) {
+        if (handle < 0 || handle >= attachment_count || !attachments[handle].open) {
+            errno = EINVAL;
+            return nullptr;
+        }
+        return &attachments[handle];
+    }
+
+    inline int remember(key_t key) {
+        for (int i = 0; i < attachment_count; ++i) {
+            if (attachments[i].key == key && attachments[i].open) {
+                return i;
+            }
+        }
+        int handle = -1;
+        for (int i = 0; i < attachment_count; ++i) {
+            if (attachments[i].key == key) {
+                handle = i;
+            }
+        }
+        if (handle == -1) {
+            if (attachment_count >= kMaxHandles) {
+                errno = ENOSPC;
+                return -1;
+            }
+            handle = attachment_count++;
+        }
+        Attachment& attachment = attachments[handle];
+        attachment.key = key;
+        attachment.open = true;
+        for (mqd_t& lane : attachment.lanes) {
+            lane = static_cast<mqd_t>(-1);
+        }
+        attachment.epoll_fd = -1;
+        attachment.mailboxes = nullptr;
+        return handle;
+    }
+
+    // Opens one lane on first use. A missing lane means the queue was removed.
+    inline mqd_t lane_fd(Attachment& attachment, size_t lane) {
+        if (attachment.lanes[lane] != static_cast<mqd_t>(-1)) {
+            return attachment.lanes[lane];
+        }
+        mqd_t fd = mq_open(lane_name(attachment.key, lane).c_str(), O_RDWR | O_NONBLOCK);
+        if (fd == static_cast<mqd_t>(-1)) {
+            if (errno == ENOENT) {
+                errno = EIDRM;
+            }
+            return fd;
+        }
+        attachment.lanes[lane] = fd;
+        return fd;
+    }
+
+    inline Mailboxes* map_mailboxes(int fd) {
+        void* addr = mmap(nullptr, sizeof(Mailboxes), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            perror("mmap failed");
+            return nullptr;
+        }
+        return static_cast<Mailboxes*>(addr);
+    }
+
+    // Maps the mailbox segment on first use. A missing segment means the queue was removed.
+    inline Mailboxes* mailboxes_for(Attachment& attachment) {
+        if (attachment.mailboxes != nullptr) {
+            return attachment.mailboxes;
+        }
+        int fd = shm_open(mailbox_name(attachment.key).c_str(), O_RDWR | O_CLOEXEC, 0);
+        if (fd == -1) {
+            if (errno == ENOENT) {
+                errno = EIDRM;
+            }
+            return nullptr;
+        }
+        attachment.mailboxes = map_mailboxes(fd);
+        close(fd);
+        return attachment.mailboxes;
+    }
+
+    // Unprivileged processes cannot create deeper queues than this (10 by default)
+    inline long system_msg_max() {
+        static long msg_max = [] {
+            long value = 0;
+            FILE* file = std::fopen("/proc/sys/fs/mqueue/msg_max", "r");
+            if (file != nullptr) {
+                if (std::fscanf(file, "%ld", &value) != 1) {
+                    value = 0;
+                }
+                std::fclose(file);
+            }
+            return value;
+        }();
+        return msg_max;
+    }
+
+    // mq_maxmsg above msg_max (EINVAL) is clamped to it, over RLIMIT_MSGQUEUE (EMFILE) it is halved. A shallow
+    // lane only means senders block earlier, as on a full SysV queue.
+    inline mqd_t create_lane(key_t key, size_t lane, mode_t permissions) {
+        mq_attr attr{};
+        attr.mq_maxmsg = kLaneDepth[lane];
+        attr.mq_msgsize = sizeof(Frame);
+        std::string name = lane_name(key, lane);
+        while (true) {
+            mqd_t fd = mq_open(name.c_str(), O_RDWR | O_NONBLOCK | O_CREAT | O_EXCL, permissions, &attr);
+            if (fd != static_cast<mqd_t>(-1)) {
+                return fd;
+            }
+            if ((errno != EINVAL && errno != EMFILE && errno != ENOMEM) || attr.mq_maxmsg <= 1) {
+                return fd;
+            }
+            long msg_max = system_msg_max();
+            attr.mq_maxmsg = errno == EINVAL && msg_max > 0 && attr.mq_maxmsg > msg_max ? msg_max : attr.mq_maxmsg / 2;
+        }
+    }
+
+    inline Mailboxes* create_mailboxes(key_t key, mode_t permissions) {
+        int fd = shm_open(mailbox_name(key).c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, permissions);
+        if (fd == -1) {
+            return nullptr;
+        }
+        // shm_open() applies the umask; peers of other users need the queue's own permissions
+        if (fchmod(fd, permissions) == -1 || ftruncate(fd, sizeof(Mailboxes)) == -1) {
+            int err = errno;
+            close(fd);
+            shm_unlink(mailbox_name(key).c_str());
+            errno = err;
+            return nullptr;
+        }
+        Mailboxes* mailboxes = map_mailboxes(fd);
+        close(fd);
+        if (mailboxes == nullptr) {
+            shm_unlink(mailbox_name(key).c_str());
+            return nullptr;
+        }
+        return new (mailboxes) Mailboxes();
+    }
+
+    inline void close_lanes(Attachment& attachment) {
+        for (mqd_t& lane : attachment.lanes) {
+            if (lane != static_cast<mqd_t>(-1)) {
+                mq_close(lane);
+                lane = static_cast<mqd_t>(-1);
+            }
+        }
+        if (attachment.epoll_fd != -1) {
+            close(attachment.epoll_fd);
+            attachment.epoll_fd = -1;
+        }
+        if (attachment.mailboxes != nullptr) {
+            munmap(attachment.mailboxes, sizeof(Mailboxes));
+            attachment.mailboxes = nullptr;
+        }
+        attachment.open = false;
+    }
+
+    // Deletes the lanes and mailboxes of a previous run; missing ones are fine
+    inline void unlink(key_t key) {
+        for (size_t lane = 0; lane < kLaneCount; ++lane) {
+            mq_unlink(lane_name(key, lane).c_str());
+        }
+        shm_unlink(mailbox_name(key).c_str());
+    }
+
+    inline int create(key_t key, mode_t permissions) {
+        mqd_t first = create_lane(key, kPriorityLane, permissions);
+        if (first == static_cast<mqd_t>(-1)) {
+            int err = errno;
+            perror("mq_open failed");
+            errno = err;
+            return -1;
+        }
+        int handle = remember(key);
+        if (handle == -1) {
+            mq_close(first);
+            unlink(key);
+            return -1;
+        }
+        Attachment& attachment = attachments[handle];
+        attachment.lanes[kPriorityLane] = first;
+        for (size_t lane = 1; lane < kLaneCount; ++lane) {
+            attachment.lanes[lane] = create_lane(key, lane, permissions);
+            if (attachment.lanes[lane] == static_cast<mqd_t>(-1)) {
+                int err = errno;
+                perror("mq_open failed");
+                close_lanes(attachment);
+                unlink(key);
+                errno = err;
+                return -1;
+            }
+        }
+        attachment.mailboxes = create_mailboxes(key, permissions);
+        if (attachment.mailboxes == nullptr) {
+            int err = errno;
+            perror("shm_open (mailboxes) failed");
+            close_lanes(attachment);
+            unlink(key);
+            errno = err;
+            return -1;
+        }
+        return handle;
+    }
+
+    // The key is all a peer needs: lane names derive from it
+    inline int open(key_t key) {
+        return remember(key);
+    }
+
+    inline int get(key_t key) {
+        int handle = remember(key);
+        if (handle == -1) {
+            return -1;
+        }
+        if (lane_fd(attachments[handle], kPriorityLane) == static_cast<mqd_t>(-1)) {
+            int err = errno;
+            perror("mq_open failed");
+            attachments[handle].open = false;
+            errno = err;
+            return -1;
+        }
+        return handle;
+    }
+
+    // Opens every lane and the mailboxes up front; threads sharing the handle then never race on a first-use open
+    inline int open_lanes(int handle) {
+        Attachment* attachment = attachment_for(handle);
+        if (attachment == nullptr) {
+            return -1;
+        }
+        for (size_t lane = 0; lane < kLaneCount; ++lane) {
+            if (lane_fd(*attachment, lane) == static_cast<mqd_t>(-1)) {
+                int err = errno;
+                perror("mq_open failed");
+                errno = err;
+                return -1;
+            }
+        }
+        if (mailboxes_for(*attachment) == nullptr) {
+            int err = errno;
+            perror("shm_open (mailboxes) failed");
+            errno = err;
+            return -1;
+        }
+        return 0;
+    }
+
+    inline int remove(int handle) {
+        Attachment* attachment = attachment_for(handle);
+        if (attachment == nullptr) {
+            return -1;
+        }
+        key_t key = attachment->key;
+        // Receivers asleep on a bucket futex are not told by the unlink; the flag sends them away with EIDRM
+        Mailboxes* mailboxes = mailboxes_for(*attachment);
+        if (mailboxes != nullptr) {
+            mailboxes->removed.store(1, std::memory_order_seq_cst);
+            mailboxes->space_seq.fetch_add(1, std::memory_order_seq_cst);
+            ipc::futex::wake(&mailboxes->space_seq);
+            for (shmq::MailboxBucket& bucket : mailboxes->buckets) {
+                bucket.seq.fetch_add(1, std::memory_order_seq_cst);
+                ipc::futex::wake(&bucket.seq);
+            }
+        }
+        close_lanes(*attachment);
+        unlink(key);
+        return 0;
+    }
+
+    // Peers blocked in a wait slice look for the priority lane when the slice times out
+    inline bool removed(const Attachment& attachment) {
+        mqd_t fd = mq_open(lane_name(attachment.key, kPriorityLane).c_str(), O_RDONLY | O_NONBLOCK);
+        if (fd == static_cast<mqd_t>(-1)) {
+            return errno == ENOENT;
+        }
+        mq_close(fd);
+        return false;
+    }
+
+    // Waits for `events` on a single lane; returns 0 when ready or on a timed-out slice, -1 on EINTR/EIDRM
+    inline int wait_lane(Attachment& attachment, mqd_t fd, short events) {
+        pollfd entry{fd, events, 0};
+        int rc = poll(&entry, 1, kWaitSliceMs);
+        if (rc == -1) {
+            return -1;
+        }
+        if (rc == 0 && removed(attachment)) {
+            errno = EIDRM;
+            return -1;
+        }
+        return 0;
+    }
+
+    // One epoll_wait() over the priority and return lanes, for msgtyp values that span both
+    inline int wait_priority_and_return(Attachment& attachment) {
+        if (attachment.epoll_fd == -1) {
+            int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            if (epoll_fd == -1) {
+                perror("epoll_create1 failed");
+                return -1;
+            }
+            for (size_t lane : {kPriorityLane, kReturnLane}) {
+                mqd_t fd = lane_fd(attachment, lane);
+                epoll_event event{};
+                event.events = EPOLLIN;
+                event.data.u64 = lane;
+                if (fd == static_cast<mqd_t>(-1) || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+                    int err = errno;
+                    close(epoll_fd);
+                    errno = err;
+                    return -1;
+                }
+            }
+            attachment.epoll_fd = epoll_fd;
+        }
+        epoll_event events[2];
+        int rc = epoll_wait(attachment.epoll_fd, events, 2, kWaitSliceMs);
+        if (rc == -1) {
+            return -1;
+        }
+        if (rc == 0 && removed(attachment)) {
+            errno = EIDRM;
+            return -1;
+        }
+        return 0;
+    }
+
+    // Sleeps until `seq` moves away from `observed`; returns -1 with errno set when interrupted or removed
+    inline int sleep_on(Mailboxes& mailboxes, std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiters,
+                        uint32_t observed) {
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        int rc = 0;
+        if (seq.load(std::memory_order_seq_cst) == observed && !mailboxes.removed.load(std::memory_order_acquire)) {
+            rc = ipc::futex::wait(&seq, observed);
+        }
+        int err = errno;
+        waiters.fetch_sub(1, std::memory_order_seq_cst);
+        if (rc == -1) {
+            errno = err;
+            return -1;
+        }
+        return 0;
+    }
+
+    // Addressed send: blocks while the bucket is full unless IPC_NOWAIT (EAGAIN)
+    inline int send_mailbox(Attachment& attachment, long mtype, const void* data, size_t length, int flags) {
+        Mailboxes* mailboxes = mailboxes_for(attachment);
+        if (mailboxes == nullptr) {
+            return -1;
+        }
+        shmq::MailboxBucket& bucket = bucket_for(*mailboxes, mtype);
+        while (true) {
+            if (mailboxes->removed.load(std::memory_order_acquire)) {
+                errno = EIDRM;
+                return -1;
+            }
+            uint32_t observed = mailboxes->space_seq.load(std::memory_order_seq_cst);
+            if (shmq::mailbox_put(bucket, mtype, data, length)) {
+                shmq::notify(bucket.seq, bucket.waiters);
+                return 0;
+            }
+            if (flags & IPC_NOWAIT) {
+                errno = EAGAIN;
+                return -1;
+            }
+            if (sleep_on(*mailboxes, mailboxes->space_seq, mailboxes->space_waiters, observed) == -1) {
+                return -1;
+            }
+        }
+    }
+
+    // msgsnd() semantics: blocks while the lane is full unless IPC_NOWAIT (EAGAIN)
+    inline int send(int handle, long mtype, const void* data, size_t length, int flags) {
+        Attachment* attachment = attachment_for(handle);
+        if (attachment == nullptr || mtype <= 0 || length > kMaxPayload) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (mtype > kReturnType) {
+            return send_mailbox(*attachment, mtype, data, length, flags);
+        }
+        mqd_t fd = lane_fd(*attachment, mtype == kReturnType ? kReturnLane : kPriorityLane);
+        if (fd == static_cast<mqd_t>(-1)) {
+            return -1;
+        }
+        Frame frame{};
+        frame.mtype = mtype;
+        frame.length = static_cast<uint32_t>(length);
+        std::memcpy(frame.data, data, length);
+        unsigned priority = mtype == 1 ? 1u : 0u;
+        while (true) {
+            if (mq_send(fd, reinterpret_cast<const char*>(&frame), sizeof(frame), priority) == 0) {
+                return 0;
+            }
+            if (errno != EAGAIN || (flags & IPC_NOWAIT)) {
+                return -1;
+            }
+            if (wait_lane(*attachment, fd, POLLOUT) == -1) {
+                return -1;
+            }
+        }
+    }
+
+    // Pops one frame without blocking; false with errno EAGAIN when the lane is empty
+    inline bool pop(mqd_t fd, Frame& frame) {
+        ssize_t size = mq_receive(fd, reinterpret_cast<char*>(&frame), sizeof(frame), nullptr);
+        return size == static_cast<ssize_t>(sizeof(frame));
+    }
+
+    inline bool copy_out(const Frame& frame, void* data, size_t length) {
+        if (data != nullptr) {
+            std::memcpy(data, frame.data, length < frame.length ? length : frame.length);
+        }
+        return true;
+    }
+
+    // Takes the oldest reply for `mtype` (any reply for 0) and tells blocked senders a slot is free
+    inline bool try_mailbox(Attachment& attachment, long mtype, void* data, size_t length) {
+        Mailboxes* mailboxes = mailboxes_for(attachment);
+        if (mailboxes == nullptr) {
+            return false;
+        }
+        bool taken = false;
+        if (mtype != 0) {
+            taken = shmq::mailbox_take(bucket_for(*mailboxes, mtype), mtype, data, length);
+        }
+        else {
+            for (shmq::MailboxBucket& bucket : mailboxes->buckets) {
+                if (shmq::mailbox_take(bucket, 0, data, length)) {
+                    taken = true;
+                    break;
+                }
+            }
+        }
+        if (!taken) {
+            errno = EAGAIN;
+            return false;
+        }
+        shmq::notify(mailboxes->space_seq, mailboxes->space_waiters);
+        return true;
+    }
+
+    inline bool try_receive(Attachment& attachment, long msgtyp, void* data, size_t length) {
+        Frame frame{};
+        if (msgtyp > kReturnType) {
+            return try_mailbox(attachment, msgtyp, data, length);
+        }
+        // The priority lane already hands out VIP before normal; an exact 1 or 2 takes its head too, which is
+        // what the project's queues need (rejestracja and kasa only ever carry type 1)
+        bool wants_priority = msgtyp != kReturnType;
+        bool wants_return = msgtyp == kReturnType || msgtyp == 0 || msgtyp <= -kReturnType;
+        if (wants_priority) {
+            mqd_t fd = lane_fd(attachment, kPriorityLane);
+            if (fd != static_cast<mqd_t>(-1) && pop(fd, frame)) {
+                return copy_out(frame, data, length);
+            }
+        }
+        if (wants_return) {
+            mqd_t fd = lane_fd(attachment, kReturnLane);
+            if (fd != static_cast<mqd_t>(-1) && pop(fd, frame)) {
+                return copy_out(frame, data, length);
+            }
+        }
+        if (msgtyp == 0 && try_mailbox(attachment, 0, data, length)) {
+            return true;
+        }
+        errno = EAGAIN;
+        return false;
+    }
+
+    // Addressed receive: sleeps on the bucket's futex, woken only by replies hashed to the same bucket
+    inline int receive_mailbox(Attachment& attachment, long mtype, void* data, size_t length, int flags) {
+        Mailboxes* mailboxes = mailboxes_for(attachment);
+        if (mailboxes == nullptr) {
+            return -1;
+        }
+        shmq::MailboxBucket& bucket = bucket_for(*mailboxes, mtype);
+        while (true) {
+            if (mailboxes->removed.load(std::memory_order_acquire)) {
+                errno = EIDRM;
+                return -1;
+            }
+            uint32_t observed = bucket.seq.load(std::memory_order_seq_cst);
+            if (try_mailbox(attachment, mtype, data, length)) {
+                return 0;
+            }
+            if (flags & IPC_NOWAIT) {
+                errno = ENOMSG;
+                return -1;
+            }
+            if (sleep_on(*mailboxes, bucket.seq, bucket.waiters, observed) == -1) {
+                return -1;
+            }
+        }
+    }
+
+    // msgrcv() semantics for msgtyp > 0 (exact), < 0 (lowest type <= |msgtyp|) and 0 (any)
+    inline int receive(int handle, long msgtyp, void* data, size_t length, int flags) {
+        Attachment* attachment = attachment_for(handle);
+        if (attachment == nullptr) {
+            return -1;
+        }
+        if (msgtyp > kReturnType) {
+            return receive_mailbox(*attachment, msgtyp, data, length, flags);
+        }
+        bool spans_lanes = msgtyp == 0 || msgtyp <= -kReturnType;
+        while (true) {
+            if (try_receive(*attachment, msgtyp, data, length)) {
+                return 0;
+            }
+            if (errno != EAGAIN) {
+                return -1;
+            }
+            if (flags & IPC_NOWAIT) {
+                errno = ENOMSG;
+                return -1;
+            }
+            int rc = 0;
+            if (spans_lanes) {
+                rc = wait_priority_and_return(*attachment);
+            }
+            else {
+                mqd_t fd = lane_fd(*attachment, msgtyp == kReturnType ? kReturnLane : kPriorityLane);
+                rc = fd == static_cast<mqd_t>(-1) ? -1 : wait_lane(*attachment, fd, POLLIN);
+            }
+            if (rc == -1) {
+                return -1;
+            }
+        }
+    }
+
+    // receive() for the first message, then up to max_count - 1 more without waiting; returns the number taken
+    inline int receive_batch(int handle, long msgtyp, void* data, size_t length, size_t max_count, int flags) {
+        if (receive(handle, msgtyp, data, length, flags) == -1) {
+            return -1;
+        }
+        Attachment& attachment = attachments[handle];
+        auto* out = static_cast<char*>(data);
+        size_t count = 1;
+        while (count < max_count && try_receive(attachment, msgtyp, out + count * length, length)) {
+            ++count;
+        }
+        return static_cast<int>(count);
+    }
+
+    // Lane depth from mq_getattr() plus occupied mailbox slots; lane byte counts assume full frames since mqueue
+    // does not report payload sizes
+    inline int stat(int handle, uint64_t* message_count, uint64_t* byte_count) {
+        Attachment* attachment = attachment_for(handle);
+        if (attachment == nullptr) {
+            return -1;
+        }
+        uint64_t messages = 0;
+        uint64_t bytes = 0;
+        for (size_t lane = 0; lane < kLaneCount; ++lane) {
+            mqd_t fd = lane_fd(*attachment, lane);
+            mq_attr attr{};
+            if (fd != static_cast<mqd_t>(-1) && mq_getattr(fd, &attr) == 0) {
+                messages += static_cast<uint64_t>(attr.mq_curmsgs);
+                bytes += static_cast<uint64_t>(attr.mq_curmsgs) * kMaxPayload;
+            }
+        }
+        Mailboxes* mailboxes = mailboxes_for(*attachment);
+        if (mailboxes != nullptr) {
+            for (shmq::MailboxBucket& bucket : mailboxes->buckets) {
+                for (shmq::MailboxSlot& slot : bucket.slots) {
+                    if (slot.owner.load(std::memory_order_relaxed) > 0) {
+                        messages++;
+                        bytes += slot.length;
+                    }
+                }
+            }
+        }
+        *message_count = messages;
+        *byte_count = bytes;
+        return 0;
+    }
+
+    inline void drain(int handle) {
+        Attachment* attachment = attachment_for(handle);
+        if (attachment == nullptr) {
+            return;
+        }
+        Frame frame{};
+        for (size_t lane = 0; lane < kLaneCount; ++lane) {
+            mqd_t fd = lane_fd(*attachment, lane);
+            while (fd != static_cast<mqd_t>(-1) && pop(fd, frame)) {
+                // keep draining
+            }
+        }
+        while (try_mailbox(*attachment, 0, nullptr, 0)) {
+            // keep draining
+        }
+    }
+
+} // namespace pmq
+
+#endif // SO_PROJEKT_POSIXMQ_H
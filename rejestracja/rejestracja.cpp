@@ -1,8 +1,10 @@
 #include "rejestracja.h"
+#include <algorithm>
 #include <cerrno>
 #include <csignal>
 #include <cstring>
 #include "../common.h"
+#include "../dayshift.h"
 #include "../ipcutils.h"
 #include "../logger.h"
 
@@ -30,13 +32,107 @@ static bool is_valid_department(UrzednikRole department) {
     }
 }
 
+// Requests taken from the queue per wakeup, so a burst at opening time costs few syscalls
+constexpr size_t kRequestBatch = 64;
+
+static TicketIssuedMsg make_reply(const TicketRequestMsg& request, UrzednikRole department, uint32_t ticket_number,
+                                  TicketRejectReason reject_reason) {
+    TicketIssuedMsg reply{};
+    reply.petent_id = request.petent_id;
+    reply.ticket_number = ticket_number;
+    reply.department = department;
+    reply.redirected_from_sa = 0;
+    reply.reject_reason = reject_reason;
+    reply.is_vip = reject_reason == TicketRejectReason::None ? request.is_vip : 0;
+    return reply;
+}
+
+// Frees the queue places of `count` admitted petents with one atomic update and one release
+static void release_queue_places(SharedState* shared_state, size_t count) {
+    shared_state->leave_queue(static_cast<uint32_t>(count));
+    shared_state->admission.release(static_cast<uint32_t>(count));
+}
+
+using ReplyEnvelope = ipc::msg::MsgEnvelope<TicketIssuedMsg>;
+
+// Sends the replies of one reply shard with send_batch; failed ones are logged and skipped
+static void send_replies(SharedState* shared_state, size_t shard, const ReplyEnvelope* replies, size_t count) {
+    int reply_msg_id = ipc::helper::get_reply_queue(shard);
+    size_t sent = 0;
+    while (sent < count) {
+        size_t done = reply_msg_id == -1 ? 0 : ipc::msg::send_batch(reply_msg_id, replies + sent, count - sent);
+        for (size_t i = sent; i < sent + done; ++i) {
+            const TicketIssuedMsg& reply = replies[i].data;
+            switch (reply.reject_reason) {
+                case TicketRejectReason::OfficeClosed:
+                    DayStats::bump(shared_state->stats.rejected_closed, reply.department);
+                    Logger::log<LogSeverity::Notice>(Identity::Rejestracja,
+                                                     "Urzad zamkniety, bilet nie zostal wydany.");
+                    break;
+                case TicketRejectReason::LimitReached:
+                    DayStats::bump(shared_state->stats.rejected_limit, reply.department);
+                    Logger::event<LogSeverity::Notice>(Identity::Rejestracja, LogEvent::TicketLimitReached,
+                                                       reply.department);
+                    break;
+                default:
+                    Logger::event<LogSeverity::Info>(Identity::Rejestracja, LogEvent::TicketIssued,
+                                                     reply.ticket_number);
+                    break;
+            }
+        }
+        sent += done;
+        if (sent < count) {
+            std::string error = "Blad wyslania biletu dla petenta " + std::to_string(replies[sent].data.petent_id);
+            Logger::log(LogSeverity::Err, Identity::Rejestracja, error);
+            sent++;
+        }
+    }
+}
+
+// Issues (or rejects) tickets for one batch of requests and sends all replies, grouped by reply shard
+static void handle_requests(SharedState* shared_state, const TicketRequestMsg* requests, size_t count) {
+    ReplyEnvelope replies[kReplyShardCount][kRequestBatch];
+    size_t reply_counts[kReplyShardCount] = {};
+
+    release_queue_places(shared_state, count);
+
+    bool office_closed = !shared_state->is_open();
+    for (size_t i = 0; i < count; ++i) {
+        const TicketRequestMsg& request = requests[i];
+        TicketIssuedMsg reply{};
+        if (office_closed) {
+            reply = make_reply(request, request.department, 0, TicketRejectReason::OfficeClosed);
+        }
+        else {
+            UrzednikRole department = request.department;
+            if (!is_valid_department(department)) {
+                Logger::log(LogSeverity::Err, Identity::Rejestracja, "Nieprawidlowy wydzial w prosbie o bilet.");
+                department = UrzednikRole::SA;
+            }
+            uint32_t ticket_number = shared_state->take_ticket(department);
+            TicketRejectReason reject_reason =
+                ticket_number == 0 ? TicketRejectReason::LimitReached : TicketRejectReason::None;
+            reply = make_reply(request, department, ticket_number, reject_reason);
+        }
+        size_t shard = ipc::helper::reply_shard(request.petent_id);
+        replies[shard][reply_counts[shard]++] = {static_cast<long>(request.petent_id), reply};
+    }
+
+    for (size_t shard = 0; shard < kReplyShardCount; ++shard) {
+        if (reply_counts[shard] > 0) {
+            send_replies(shared_state, shard, replies[shard], reply_counts[shard]);
+        }
+    }
+}
+
 int rejestracja_main() {
     ipc::install_signal_handler(SIGTERM, handle_shutdown_signal);
     ipc::install_signal_handler(SIGUSR1, handle_finish_signal);
+    dayshift::install_day_end_handler();
     signal(SIGINT, SIG_IGN);
     signal(SIGUSR2, SIG_IGN);
 
-    Logger::log(LogSeverity::Info, Identity::Rejestracja, "Rejestracja uruchomiona.");
+    Logger::log<LogSeverity::Info>(Identity::Rejestracja, "Rejestracja uruchomiona.");
 
     auto shared_state = ipc::helper::get_shared_state(false);
     if (!shared_state) {
@@ -49,20 +145,25 @@ int rejestracja_main() {
         return 1;
     }
 
-    int sem_id = ipc::helper::get_semaphore_set(2);
-    if (sem_id == -1) {
-        ipc::shm::detach(shared_state);
-        return 1;
-    }
+    dayshift::Shift shift(shared_state);
+    auto should_stop = [] { return !rejestracja_running || stop_after_current; };
 
+    TicketRequestMsg requests[kRequestBatch];
     while (rejestracja_running) {
         if (stop_after_current) {
             break;
         }
+        if (shift.day_ended()) {
+            // Nothing is kept between batches; dyrektor drains the request queue while the machines sleep
+            if (!shift.finish_day(should_stop)) {
+                break;
+            }
+            continue;
+        }
 
-        TicketRequestMsg request{};
-        int rc = ipc::msg::receive<TicketRequestMsg>(msg_req_id, kTicketRequestType, &request, 0);
-        if (rc == -1) {
+        int received = ipc::msg::receive_batch<TicketRequestMsg>(msg_req_id, kTicketRequestType, requests,
+                                                                 kRequestBatch, 0);
+        if (received == -1) {
             if (errno != EINTR) {
                 std::string error = "Blad odbioru z kolejki biletow: " + std::string(std::strerror(errno));
                 Logger::log(LogSeverity::Err, Identity::Rejestracja, error);
@@ -72,109 +173,35 @@ int rejestracja_main() {
             continue;
         }
 
-        if (request.petent_id == 0) {
-            Logger::log(LogSeverity::Notice, Identity::Rejestracja, "Otrzymano sygnal zakonczenia.");
-            break;
+        // Requests behind the shutdown sentinel get no reply, same as the ones dyrektor drains from the queue
+        size_t count = 0;
+        while (count < static_cast<size_t>(received) && requests[count].petent_id != 0) {
+            count++;
         }
-
-        if (ipc::sem::wait(sem_id, 1) == -1) {
-            Logger::log(LogSeverity::Err, Identity::Rejestracja, "Blad blokady stanu wspoldzielonego.");
-        }
-        else {
-            if (shared_state->current_queue_length > 0) {
-                shared_state->current_queue_length--;
-            }
-            if (ipc::sem::post(sem_id, 1) == -1) {
-                Logger::log(LogSeverity::Err, Identity::Rejestracja, "Blad odblokowania stanu wspoldzielonego.");
-            }
-        }
-
-        if (ipc::sem::post(sem_id, 0) == -1) {
-            Logger::log(LogSeverity::Err, Identity::Rejestracja, "Blad zwiekszenia liczby wolnych miejsc w kolejce.");
+        if (count > 0) {
+            handle_requests(shared_state, requests, count);
         }
 
-        if (shared_state->office_status == OfficeStatus::Closed) {
-            TicketIssuedMsg rejected{};
-            rejected.petent_id = request.petent_id;
-            rejected.ticket_number = 0;
-            rejected.department = request.department;
-            rejected.redirected_from_sa = 0;
-            rejected.reject_reason = TicketRejectReason::OfficeClosed;
-            if (ipc::msg::send<TicketIssuedMsg>(msg_req_id, static_cast<long>(request.petent_id), rejected) == -1) {
-                std::string error =
-                    "Blad zwrotu informacji o zamknietym urzedzie dla petenta " + std::to_string(request.petent_id);
-                Logger::log(LogSeverity::Err, Identity::Rejestracja, error);
+        if (count < static_cast<size_t>(received)) {
+            // A batch can hold the sentinels of the other ticket machines too; they go back to the queue
+            int returned = 0;
+            for (size_t i = count + 1; i < static_cast<size_t>(received); ++i) {
+                if (requests[i].petent_id == 0 &&
+                    ipc::msg::send<TicketRequestMsg>(msg_req_id, kTicketRequestType, requests[i], IPC_NOWAIT) == 0) {
+                    returned++;
+                }
             }
-            Logger::log(LogSeverity::Notice, Identity::Rejestracja, "Urzad zamkniety, bilet nie zostal wydany.");
-            continue;
-        }
-
-        UrzednikRole department = request.department;
-        if (!is_valid_department(department)) {
-            Logger::log(LogSeverity::Err, Identity::Rejestracja, "Nieprawidlowy wydzial w prosbie o bilet.");
-            department = UrzednikRole::SA;
-        }
-        int idx = static_cast<int>(department);
-        uint32_t ticket_number = 0;
-        TicketRejectReason reject_reason = TicketRejectReason::None;
-        if (ipc::sem::wait(sem_id, 1) == -1) {
-            Logger::log(LogSeverity::Err, Identity::Rejestracja, "Blad blokady licznika biletow.");
-            continue;
-        }
-        uint32_t limit = shared_state->ticket_limits[idx];
-        uint32_t current = shared_state->ticket_counters[idx];
-        if (limit != 0 && current >= limit) {
-            reject_reason = TicketRejectReason::LimitReached;
-        }
-        else {
-            ticket_number = ++shared_state->ticket_counters[idx];
-        }
-        if (ipc::sem::post(sem_id, 1) == -1) {
-            Logger::log(LogSeverity::Err, Identity::Rejestracja, "Blad odblokowania licznika biletow.");
-        }
-
-        if (reject_reason != TicketRejectReason::None) {
-            TicketIssuedMsg rejected{};
-            rejected.petent_id = request.petent_id;
-            rejected.ticket_number = 0;
-            rejected.department = department;
-            rejected.redirected_from_sa = 0;
-            rejected.reject_reason = reject_reason;
-            if (ipc::msg::send<TicketIssuedMsg>(msg_req_id, static_cast<long>(request.petent_id), rejected) == -1) {
-                std::string error =
-                    "Blad zwrotu informacji o braku limitu dla petenta " + std::to_string(request.petent_id);
-                Logger::log(LogSeverity::Err, Identity::Rejestracja, error);
+            if (returned > 0) {
+                Logger::log<LogSeverity::Debug>(Identity::Rejestracja, [&] {
+                    return "Zwrocono do kolejki " + std::to_string(returned) + " sygnalow zakonczenia.";
+                });
             }
-            auto dept_name = urzednik_role_to_string(department);
-            std::string dept = dept_name ? std::string(*dept_name) : std::string("?");
-            Logger::log(LogSeverity::Notice, Identity::Rejestracja,
-                        "Brak wolnych terminow w wydziale " + dept + ", bilet nie zostal wydany.");
-            continue;
-        }
-
-        TicketIssuedMsg issued{};
-        issued.petent_id = request.petent_id;
-        issued.ticket_number = ticket_number;
-        issued.department = department;
-        issued.redirected_from_sa = 0;
-        issued.reject_reason = TicketRejectReason::None;
-        issued.is_vip = request.is_vip;
-
-        if (ipc::msg::send<TicketIssuedMsg>(msg_req_id, static_cast<long>(request.petent_id), issued) == -1) {
-            std::string error = "Blad wyslania biletu dla petenta " + std::to_string(request.petent_id);
-            Logger::log(LogSeverity::Err, Identity::Rejestracja, error);
-            continue;
-        }
-
-        Logger::log(LogSeverity::Info, Identity::Rejestracja,
-                    "Wydano bilet nr " + std::to_string(ticket_number) + " do wydzialu.");
-
-        if (stop_after_current) {
+            Logger::log<LogSeverity::Notice>(Identity::Rejestracja, "Otrzymano sygnal zakonczenia.");
             break;
         }
     }
 
     ipc::shm::detach(shared_state);
-    Logger::log(LogSeverity::Info, Identity::Rejestracja, "Rejestracja zakonczona.");
+    Logger::log<LogSeverity::Info>(Identity::Rejestracja, "Rejestracja zakonczona.");
     return 0;
 }
@@ -1,14 +1,20 @@
 #ifndef SO_PROJEKT_REPORT_H
 #define SO_PROJEKT_REPORT_H
 
+#include <algorithm>
 #include <cerrno>
+#include <climits>
+#include <cstdio>
 #include <cstring>
 #include <fcntl.h>
 #include <string>
 #include <string_view>
 #include <sys/file.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include <vector>
 #include "common.h"
+#include "ipcutils.h"
 
 namespace report {
 
@@ -16,63 +22,343 @@ inline std::string report_path(uint32_t day_number) {
     return "/tmp/so_projekt_report_day_" + std::to_string(day_number) + ".txt";
 }
 
-inline int append_line(uint32_t day_number, std::string_view line) {
-    std::string path = report_path(day_number);
-    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
-    if (fd == -1) {
-        perror("open report file failed");
-        return -1;
+// Collects report lines of one process and appends them with a single writev() under one flock().
+// Drain loops add() every line and call flush() once they are done; the destructor flushes leftovers.
+class Writer {
+public:
+    static constexpr size_t kMaxPending = IOV_MAX < 1024 ? IOV_MAX : 1024;
+
+    explicit Writer(uint32_t day_number) : day_number(day_number) {}
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    ~Writer() { flush(); }
+
+    void add(std::string_view line) {
+        std::string& entry = pending.emplace_back(line);
+        entry.push_back('\n');
+        if (pending.size() >= kMaxPending) {
+            flush();
+        }
     }
 
-    if (flock(fd, LOCK_EX) == -1) {
-        perror("flock report file failed");
-        close(fd);
-        return -1;
+    void unserved_after_close(uint32_t petent_id, UrzednikRole dept, uint32_t ticket_number) {
+        add(std::to_string(petent_id) + " - sprawa do " + dept_text(dept) + " - nr biletu " +
+            std::to_string(ticket_number));
     }
 
-    std::string line_with_newline(line);
-    line_with_newline.push_back('\n');
-    if (write(fd, line_with_newline.c_str(), line_with_newline.size()) == -1) {
-        perror("write report file failed");
-        flock(fd, LOCK_UN);
-        close(fd);
-        return -1;
+    void unserved_after_signal(uint32_t petent_id, UrzednikRole dept, std::string_view issuer) {
+        add(std::to_string(petent_id) + " - skierowanie do " + dept_text(dept) + " - wystawil " +
+            std::string(issuer));
     }
 
-    if (flock(fd, LOCK_UN) == -1) {
-        perror("flock unlock report file failed");
-        close(fd);
-        return -1;
+    int flush() {
+        if (pending.empty()) {
+            return 0;
+        }
+
+        std::string path = report_path(day_number);
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd == -1) {
+            perror("open report file failed");
+            pending.clear();
+            return -1;
+        }
+
+        if (flock(fd, LOCK_EX) == -1) {
+            perror("flock report file failed");
+            close(fd);
+            pending.clear();
+            return -1;
+        }
+
+        std::vector<iovec> iov;
+        iov.reserve(pending.size());
+        for (std::string& line : pending) {
+            iov.push_back({line.data(), line.size()});
+        }
+        int rc = 0;
+        if (ipc::write_all(fd, iov.data(), static_cast<int>(iov.size())) == -1) {
+            perror("write report file failed");
+            rc = -1;
+        }
+        pending.clear();
+
+        if (flock(fd, LOCK_UN) == -1) {
+            perror("flock unlock report file failed");
+            rc = -1;
+        }
+
+        if (close(fd) == -1) {
+            perror("close report file failed");
+            return -1;
+        }
+
+        return rc;
+    }
+
+private:
+    static std::string dept_text(UrzednikRole dept) {
+        auto dept_str = urzednik_role_to_string(dept);
+        return dept_str ? std::string(*dept_str) : "NIEZNANY";
+    }
+
+    uint32_t day_number;
+    std::vector<std::string> pending;
+};
+
+inline int append_line(uint32_t day_number, std::string_view line) {
+    Writer writer(day_number);
+    writer.add(line);
+    return writer.flush();
+}
+
+inline void log_unserved_after_signal(uint32_t day_number, uint32_t petent_id, UrzednikRole dept,
+                                      std::string_view issuer) {
+    Writer writer(day_number);
+    writer.unserved_after_signal(petent_id, dept, issuer);
+}
+
+// End-of-day KPI summary, snapshotted from SharedState by dyrektor at rollover
+struct DepartmentSummary {
+    uint32_t limit;
+    uint32_t issued;
+    uint32_t served;
+    uint32_t redirected_from_sa;
+    uint32_t sent_to_kasa;
+    uint32_t rejected_limit;
+    uint32_t rejected_closed;
+    uint32_t unserved;
+};
+
+struct LatencySummary {
+    uint32_t count;
+    uint32_t avg_us;
+    uint32_t max_us;
+};
+
+struct KasaWindowSummary {
+    uint32_t payments;
+    uint32_t busy_minutes;
+    uint32_t utilization_pct; // busy time against the simulated day, opening to rollover
+};
+
+struct DaySummary {
+    uint32_t day;
+    DepartmentSummary departments[kDepartmentCount];
+    uint32_t evacuated;
+    uint32_t peak_queue_length;
+    uint32_t peak_ticket_machines;
+    uint32_t peak_kasa_windows;
+    uint32_t kasa_window_count; // windows listed in kasa_windows: every one opened during the day
+    KasaWindowSummary kasa_windows[kMaxKasaWindows];
+    LatencySummary petent_startup;
+    LatencySummary petent_first_send;
+};
+
+inline LatencySummary summarize_latency(const LatencyStat& stat) {
+    LatencySummary summary{};
+    summary.count = stat.count.load();
+    summary.avg_us = summary.count == 0 ? 0 : static_cast<uint32_t>(stat.total_us.load() / summary.count);
+    summary.max_us = stat.max_us.load();
+    return summary;
+}
+
+inline DaySummary snapshot_day(uint32_t day_number, const SharedState& state) {
+    DaySummary summary{};
+    summary.day = day_number;
+    for (size_t i = 0; i < kDepartmentCount; ++i) {
+        DepartmentSummary& dept = summary.departments[i];
+        dept.limit = state.ticket_limits[i];
+        dept.issued = state.ticket_counters[i].value.load();
+        dept.served = state.stats.served[i].load();
+        dept.redirected_from_sa = state.stats.redirected_from_sa[i].load();
+        dept.sent_to_kasa = state.stats.sent_to_kasa[i].load();
+        dept.rejected_limit = state.stats.rejected_limit[i].load();
+        dept.rejected_closed = state.stats.rejected_closed[i].load();
+        dept.unserved = state.stats.unserved[i].load();
+    }
+    summary.evacuated = state.stats.evacuated.load();
+    summary.peak_queue_length = state.stats.peak_queue_length.load();
+    summary.peak_ticket_machines = state.stats.peak_ticket_machines.load();
+    summary.peak_kasa_windows = state.stats.peak_kasa_windows.load();
+    // Windows are numbered from 1 without gaps, so the peak covers every window that was open
+    summary.kasa_window_count = std::min<uint32_t>(summary.peak_kasa_windows, kMaxKasaWindows);
+    // At rollover the clock still shows the end of the day just over, past closing time
+    auto opening = static_cast<uint32_t>(std::max(0, state.config.hours_open.first * 3600));
+    uint32_t now = state.simulated_time.load();
+    uint32_t day_sec = now > opening ? now - opening : 0;
+    for (int i = 0; i < kMaxKasaWindows; ++i) {
+        KasaWindowSummary& window = summary.kasa_windows[i];
+        uint32_t busy_sec = state.stats.kasa_busy_sec[i].load();
+        window.payments = state.stats.kasa_payments[i].load();
+        window.busy_minutes = busy_sec / 60;
+        window.utilization_pct =
+            day_sec == 0 ? 0 : static_cast<uint32_t>(static_cast<uint64_t>(busy_sec) * 100 / day_sec);
+        if (window.payments > 0) {
+            summary.kasa_window_count = std::max(summary.kasa_window_count, static_cast<uint32_t>(i + 1));
+        }
     }
+    summary.petent_startup = summarize_latency(state.stats.petent_startup);
+    summary.petent_first_send = summarize_latency(state.stats.petent_first_send);
+    return summary;
+}
 
+inline std::string summary_path(uint32_t day_number, std::string_view extension) {
+    return "/tmp/so_projekt_summary_day_" + std::to_string(day_number) + "." + std::string(extension);
+}
+
+inline int write_file(const std::string& path, const std::string& content) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        perror("open summary file failed");
+        return -1;
+    }
+    iovec iov{const_cast<char*>(content.data()), content.size()};
+    int rc = ipc::write_all(fd, &iov, 1);
+    if (rc == -1) {
+        perror("write summary file failed");
+    }
     if (close(fd) == -1) {
-        perror("close report file failed");
+        perror("close summary file failed");
         return -1;
     }
+    return rc;
+}
 
-    return 0;
+inline DepartmentSummary summary_total(const DaySummary& summary) {
+    DepartmentSummary total{};
+    for (const DepartmentSummary& dept : summary.departments) {
+        total.limit += dept.limit;
+        total.issued += dept.issued;
+        total.served += dept.served;
+        total.redirected_from_sa += dept.redirected_from_sa;
+        total.sent_to_kasa += dept.sent_to_kasa;
+        total.rejected_limit += dept.rejected_limit;
+        total.rejected_closed += dept.rejected_closed;
+        total.unserved += dept.unserved;
+    }
+    return total;
 }
 
-inline void log_unserved_after_close(uint32_t day_number, uint32_t petent_id, UrzednikRole dept,
-                                     uint32_t ticket_number) {
-    auto dept_str = urzednik_role_to_string(dept);
-    std::string dept_text = dept_str ? std::string(*dept_str) : "NIEZNANY";
-    std::string line = std::to_string(petent_id) +
-                       " - sprawa do " + dept_text +
-                       " - nr biletu " + std::to_string(ticket_number);
-    append_line(day_number, line);
+inline std::string dept_name(size_t idx) {
+    return std::string(urzednik_role_to_string(static_cast<UrzednikRole>(idx)).value_or("?"));
 }
 
-inline void log_unserved_after_signal(uint32_t day_number, uint32_t petent_id, UrzednikRole dept,
-                                      std::string_view issuer) {
-    auto dept_str = urzednik_role_to_string(dept);
-    std::string dept_text = dept_str ? std::string(*dept_str) : "NIEZNANY";
-    std::string line = std::to_string(petent_id) +
-                       " - skierowanie do " + dept_text +
-                       " - wystawil " + std::string(issuer);
-    append_line(day_number, line);
+// Long format (one value per row) so that summaries of many days can simply be concatenated
+inline std::string format_summary_csv(const DaySummary& summary) {
+    std::string out = "dzien,wydzial,metryka,wartosc\n";
+    auto row = [&](std::string_view dept, std::string_view metric, uint32_t value) {
+        out += std::to_string(summary.day) + "," + std::string(dept) + "," + std::string(metric) + "," +
+               std::to_string(value) + "\n";
+    };
+    for (size_t i = 0; i < kDepartmentCount; ++i) {
+        const DepartmentSummary& dept = summary.departments[i];
+        std::string name = dept_name(i);
+        row(name, "limit", dept.limit);
+        row(name, "wydane", dept.issued);
+        row(name, "obsluzone", dept.served);
+        row(name, "przekierowane_z_sa", dept.redirected_from_sa);
+        row(name, "do_kasy", dept.sent_to_kasa);
+        row(name, "odrzucone_limit", dept.rejected_limit);
+        row(name, "odrzucone_zamkniete", dept.rejected_closed);
+        row(name, "nieobsluzone", dept.unserved);
+    }
+    row("RAZEM", "ewakuowani", summary.evacuated);
+    row("RAZEM", "max_kolejka", summary.peak_queue_length);
+    row("RAZEM", "max_biletomaty", summary.peak_ticket_machines);
+    row("RAZEM", "max_kasy", summary.peak_kasa_windows);
+    for (uint32_t i = 0; i < summary.kasa_window_count; ++i) {
+        std::string name = "KASA" + std::to_string(i + 1);
+        row(name, "platnosci", summary.kasa_windows[i].payments);
+        row(name, "zajetosc_min", summary.kasa_windows[i].busy_minutes);
+        row(name, "zajetosc_proc", summary.kasa_windows[i].utilization_pct);
+    }
+    row("RAZEM", "start_petenta_sr_us", summary.petent_startup.avg_us);
+    row("RAZEM", "start_petenta_max_us", summary.petent_startup.max_us);
+    row("RAZEM", "pierwsza_prosba_sr_us", summary.petent_first_send.avg_us);
+    row("RAZEM", "pierwsza_prosba_max_us", summary.petent_first_send.max_us);
+    return out;
+}
+
+inline std::string format_summary_json(const DaySummary& summary) {
+    std::string out = "{\n  \"day\": " + std::to_string(summary.day) + ",\n  \"departments\": {\n";
+    for (size_t i = 0; i < kDepartmentCount; ++i) {
+        const DepartmentSummary& dept = summary.departments[i];
+        out += "    \"" + dept_name(i) + "\": {\"limit\": " + std::to_string(dept.limit) +
+               ", \"issued\": " + std::to_string(dept.issued) + ", \"served\": " + std::to_string(dept.served) +
+               ", \"redirected_from_sa\": " + std::to_string(dept.redirected_from_sa) +
+               ", \"sent_to_kasa\": " + std::to_string(dept.sent_to_kasa) +
+               ", \"rejected_limit\": " + std::to_string(dept.rejected_limit) +
+               ", \"rejected_office_closed\": " + std::to_string(dept.rejected_closed) +
+               ", \"unserved\": " + std::to_string(dept.unserved) + "}";
+        out += i + 1 < kDepartmentCount ? ",\n" : "\n";
+    }
+    out += "  },\n  \"evacuated\": " + std::to_string(summary.evacuated) +
+           ",\n  \"peak_queue_length\": " + std::to_string(summary.peak_queue_length) +
+           ",\n  \"peak_ticket_machines\": " + std::to_string(summary.peak_ticket_machines) +
+           ",\n  \"peak_kasa_windows\": " + std::to_string(summary.peak_kasa_windows) + ",\n  \"kasa_windows\": [";
+    for (uint32_t i = 0; i < summary.kasa_window_count; ++i) {
+        const KasaWindowSummary& window = summary.kasa_windows[i];
+        out += std::string(i > 0 ? ", " : "") + "{\"window\": " + std::to_string(i + 1) +
+               ", \"payments\": " + std::to_string(window.payments) +
+               ", \"busy_minutes\": " + std::to_string(window.busy_minutes) +
+               ", \"utilization_pct\": " + std::to_string(window.utilization_pct) + "}";
+    }
+    out += "]";
+    auto latency = [&](std::string_view name, const LatencySummary& value) {
+        out += ",\n  \"" + std::string(name) + "\": {\"count\": " + std::to_string(value.count) +
+               ", \"avg\": " + std::to_string(value.avg_us) + ", \"max\": " + std::to_string(value.max_us) + "}";
+    };
+    latency("petent_startup_us", summary.petent_startup);
+    latency("petent_first_send_us", summary.petent_first_send);
+    out += "\n}\n";
+    return out;
+}
+
+inline std::string format_summary_text(const DaySummary& summary) {
+    std::string out = "Podsumowanie dnia " + std::to_string(summary.day) + "\n\n";
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-8s %7s %7s %10s %14s %8s %13s %15s %13s\n", "Wydzial", "Limit", "Wydane",
+                  "Obsluzone", "Przekier. z SA", "Do kasy", "Odrz. (limit)", "Odrz. (zamk.)", "Nieobsluzone");
+    out += line;
+    auto add_row = [&](const std::string& name, const DepartmentSummary& dept) {
+        std::snprintf(line, sizeof(line), "%-8s %7u %7u %10u %14u %8u %13u %15u %13u\n", name.c_str(), dept.limit,
+                      dept.issued, dept.served, dept.redirected_from_sa, dept.sent_to_kasa, dept.rejected_limit,
+                      dept.rejected_closed, dept.unserved);
+        out += line;
+    };
+    for (size_t i = 0; i < kDepartmentCount; ++i) {
+        add_row(dept_name(i), summary.departments[i]);
+    }
+    add_row("RAZEM", summary_total(summary));
+    out += "\nEwakuowani petenci: " + std::to_string(summary.evacuated) + "\n";
+    out += "Najdluzsza kolejka: " + std::to_string(summary.peak_queue_length) + "\n";
+    out += "Maksymalna liczba biletomatow: " + std::to_string(summary.peak_ticket_machines) + "\n";
+    out += "Maksymalna liczba okienek kasy: " + std::to_string(summary.peak_kasa_windows) + "\n";
+    for (uint32_t i = 0; i < summary.kasa_window_count; ++i) {
+        const KasaWindowSummary& window = summary.kasa_windows[i];
+        out += "Okienko kasy " + std::to_string(i + 1) + ": " + std::to_string(window.payments) + " platnosci, " +
+               std::to_string(window.busy_minutes) + " min, zajetosc " + std::to_string(window.utilization_pct) +
+               "%\n";
+    }
+    out += "Start petenta od przybycia: sr. " + std::to_string(summary.petent_startup.avg_us) + " us, max " +
+           std::to_string(summary.petent_startup.max_us) + " us\n";
+    out += "Pierwsza prosba o bilet od przybycia: sr. " + std::to_string(summary.petent_first_send.avg_us) +
+           " us, max " + std::to_string(summary.petent_first_send.max_us) + " us\n";
+    return out;
+}
+
+// Writes summary_day_N.csv, .json and .txt; returns -1 if any of them failed
+inline int write_day_summary(const DaySummary& summary) {
+    int rc = 0;
+    rc |= write_file(summary_path(summary.day, "csv"), format_summary_csv(summary));
+    rc |= write_file(summary_path(summary.day, "json"), format_summary_json(summary));
+    rc |= write_file(summary_path(summary.day, "txt"), format_summary_text(summary));
+    return rc == 0 ? 0 : -1;
 }
 
 } // namespace report
 
-#endif // SO_PROJEKT_REPORT_H
\ No newline at end of file
+#endif // SO_PROJEKT_REPORT_H
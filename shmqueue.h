@@ -0,0 +1,484 @@
+#ifndef SO_PROJEKT_SHMQUEUE_H
+#define SO_PROJEKT_SHMQUEUE_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include "futex.h"
+
+// Shared-memory replacement for one SysV message queue (selected with --transport shm).
+// The mtype patterns used by the project map onto two structures:
+//  - mtypes 1..kLaneCount go to bounded MPMC rings ("lanes", per-slot sequence numbers, CAS on the positions);
+//    a negative msgtyp pops the lowest non-empty lane first, like msgrcv() does
+//  - any larger mtype is an addressed reply (petent pid) and goes to a mailbox bucket chosen by mtype
+// Uncontended operations are plain atomics; futexes are only touched when a side has to sleep or wake someone.
+namespace shmq {
+
+    constexpr size_t kMaxPayload = 16; // largest message struct in common.h
+    constexpr long kLaneCount = 3;
+    constexpr uint32_t kLaneCapacity = 4096; // must be a power of two
+    constexpr uint32_t kLaneMask = kLaneCapacity - 1;
+    constexpr uint32_t kMailboxBuckets = 64;
+    constexpr uint32_t kMailboxSlots = 16;
+    constexpr int kMaxHandles = 16;
+
+    struct Cell {
+        std::atomic<uint64_t> seq;
+        uint32_t length;
+        alignas(8) char data[kMaxPayload];
+    };
+
+    struct Lane {
+        alignas(64) std::atomic<uint64_t> enqueue_pos;
+        alignas(64) std::atomic<uint64_t> dequeue_pos;
+        Cell cells[kLaneCapacity];
+    };
+
+    constexpr int64_t kSlotFree = 0;
+    constexpr int64_t kSlotBusy = -1;
+
+    struct MailboxSlot {
+        std::atomic<int64_t> owner; // kSlotFree, kSlotBusy or the addressed mtype
+        uint32_t stamp; // publish order within the bucket, keeps replies to one pid FIFO
+        uint32_t length;
+        alignas(8) char data[kMaxPayload];
+    };
+
+    struct MailboxBucket {
+        alignas(64) std::atomic<uint32_t> seq; // futex word, bumped on every publish
+        std::atomic<uint32_t> waiters;
+        MailboxSlot slots[kMailboxSlots];
+    };
+
+    struct Queue {
+        std::atomic<uint32_t> removed;
+        alignas(64) std::atomic<uint32_t> lane_seq; // futex word, bumped on every lane push
+        std::atomic<uint32_t> lane_waiters;
+        alignas(64) std::atomic<uint32_t> space_seq; // futex word, bumped whenever a lane cell or mailbox slot frees up
+        std::atomic<uint32_t> space_waiters;
+        Lane lanes[kLaneCount];
+        MailboxBucket buckets[kMailboxBuckets];
+
+        Queue() : removed(0), lane_seq(0), lane_waiters(0), space_seq(0), space_waiters(0) {
+            for (Lane& lane : lanes) {
+                new (&lane.enqueue_pos) std::atomic<uint64_t>(0);
+                new (&lane.dequeue_pos) std::atomic<uint64_t>(0);
+                for (uint32_t i = 0; i < kLaneCapacity; ++i) {
+                    new (&lane.cells[i].seq) std::atomic<uint64_t>(i);
+                }
+            }
+            for (MailboxBucket& bucket : buckets) {
+                new (&bucket.seq) std::atomic<uint32_t>(0);
+                new (&bucket.waiters) std::atomic<uint32_t>(0);
+                for (MailboxSlot& slot : bucket.slots) {
+                    new (&slot.owner) std::atomic<int64_t>(kSlotFree);
+                }
+            }
+        }
+    };
+
+    // Per-process table of attached queues; handles returned to ipc::msg are indexes into it
+    struct Attachment {
+        key_t key;
+        int shm_id;
+        Queue* queue;
+    };
+
+    inline Attachment attachments[kMaxHandles];
+    inline int attachment_count = 0;
+
+    inline Queue* queue_for(int handle) {
+        if (handle < 0 || handle >= attachment_count || attachments[handle].queue == nullptr) {
+            errno = EINVAL;
+            return nullptr;
+        }
+        return attachments[handle].queue;
+    }
+
+    inline int remember(key_t key, int shm_id, Queue* queue) {
+        for (int i = 0; i < attachment_count; ++i) {
+            if (attachments[i].key == key) {
+                attachments[i] = {key, shm_id, queue};
+                return i;
+            }
+        }
+        if (attachment_count >= kMaxHandles) {
+            errno = ENOSPC;
+            return -1;
+        }
+        attachments[attachment_count] = {key, shm_id, queue};
+        return attachment_count++;
+    }
+
+    inline Queue* attach_segment(int shm_id) {
+        void* addr = shmat(shm_id, nullptr, 0);
+        if (addr == (void*)-1) {
+            perror("shmat failed");
+            return nullptr;
+        }
+        return static_cast<Queue*>(addr);
+    }
+
+    inline int create(key_t key, mode_t permissions) {
+        int shm_id = shmget(key, sizeof(Queue), IPC_CREAT | IPC_EXCL | permissions);
+        if (shm_id == -1) {
+            int err = errno;
+            perror("shmget failed");
+            errno = err;
+            return -1;
+        }
+        Queue* queue = attach_segment(shm_id);
+        if (queue == nullptr) {
+            shmctl(shm_id, IPC_RMID, nullptr);
+            return -1;
+        }
+        new (queue) Queue();
+        return remember(key, shm_id, queue);
+    }
+
+    inline int get(key_t key) {
+        for (int i = 0; i < attachment_count; ++i) {
+            if (attachments[i].key == key && attachments[i].queue != nullptr) {
+                return i;
+            }
+        }
+        int shm_id = shmget(key, 0, 0);
+        if (shm_id == -1) {
+            perror("shmget failed");
+            return -1;
+        }
+        Queue* queue = attach_segment(shm_id);
+        if (queue == nullptr) {
+            return -1;
+        }
+        return remember(key, shm_id, queue);
+    }
+
+    // Attaches a queue whose segment id is already known (published by dyrektor); no shmget() needed
+    inline int open(key_t key, int shm_id) {
+        for (int i = 0; i < attachment_count; ++i) {
+            if (attachments[i].key == key && attachments[i].queue != nullptr) {
+                return i;
+            }
+        }
+        Queue* queue = attach_segment(shm_id);
+        if (queue == nullptr) {
+            return -1;
+        }
+        return remember(key, shm_id, queue);
+    }
+
+    inline int segment_id(int handle) {
+        return queue_for(handle) != nullptr ? attachments[handle].shm_id : -1;
+    }
+
+    // Deletes a segment left over by a previous run without attaching it
+    inline void unlink(key_t key) {
+        int shm_id = shmget(key, 0, 0);
+        if (shm_id != -1) {
+            shmctl(shm_id, IPC_RMID, nullptr);
+        }
+    }
+
+    // Marks the queue removed (blocked peers return EIDRM), detaches and deletes the segment
+    inline int remove(int handle) {
+        Queue* queue = queue_for(handle);
+        if (queue == nullptr) {
+            return -1;
+        }
+        queue->removed.store(1, std::memory_order_seq_cst);
+        queue->lane_seq.fetch_add(1, std::memory_order_seq_cst);
+        queue->space_seq.fetch_add(1, std::memory_order_seq_cst);
+        ipc::futex::wake(&queue->lane_seq);
+        ipc::futex::wake(&queue->space_seq);
+        for (MailboxBucket& bucket : queue->buckets) {
+            bucket.seq.fetch_add(1, std::memory_order_seq_cst);
+            ipc::futex::wake(&bucket.seq);
+        }
+
+        int shm_id = attachments[handle].shm_id;
+        attachments[handle].queue = nullptr;
+        shmdt(queue);
+        if (shmctl(shm_id, IPC_RMID, nullptr) == -1) {
+            perror("shmctl IPC_RMID failed");
+            return -1;
+        }
+        return 0;
+    }
+
+    inline bool lane_push(Lane& lane, const void* data, size_t length) {
+        uint64_t pos = lane.enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell = nullptr;
+        while (true) {
+            cell = &lane.cells[pos & kLaneMask];
+            uint64_t seq = cell->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+            if (diff == 0) {
+                if (lane.enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false; // full
+            }
+            else {
+                pos = lane.enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        std::memcpy(cell->data, data, length);
+        cell->length = static_cast<uint32_t>(length);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    inline bool lane_pop(Lane& lane, void* data, size_t length) {
+        uint64_t pos = lane.dequeue_pos.load(std::memory_order_relaxed);
+        Cell* cell = nullptr;
+        while (true) {
+            cell = &lane.cells[pos & kLaneMask];
+            uint64_t seq = cell->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos + 1);
+            if (diff == 0) {
+                if (lane.dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false; // empty
+            }
+            else {
+                pos = lane.dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        if (data != nullptr) {
+            std::memcpy(data, cell->data, length < cell->length ? length : cell->length);
+        }
+        cell->seq.store(pos + kLaneCapacity, std::memory_order_release);
+        return true;
+    }
+
+    inline MailboxBucket& bucket_for(Queue* queue, long mtype) {
+        return queue->buckets[static_cast<unsigned long>(mtype) % kMailboxBuckets];
+    }
+
+    inline bool mailbox_put(MailboxBucket& bucket, long mtype, const void* data, size_t length) {
+        for (MailboxSlot& slot : bucket.slots) {
+            int64_t expected = kSlotFree;
+            if (slot.owner.compare_exchange_strong(expected, kSlotBusy, std::memory_order_acquire)) {
+                std::memcpy(slot.data, data, length);
+                slot.length = static_cast<uint32_t>(length);
+                slot.stamp = bucket.seq.load(std::memory_order_relaxed);
+                slot.owner.store(mtype, std::memory_order_release);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline bool mailbox_take(MailboxBucket& bucket, long mtype, void* data, size_t length) {
+        while (true) {
+            MailboxSlot* oldest = nullptr;
+            for (MailboxSlot& slot : bucket.slots) {
+                int64_t owner = slot.owner.load(std::memory_order_acquire);
+                if ((mtype == 0 && owner > 0) || (mtype != 0 && owner == mtype)) {
+                    if (oldest == nullptr || static_cast<int32_t>(slot.stamp - oldest->stamp) < 0) {
+                        oldest = &slot;
+                    }
+                }
+            }
+            if (oldest == nullptr) {
+                return false;
+            }
+            int64_t expected = oldest->owner.load(std::memory_order_acquire);
+            if (expected <= 0 || !oldest->owner.compare_exchange_strong(expected, kSlotBusy, std::memory_order_acquire)) {
+                continue; // taken by another receiver in the meantime
+            }
+            if (data != nullptr) {
+                std::memcpy(data, oldest->data, length < oldest->length ? length : oldest->length);
+            }
+            oldest->owner.store(kSlotFree, std::memory_order_release);
+            return true;
+        }
+    }
+
+    inline void notify(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiters) {
+        seq.fetch_add(1, std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_seq_cst) != 0) {
+            ipc::futex::wake(&seq);
+        }
+    }
+
+    // Sleeps until `seq` moves away from `observed`; returns -1 with errno set when interrupted or removed
+    inline int sleep_on(Queue* queue, std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiters, uint32_t observed) {
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        int rc = 0;
+        if (seq.load(std::memory_order_seq_cst) == observed && !queue->removed.load(std::memory_order_acquire)) {
+            rc = ipc::futex::wait(&seq, observed);
+        }
+        int err = errno;
+        waiters.fetch_sub(1, std::memory_order_seq_cst);
+        if (rc == -1) {
+            errno = err;
+            return -1;
+        }
+        return 0;
+    }
+
+    // msgsnd() semantics: blocks while the lane/bucket is full unless IPC_NOWAIT (EAGAIN)
+    inline int send(int handle, long mtype, const void* data, size_t length, int flags) {
+        Queue* queue = queue_for(handle);
+        if (queue == nullptr || mtype <= 0 || length > kMaxPayload) {
+            errno = EINVAL;
+            return -1;
+        }
+        while (true) {
+            if (queue->removed.load(std::memory_order_acquire)) {
+                errno = EIDRM;
+                return -1;
+            }
+            uint32_t observed = queue->space_seq.load(std::memory_order_seq_cst);
+            if (mtype <= kLaneCount) {
+                if (lane_push(queue->lanes[mtype - 1], data, length)) {
+                    notify(queue->lane_seq, queue->lane_waiters);
+                    return 0;
+                }
+            }
+            else if (mailbox_put(bucket_for(queue, mtype), mtype, data, length)) {
+                MailboxBucket& bucket = bucket_for(queue, mtype);
+                notify(bucket.seq, bucket.waiters);
+                return 0;
+            }
+            if (flags & IPC_NOWAIT) {
+                errno = EAGAIN;
+                return -1;
+            }
+            if (sleep_on(queue, queue->space_seq, queue->space_waiters, observed) == -1) {
+                return -1;
+            }
+        }
+    }
+
+    inline bool try_receive(Queue* queue, long msgtyp, void* data, size_t length) {
+        if (msgtyp > kLaneCount) {
+            return mailbox_take(bucket_for(queue, msgtyp), msgtyp, data, length);
+        }
+        long lowest = msgtyp > 0 ? msgtyp : 1;
+        long highest = msgtyp > 0 ? msgtyp : (msgtyp < 0 ? -msgtyp : kLaneCount);
+        if (highest > kLaneCount) {
+            highest = kLaneCount;
+        }
+        for (long type = lowest; type <= highest; ++type) {
+            if (lane_pop(queue->lanes[type - 1], data, length)) {
+                return true;
+            }
+        }
+        if (msgtyp == 0) {
+            for (MailboxBucket& bucket : queue->buckets) {
+                if (mailbox_take(bucket, 0, data, length)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // msgrcv() semantics for msgtyp > 0 (exact), < 0 (lowest type <= |msgtyp|) and 0 (any)
+    inline int receive(int handle, long msgtyp, void* data, size_t length, int flags) {
+        Queue* queue = queue_for(handle);
+        if (queue == nullptr) {
+            return -1;
+        }
+        bool addressed = msgtyp > kLaneCount;
+        while (true) {
+            if (queue->removed.load(std::memory_order_acquire)) {
+                errno = EIDRM;
+                return -1;
+            }
+            std::atomic<uint32_t>& seq = addressed ? bucket_for(queue, msgtyp).seq : queue->lane_seq;
+            std::atomic<uint32_t>& waiters = addressed ? bucket_for(queue, msgtyp).waiters : queue->lane_waiters;
+            uint32_t observed = seq.load(std::memory_order_seq_cst);
+            if (try_receive(queue, msgtyp, data, length)) {
+                notify(queue->space_seq, queue->space_waiters);
+                return 0;
+            }
+            if (flags & IPC_NOWAIT) {
+                errno = ENOMSG;
+                return -1;
+            }
+            if (sleep_on(queue, seq, waiters, observed) == -1) {
+                return -1;
+            }
+        }
+    }
+
+    // receive() for the first message, then up to max_count - 1 more without sleeping; returns the number taken
+    inline int receive_batch(int handle, long msgtyp, void* data, size_t length, size_t max_count, int flags) {
+        if (receive(handle, msgtyp, data, length, flags) == -1) {
+            return -1;
+        }
+        Queue* queue = attachments[handle].queue;
+        auto* out = static_cast<char*>(data);
+        size_t count = 1;
+        while (count < max_count && try_receive(queue, msgtyp, out + count * length, length)) {
+            ++count;
+        }
+        if (count > 1) {
+            notify(queue->space_seq, queue->space_waiters);
+        }
+        return static_cast<int>(count);
+    }
+
+    // Approximate depth of the queue for monitoring (counts may be off by in-flight operations)
+    inline int stat(int handle, uint64_t* message_count, uint64_t* byte_count) {
+        Queue* queue = queue_for(handle);
+        if (queue == nullptr) {
+            return -1;
+        }
+        uint64_t messages = 0;
+        uint64_t bytes = 0;
+        for (Lane& lane : queue->lanes) {
+            uint64_t head = lane.dequeue_pos.load(std::memory_order_relaxed);
+            uint64_t tail = lane.enqueue_pos.load(std::memory_order_relaxed);
+            for (uint64_t pos = head; pos < tail && pos - head < kLaneCapacity; ++pos) {
+                messages++;
+                bytes += lane.cells[pos & kLaneMask].length;
+            }
+        }
+        for (MailboxBucket& bucket : queue->buckets) {
+            for (MailboxSlot& slot : bucket.slots) {
+                if (slot.owner.load(std::memory_order_relaxed) > 0) {
+                    messages++;
+                    bytes += slot.length;
+                }
+            }
+        }
+        *message_count = messages;
+        *byte_count = bytes;
+        return 0;
+    }
+
+    // Discards every pending message (lanes and mailboxes); returns how many were dropped
+    inline int drain(int handle) {
+        Queue* queue = queue_for(handle);
+        if (queue == nullptr) {
+            return -1;
+        }
+        int drained = 0;
+        while (try_receive(queue, 0, nullptr, 0)) {
+            ++drained;
+        }
+        if (drained > 0) {
+            notify(queue->space_seq, queue->space_waiters);
+        }
+        return drained;
+    }
+
+} // namespace shmq
+
+#endif // SO_PROJEKT_SHMQUEUE_H
@@ -5,6 +5,8 @@ ROOT_DIR=$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)
 BIN="$ROOT_DIR/so_projekt"
 LOG="/tmp/so_projekt.log"
 REPORT_BASE="/tmp/so_projekt_report_day_"
+SUMMARY_BASE="/tmp/so_projekt_summary_day_"
+SAMPLES_BASE="/tmp/so_projekt_samples_day_"
 
 log_info() {
   echo "[$(date +%H:%M:%S)] $*" >&2
@@ -33,6 +35,8 @@ clean_artifacts() {
   log_info "Czyszczenie logow i raportow"
   : > "$LOG"
   rm -f "${REPORT_BASE}"*.txt
+  rm -f "${SUMMARY_BASE}"*
+  rm -f "${SAMPLES_BASE}"*
   log_info "Czyszczenie zakonczone"
 }
 
@@ -88,6 +92,22 @@ assert_log() {
   fi
 }
 
+assert_summary_contains() {
+  local day="$1"
+  local extension="$2"
+  local pattern="$3"
+  local summary="${SUMMARY_BASE}${day}.${extension}"
+  log_info "Sprawdzam podsumowanie: $summary (pattern: $pattern)"
+  if [[ ! -f "$summary" ]]; then
+    echo "FAIL: missing summary file: $summary"
+    return 1
+  fi
+  if ! grep -q "$pattern" "$summary"; then
+    echo "FAIL: missing summary pattern: $pattern"
+    return 1
+  fi
+}
+
 assert_report_contains() {
   local day="$1"
   local pattern="$2"
@@ -7,5 +7,29 @@ DIR=$(cd "$(dirname "$0")" && pwd)
 "$DIR/test2_limits.sh"
 "$DIR/test3_sigusr1_urzednik.sh"
 "$DIR/test4_sigusr2_evacuation.sh"
+"$DIR/test5_log_ring.sh"
+"$DIR/test6_logdump.sh"
+"$DIR/test7_log_rate.sh"
+"$DIR/test8_day_summary.sh"
+"$DIR/test9_shm_transport.sh"
+"$DIR/test10_sampler.sh"
+"$DIR/test11_posix_transport.sh"
+"$DIR/test12_petent_threads.sh"
+"$DIR/test13_petent_zygote.sh"
+"$DIR/test14_persistent_workers.sh"
+"$DIR/test15_clerk_autoscale.sh"
+"$DIR/test16_ticket_machine_policy.sh"
+"$DIR/test17_worker_exit.sh"
+"$DIR/test18_cpu_placement.sh"
+"$DIR/test19_kasa_parking.sh"
+"$DIR/test20_kasa_windows.sh"
+"$DIR/test21_des.sh"
+"$DIR/test22_reply_shards.sh"
+"$DIR/test23_rejestracja_sentinels.sh"
+"$DIR/test24_ticket_contention.sh"
+"$DIR/test25_ipc_registry.sh"
+"$DIR/test26_clock_snapshot.sh"
+"$DIR/test27_admission_semaphore.sh"
+"$DIR/test28_log_level.sh"
 
 echo "ALL TESTS PASSED"
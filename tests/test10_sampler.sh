@@ -0,0 +1,30 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 10: Probkowanie kolejek"
+clean_artifacts
+
+pid=$(start_director --role dyrektor --Tp 8 --Tk 9 --time-mul 2000 --one-day --sample-interval 300 --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 1)
+trap 'stop_director "$pid"' EXIT
+
+if ! wait_for_log "Zapisano probki dnia 1." 20; then
+  echo "FAIL: timeout waiting for samples"
+  exit 1
+fi
+
+samples="${SAMPLES_BASE}1.csv"
+if [[ ! -f "${SAMPLES_BASE}1.bin" ]] || ! grep -q "^czas,kolejka,wolne_miejsca,biletomaty,.*,SA_komunikaty,SA_bajty," "$samples"; then
+  echo "FAIL: missing samples header in $samples"
+  exit 1
+fi
+if [[ $(grep -c "^[0-9][0-9]:[0-9][0-9]:[0-9][0-9]," "$samples") -lt 5 ]]; then
+  echo "FAIL: too few samples in $samples"
+  exit 1
+fi
+
+stop_director "$pid"
+trap - EXIT
+
+echo "PASS: Test 10"
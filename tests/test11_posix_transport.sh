@@ -0,0 +1,24 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 11: Kolejki komunikatow POSIX"
+clean_artifacts
+
+pid=$(start_director --role dyrektor --Tp 8 --Tk 9 --time-mul 2000 --one-day --transport posix --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 1)
+trap 'stop_director "$pid"' EXIT
+
+if ! wait_for_log "Zapisano podsumowanie dnia 1." 20; then
+  echo "FAIL: timeout waiting for day summary"
+  exit 1
+fi
+
+assert_log "DYREKTOR: Config: .* transport=posix"
+assert_log "Wydano bilet nr"
+assert_summary_contains 1 csv "^1,SA,obsluzone,[1-9]"
+
+stop_director "$pid"
+trap - EXIT
+
+echo "PASS: Test 11"
@@ -0,0 +1,34 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 12: Petenci jako watki generatora"
+clean_artifacts
+
+pid=$(start_director --role dyrektor --Tp 8 --Tk 9 --time-mul 2000 --petent-host thread --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 1)
+trap 'stop_director "$pid"' EXIT
+
+if ! wait_for_log "Wydano bilet nr" 10; then
+  echo "FAIL: timeout waiting for tickets"
+  exit 1
+fi
+
+assert_log "Petenci obslugiwani jako watki generatora"
+if pgrep -f "so_projekt --role petent" >/dev/null; then
+  echo "FAIL: petent processes running in thread mode"
+  exit 1
+fi
+
+log_info "Wysylam SIGUSR2 do generatora"
+pkill -USR2 -f "so_projekt --role generator" || true
+
+if ! wait_for_log "Ewakuacja - petent opuszcza budynek." 5; then
+  echo "FAIL: timeout waiting for evacuation logs"
+  exit 1
+fi
+
+stop_director "$pid"
+trap - EXIT
+
+echo "PASS: Test 12"
@@ -0,0 +1,41 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 13: Petenci z zygoty generatora"
+clean_artifacts
+
+pid=$(start_director --role dyrektor --Tp 8 --Tk 9 --time-mul 2000 --one-day --petent-host zygote --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 1)
+trap 'stop_director "$pid"' EXIT
+
+if ! wait_for_log "Wydano bilet nr" 10; then
+  echo "FAIL: timeout waiting for tickets"
+  exit 1
+fi
+
+assert_log "Petenci tworzeni przez zygote generatora."
+assert_log "Zygota petentow gotowa."
+if pgrep -f "so_projekt --role petent" >/dev/null; then
+  echo "FAIL: petent processes exec'd in zygote mode"
+  exit 1
+fi
+
+log_info "Wysylam SIGUSR2 do generatora i petentow z zygoty"
+pkill -USR2 -f "so_projekt --role generator" || true
+
+if ! wait_for_log "Ewakuacja - petent opuszcza budynek." 5; then
+  echo "FAIL: timeout waiting for evacuation logs"
+  exit 1
+fi
+
+if ! wait_for_log "Zapisano podsumowanie dnia 1." 20; then
+  echo "FAIL: timeout waiting for day summary"
+  exit 1
+fi
+assert_summary_contains 1 txt "Start petenta od przybycia: sr\. [0-9][0-9]* us"
+
+stop_director "$pid"
+trap - EXIT
+
+echo "PASS: Test 13"
@@ -0,0 +1,38 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 14: Pracownicy bez restartu miedzy dniami"
+clean_artifacts
+
+pid=$(start_director --role dyrektor --Tp 8 --Tk 9 --time-mul 2000 --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 1)
+trap 'stop_director "$pid"' EXIT
+
+if ! wait_for_log "Zapisano podsumowanie dnia 2." 60; then
+  echo "FAIL: timeout waiting for the second day summary"
+  exit 1
+fi
+
+assert_summary_contains 2 csv "^2,SA,wydane,[1-9]"
+
+started=$(grep -c "Urzednik uruchomiony." "$LOG" || true)
+if [[ "$started" -ne 6 ]]; then
+  echo "FAIL: urzednicy started $started times, expected 6 (no daily restart)"
+  exit 1
+fi
+if [[ $(grep -c "Kasa uruchomiona." "$LOG" || true) -ne 1 ]]; then
+  echo "FAIL: kasa restarted between days"
+  exit 1
+fi
+
+stop_director "$pid"
+trap - EXIT
+
+# Day 3 has just opened, so the shutdown also evacuates a fresh burst of petents
+if ! wait_for_log "Kasa zakonczona." 30; then
+  echo "FAIL: workers did not shut down after the rollover"
+  exit 1
+fi
+
+echo "PASS: Test 14"
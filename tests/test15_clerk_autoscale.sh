@@ -0,0 +1,39 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 15: Obsada i autoskalowanie urzednikow"
+clean_artifacts
+
+pid=$(start_director --role dyrektor --Tp 8 --Tk 10 --time-mul 2000 --one-day --urzednicy SA=1 --urzednicy KM=2 --urzednicy-max SA=3 --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 1)
+trap 'stop_director "$pid"' EXIT
+
+if ! wait_for_log "Wydzial SA: 1 -> 2 urzednikow" 20; then
+  echo "FAIL: timeout waiting for the SA department to scale up"
+  exit 1
+fi
+
+assert_log "urzednicy=SC:1,KM:2,ML:1,PD:1,SA:1"
+if [[ $(grep -c "URZEDNIK(KM): Urzednik uruchomiony." "$LOG" || true) -ne 2 ]]; then
+  echo "FAIL: expected 2 KM clerks from --urzednicy KM=2"
+  exit 1
+fi
+# The autoscaler spawns the clerk right after logging the decision
+for _ in $(seq 1 50); do
+  [[ $(grep -c "URZEDNIK(SA): Urzednik uruchomiony." "$LOG" || true) -ge 2 ]] && break
+  sleep 0.1
+done
+if [[ $(grep -c "URZEDNIK(SA): Urzednik uruchomiony." "$LOG" || true) -lt 2 ]]; then
+  echo "FAIL: autoscaler did not spawn the SA clerk it logged"
+  exit 1
+fi
+if grep -q "Wydzial KM:" "$LOG"; then
+  echo "FAIL: KM scaled without --urzednicy-max"
+  exit 1
+fi
+
+stop_director "$pid"
+trap - EXIT
+
+echo "PASS: Test 15"
@@ -0,0 +1,36 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 16: Polityka skalowania biletomatow"
+clean_artifacts
+
+pid=$(start_director --role dyrektor --Tp 8 --Tk 10 --time-mul 2000 --one-day --N 12 --rejestracja-policy ewma --rejestracja-min 2 --rejestracja-max 4 --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 1)
+trap 'stop_director "$pid"' EXIT
+
+# The EWMA policy scales on predicted arrivals, so it does not need the queue itself to be long at a sample
+if ! wait_for_log "Biletomaty: 2 -> [34] (ewma:" 20; then
+  echo "FAIL: timeout waiting for the ewma policy to add ticket machines"
+  exit 1
+fi
+
+assert_log "rejestracja_policy=ewma rejestracja_min=2 rejestracja_max=4"
+# The machines follow the logged decision right away
+for _ in $(seq 1 50); do
+  [[ $(grep -c "REJESTRACJA: Rejestracja uruchomiona." "$LOG" || true) -ge 3 ]] && break
+  sleep 0.1
+done
+if [[ $(grep -c "REJESTRACJA: Rejestracja uruchomiona." "$LOG" || true) -lt 3 ]]; then
+  echo "FAIL: expected --rejestracja-min 2 machines plus the scaled-up one"
+  exit 1
+fi
+if grep -q "Biletomaty: [0-9]* -> 1 " "$LOG"; then
+  echo "FAIL: ticket machines scaled below --rejestracja-min"
+  exit 1
+fi
+
+stop_director "$pid"
+trap - EXIT
+
+echo "PASS: Test 16"
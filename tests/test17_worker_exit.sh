@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 17: Nagle zakonczenie biletomatu"
+clean_artifacts
+
+pid=$(start_director --role dyrektor --Tp 8 --Tk 16 --time-mul 2000 --one-day)
+trap 'stop_director "$pid"' EXIT
+
+if ! wait_for_log "Urzad otwarty." 10; then
+  echo "FAIL: timeout waiting for the office to open"
+  exit 1
+fi
+
+rejestracja_pid=$(pgrep -f "so_projekt --role rejestracja" | head -n 1 || true)
+if [[ -z "$rejestracja_pid" ]]; then
+  echo "FAIL: no rejestracja process found"
+  exit 1
+fi
+
+log_info "Wysylam SIGKILL do biletomatu PID: $rejestracja_pid"
+kill -KILL "$rejestracja_pid"
+
+# Dyrektor learns about the exit from the worker's pidfd, not from the day-end count
+if ! wait_for_log "Biletomat $rejestracja_pid zakonczyl dzialanie przed koncem dnia." 5; then
+  echo "FAIL: dyrektor did not notice the killed ticket machine"
+  exit 1
+fi
+for _ in $(seq 1 30); do
+  [[ $(grep -c "REJESTRACJA: Rejestracja uruchomiona." "$LOG" || true) -ge 2 ]] && break
+  sleep 0.1
+done
+if [[ $(grep -c "REJESTRACJA: Rejestracja uruchomiona." "$LOG" || true) -lt 2 ]]; then
+  echo "FAIL: the killed ticket machine was not replaced"
+  exit 1
+fi
+
+stop_director "$pid"
+trap - EXIT
+
+echo "PASS: Test 17"
@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 18: Przypisanie procesorow i klasa czasu rzeczywistego"
+clean_artifacts
+
+pid=$(start_director --role dyrektor --Tp 8 --Tk 16 --time-mul 2000 --one-day --cpus rejestracja=0 --cpus urzednik=0 --cpus kasa=0 --realtime fifo --realtime-priority 5)
+trap 'stop_director "$pid"' EXIT
+
+if ! wait_for_log "REJESTRACJA: Rejestracja uruchomiona." 10; then
+  echo "FAIL: timeout waiting for rejestracja"
+  exit 1
+fi
+
+assert_log "cpus=rejestracja:0,kasa:0,SC:0,KM:0,ML:0,PD:0,SA:0 realtime=fifo realtime_priority=5"
+
+for role in rejestracja kasa "urzednik --dept SA"; do
+  role_pid=$(pgrep -f "so_projekt --role $role" | head -n 1 || true)
+  if [[ -z "$role_pid" ]]; then
+    echo "FAIL: no $role process found"
+    exit 1
+  fi
+  cpus=$(awk '/Cpus_allowed_list/ {print $2}' "/proc/$role_pid/status")
+  if [[ "$cpus" != "0" ]]; then
+    echo "FAIL: $role runs on CPUs $cpus instead of 0"
+    exit 1
+  fi
+done
+
+# SCHED_FIFO is 1 in /proc/<pid>/stat; without the privilege dyrektor must say it fell back instead
+rejestracja_pid=$(pgrep -f "so_projekt --role rejestracja" | head -n 1)
+policy=$(awk '{print $41}' "/proc/$rejestracja_pid/stat")
+if [[ "$policy" != "1" ]] && ! grep -q "Brak uprawnien do klasy fifo" "$LOG"; then
+  echo "FAIL: rejestracja is not SCHED_FIFO and no fallback was logged"
+  exit 1
+fi
+
+stop_director "$pid"
+trap - EXIT
+
+echo "PASS: Test 18"
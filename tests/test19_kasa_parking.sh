@@ -0,0 +1,48 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 19: Urzednik obsluguje kolejke, gdy petent jest w kasie"
+clean_artifacts
+
+pid=$(start_director --role dyrektor --Tp 8 --Tk 16 --time-mul 2000 --one-day --gen-from-dyrektor --gen-min-delay 20 --gen-max-delay 60)
+trap 'stop_director "$pid"' EXIT
+
+# Prints the petents back from the kasa whose department served someone else while they were away; any clerk of
+# the department may take the return
+served_meanwhile() {
+  awk '
+    match($0, / URZEDNIK\([A-Z]+\)/) { dept = substr($0, RSTART, RLENGTH) }
+    !/ URZEDNIK\(/ { next }
+    /skierowany do kasy/ { away[dept, $(NF - 3)] = 1; busy[dept, $(NF - 3)] = 0 }
+    /Rozpoczecie obslugi/ { for (key in away) { split(key, k, SUBSEP); if (k[1] == dept) busy[key] = 1 } }
+    /wrocil z kasy/ { key = dept SUBSEP $(NF - 3); if (busy[key]) print $(NF - 3); delete away[key] }
+  ' "$LOG"
+}
+
+for _ in $(seq 1 60); do
+  [[ -n "$(served_meanwhile)" ]] && break
+  sleep 0.5
+done
+if [[ -z "$(served_meanwhile)" ]]; then
+  echo "FAIL: no clerk served another petent while one was at the kasa"
+  dump_log_tail
+  exit 1
+fi
+petent=$(served_meanwhile | head -n 1)
+log_info "Petent $petent wrocil z kasy do wydzialu, ktory w tym czasie obslugiwal innych"
+
+if ! wait_for_log "Zakonczono obsluge petenta \(VIP \)\?$petent\." 5; then
+  echo "FAIL: the returned petent was not finished"
+  exit 1
+fi
+if grep -q "Blad powiadomienia urzednika o powrocie z kasy" "$LOG"; then
+  echo "FAIL: a petent could not return from the kasa"
+  exit 1
+fi
+
+stop_director "$pid"
+trap - EXIT
+
+echo "PASS: Test 19"
@@ -0,0 +1,38 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 20: Okienka kasy i ich autoskalowanie"
+clean_artifacts
+
+pid=$(start_director --role dyrektor --Tp 8 --Tk 10 --time-mul 2000 --one-day --urzednicy 12 --kasy 2 --kasy-max 3 --gen-from-dyrektor --gen-min-delay 2 --gen-max-delay 6)
+trap 'stop_director "$pid"' EXIT
+
+if ! wait_for_log "Okienko kasy 2 otwarte." 10; then
+  echo "FAIL: the second kasa window did not open"
+  exit 1
+fi
+assert_log "kasy=2 kasy_max=3"
+
+if ! wait_for_log "Kasy: 2 -> 3" 30; then
+  echo "FAIL: kasa windows did not scale up with the payment queue"
+  dump_log_tail
+  exit 1
+fi
+
+if ! wait_for_log "Zapisano podsumowanie dnia 1." 30; then
+  echo "FAIL: timeout waiting for the day summary"
+  exit 1
+fi
+for window in 1 2 3; do
+  assert_summary_contains 1 csv "^1,KASA$window,platnosci,[1-9]"
+  assert_summary_contains 1 csv "^1,KASA$window,zajetosc_proc,[0-9]"
+done
+assert_summary_contains 1 csv "^1,RAZEM,max_kasy,3$"
+assert_summary_contains 1 txt "^Okienko kasy 3: "
+
+stop_director "$pid"
+trap - EXIT
+
+echo "PASS: Test 20"
@@ -0,0 +1,48 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 21: Symulacja zdarzeniowa w czasie wirtualnym"
+clean_artifacts
+
+args=(--role dyrektor --des --des-days 30 --des-seed 42 --kasy 1 --kasy-max 3 --gen-min-delay 5 --gen-max-delay 15)
+pid=$(start_director "${args[@]}")
+trap 'stop_director "$pid"' EXIT
+
+# Thirty full days (Tp 8 - Tk 16) with no sleeping anywhere
+if ! wait_for_log "Symulacja zdarzeniowa zakonczona: dni 30" 10; then
+  echo "FAIL: the discrete-event run did not finish 30 days in time"
+  exit 1
+fi
+assert_log "des=1 des_days=30"
+assert_log "Zapisano podsumowanie dnia 30."
+
+for day in 1 30; do
+  assert_summary_contains "$day" csv "^$day,SA,wydane,[1-9]"
+  assert_summary_contains "$day" csv "^$day,SA,obsluzone,[1-9]"
+  assert_summary_contains "$day" csv "^$day,KASA1,platnosci,[1-9]"
+done
+assert_log "Kasy: 1 -> 2"
+if [[ ! -s "${REPORT_BASE}30.txt" ]]; then
+  echo "FAIL: no unserved petents reported for day 30"
+  exit 1
+fi
+
+# The same seed gives the same days
+cp "${SUMMARY_BASE}30.csv" /tmp/so_projekt_des_first.csv
+: > "$LOG"
+pid=$(start_director "${args[@]}")
+if ! wait_for_log "Symulacja zdarzeniowa zakonczona: dni 30" 10; then
+  echo "FAIL: the second discrete-event run did not finish"
+  exit 1
+fi
+if ! diff -q /tmp/so_projekt_des_first.csv "${SUMMARY_BASE}30.csv" >/dev/null; then
+  echo "FAIL: the same seed produced a different day 30"
+  exit 1
+fi
+rm -f /tmp/so_projekt_des_first.csv
+
+trap - EXIT
+
+echo "PASS: Test 21"
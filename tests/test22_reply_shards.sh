@@ -0,0 +1,42 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 22: Odpowiedzi w wielu shardach i kubelkach skrzynek"
+clean_artifacts
+
+pid=$(start_director --role dyrektor --Tp 8 --Tk 10 --time-mul 2000 --one-day --transport shm --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 1)
+trap 'stop_director "$pid"' EXIT
+
+if ! wait_for_log "Zapisano podsumowanie dnia 1." 30; then
+  echo "FAIL: timeout waiting for day summary"
+  exit 1
+fi
+
+# Shard as chosen by the petent (its debug line), bucket = pid % 64 as in shmq::bucket_for(); only petents whose
+# ticket came back through that shard count
+served=$(grep "PETENT: Petent zglosil sie do urzednika z biletem" "$LOG" | sed 's/.*\[PID:\([0-9]*\)\].*/\1/' | sort -u)
+usage=$(grep "czeka na odpowiedzi w shardzie" "$LOG" | sed 's/.*Petent \([0-9]*\) czeka na odpowiedzi w shardzie \([0-9]*\)\..*/\1 \2/' |
+  awk 'NR == FNR { served[$1] = 1; next }
+       ($1 in served) { used[$2, $1 % 64] = 1 }
+       END { for (key in used) { split(key, k, SUBSEP); buckets[k[1]]++ }
+             for (shard = 0; shard < 4; shard++) print shard, buckets[shard] + 0 }' <(echo "$served") -)
+log_info "Shard / uzyte kubelki: $(echo $usage)"
+
+shards_used=$(awk '$2 > 0' <<< "$usage" | wc -l)
+widest=$(awk '$2 > max { max = $2 } END { print max + 0 }' <<< "$usage")
+if (( shards_used < 2 )); then
+  echo "FAIL: replies went through $shards_used shard(s) only"
+  exit 1
+fi
+# With shard = pid % 4 no shard could reach more than 16 of the 64 buckets
+if (( widest <= 16 )); then
+  echo "FAIL: no shard used more than $widest mailbox buckets"
+  exit 1
+fi
+
+stop_director "$pid"
+trap - EXIT
+
+echo "PASS: Test 22"
@@ -0,0 +1,42 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 23: Sygnaly zakonczenia w paczkach rejestracji"
+
+# At shutdown dyrektor queues one sentinel per ticket machine before waking them; a machine that takes several in one
+# batch must put the others back, so every machine still stops exactly once
+for transport in sysv shm; do
+  clean_artifacts
+  pid=$(start_director --role dyrektor --Tp 8 --Tk 9 --time-mul 2000 --one-day --transport "$transport" --rejestracja-min 4 --rejestracja-max 4 --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 1)
+  trap 'stop_director "$pid"' EXIT
+
+  if ! wait_for_log "DYREKTOR: Koniec dzialania procesu." 30; then
+    echo "FAIL: timeout waiting for dyrektor to shut down ($transport)"
+    exit 1
+  fi
+  trap - EXIT
+
+  started=$(grep -c "REJESTRACJA: Rejestracja uruchomiona." "$LOG" || true)
+  stopped=$(grep -c "REJESTRACJA: Otrzymano sygnal zakonczenia." "$LOG" || true)
+  finished=$(grep -c "REJESTRACJA: Rejestracja zakonczona." "$LOG" || true)
+  returned=$(awk '/REJESTRACJA: Zwrocono do kolejki/ { sum += $(NF - 2) } END { print sum + 0 }' "$LOG")
+  log_info "$transport: biletomaty $started, zakonczenia $stopped/$finished, zwrocone sygnaly ${returned:-0}"
+  if [[ "$started" -ne 4 ]]; then
+    echo "FAIL: expected 4 ticket machines, got $started ($transport)"
+    exit 1
+  fi
+  if [[ "$stopped" -ne "$started" || "$finished" -ne "$started" ]]; then
+    echo "FAIL: $started machines but $stopped sentinels taken and $finished exits ($transport)"
+    exit 1
+  fi
+  # The sentinels are queued before the machines wake, so the first one takes several at once
+  if [[ "$returned" -eq 0 ]]; then
+    echo "FAIL: no batch held another machine's sentinel ($transport)"
+    exit 1
+  fi
+  assert_log "Wydano bilet nr"
+done
+
+echo "PASS: Test 23"
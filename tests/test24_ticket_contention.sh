@@ -0,0 +1,67 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 24: Przydzial biletow przy wspolbieznosci"
+clean_artifacts
+
+# Four ticket machines and four SA clerks (redirects) take numbers from the same counters until the limits are hit
+pid=$(start_director --role dyrektor --Tp 8 --Tk 9 --time-mul 2000 --one-day --X1 20 --X2 10 --X3 10 --X4 10 --X5 10 --urzednicy SA=4 --rejestracja-min 4 --rejestracja-max 4 --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 0)
+trap 'stop_director "$pid"' EXIT
+
+if ! wait_for_log "Zapisano podsumowanie dnia 1." 60; then
+  echo "FAIL: timeout waiting for the day summary"
+  exit 1
+fi
+
+summary="${SUMMARY_BASE}1.csv"
+metric() {
+  awk -F, -v dept="$1" -v name="$2" '$2 == dept && $3 == name { print $4 }' "$summary"
+}
+
+# A department that turned anyone away must have issued exactly its limit, never more; demand for one department
+# can stay below the limit, but at least one has to be contended
+issued_total=0
+redirected_total=0
+limited=0
+for dept in SA SC KM ML PD; do
+  limit=$(metric "$dept" limit)
+  issued=$(metric "$dept" wydane)
+  rejected=$(metric "$dept" odrzucone_limit)
+  if [[ "$issued" -gt "$limit" || ( "$rejected" -gt 0 && "$issued" -ne "$limit" ) ]]; then
+    echo "FAIL: $dept issued $issued of $limit tickets with $rejected rejections; the limit must be reached exactly"
+    exit 1
+  fi
+  if [[ "$rejected" -gt 0 ]]; then
+    limited=$((limited + 1))
+  fi
+  issued_total=$((issued_total + issued))
+  redirected_total=$((redirected_total + $(metric "$dept" przekierowane_z_sa)))
+done
+
+if [[ "$limited" -eq 0 ]]; then
+  echo "FAIL: no department reached its ticket limit"
+  exit 1
+fi
+
+# Every number taken from a counter was handed out once: by a ticket machine or with an SA redirect
+handed_out=$(grep -c "REJESTRACJA: Wydano bilet nr" "$LOG" || true)
+log_info "Wydane z licznikow: $issued_total, biletomaty: $handed_out, przekierowania: $redirected_total"
+if [[ $((handed_out + redirected_total)) -ne "$issued_total" ]]; then
+  echo "FAIL: counters advanced $issued_total times but $((handed_out + redirected_total)) tickets were handed out"
+  exit 1
+fi
+
+# No department serves the same ticket number twice
+duplicates=$(sed -n 's/.*URZEDNIK(\([A-Z]*\)): Rozpoczecie obslugi petenta.* (bilet \([0-9]*\))\./\1 \2/p' "$LOG" |
+  sort | uniq -d | head -5)
+if [[ -n "$duplicates" ]]; then
+  echo "FAIL: ticket numbers served twice: $duplicates"
+  exit 1
+fi
+
+stop_director "$pid"
+trap - EXIT
+
+echo "PASS: Test 24"
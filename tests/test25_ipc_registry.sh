@@ -0,0 +1,75 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 25: Rejestr identyfikatorow IPC w pamieci wspolnej"
+
+lock_file="/tmp/so_projekt_ipc.lock"
+moved_lock="${lock_file}.test25"
+
+for transport in sysv shm; do
+  clean_artifacts
+  rm -f "$moved_lock"
+  pid=$(start_director --role dyrektor --Tp 8 --Tk 12 --time-mul 1000 --one-day --transport "$transport" --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 1)
+  trap 'stop_director "$pid"; rm -f "$moved_lock"' EXIT
+
+  if ! wait_for_log "DYREKTOR: Dzien 1: Urzad otwarty." 10; then
+    echo "FAIL: office did not open ($transport)"
+    exit 1
+  fi
+
+  # Spawned roles get only the role (and a clerk its department, a kasa its window) in argv; the rest is in SharedState
+  checked=0
+  for child in $(pgrep -P "$pid" || true); do
+    args=$(tr '\0' ' ' < "/proc/$child/cmdline" 2>/dev/null || true)
+    case "$args" in
+      *" --role rejestracja "|*" --role generator "|*" --role kasa --window "[0-9]" "|*" --role urzednik --dept "[A-Z][A-Z]" ")
+        checked=$((checked + 1))
+        ;;
+      *" --role "*)
+        echo "FAIL: worker started with extra arguments: $args"
+        exit 1
+        ;;
+    esac
+  done
+  if [[ "$checked" -eq 0 ]]; then
+    echo "FAIL: no running workers found ($transport)"
+    exit 1
+  fi
+  log_info "Sprawdzono argumenty $checked procesow"
+
+  # The ftok() keys of the running simulation come from the inode of the lock file. With the old file moved aside
+  # and a new one in its place every ftok() lookup misses, so petents born from now on can reach the state, the
+  # semaphores and the queues only through the registry published by dyrektor
+  mv "$lock_file" "$moved_lock"
+  touch "$lock_file"
+  log_info "Podmieniono plik blokady IPC"
+  # Requests already on their way are answered either way; only what comes after them shows new petents at work
+  sleep 2
+  swap_line=$(wc -l < "$LOG")
+
+  if ! wait_for_log "Zapisano podsumowanie dnia 1." 60; then
+    echo "FAIL: timeout waiting for the day summary ($transport)"
+    exit 1
+  fi
+
+  after_swap=$(tail -n +"$((swap_line + 1))" "$LOG")
+  answered=$(grep -c "REJESTRACJA: Wydano bilet nr\|REJESTRACJA: .*bilet nie zostal wydany" <<< "$after_swap" || true)
+  log_info "Prosby o bilet obsluzone po podmianie ($transport): $answered"
+  if [[ "$answered" -lt 20 ]]; then
+    echo "FAIL: petents started after the lock file swap did not reach the ticket machines ($transport)"
+    exit 1
+  fi
+  if grep -q "Nie znaleziono kolejki" <<< "$after_swap"; then
+    echo "FAIL: a queue lookup failed after the lock file swap ($transport)"
+    exit 1
+  fi
+
+  stop_director "$pid"
+  wait_for_log "DYREKTOR: Koniec dzialania procesu." 30 || true
+  rm -f "$moved_lock"
+  trap - EXIT
+done
+
+echo "PASS: Test 25"
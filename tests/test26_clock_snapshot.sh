@@ -0,0 +1,67 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 26: Spojny odczyt zegara symulacji"
+clean_artifacts
+
+# The sampler thread polls SharedState::snapshot() and opens each day's file at the first snapshot of the new day;
+# day, time and office status come from one seqlock read, so a day never starts with the previous evening's time
+interval=300
+pid=$(start_director --role dyrektor --Tp 8 --Tk 9 --time-mul 2000 --sample-interval "$interval" --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 1)
+trap 'stop_director "$pid"' EXIT
+
+if ! wait_for_log "Zapisano probki dnia 3." 60; then
+  echo "FAIL: timeout waiting for three days of samples"
+  exit 1
+fi
+stop_director "$pid"
+wait_for_log "DYREKTOR: Koniec dzialania procesu." 30 || true
+trap - EXIT
+
+open_sec=$((8 * 3600))
+close_sec=$((9 * 3600))
+for day in 1 2 3; do
+  samples="${SAMPLES_BASE}${day}.csv"
+  if [[ ! -f "$samples" ]]; then
+    echo "FAIL: missing $samples"
+    exit 1
+  fi
+  # Prints "count first last" or the first problem found
+  result=$(awk -F, -v open="$open_sec" -v closing="$close_sec" -v interval="$interval" '
+    /^[0-9][0-9]:[0-9][0-9]:[0-9][0-9],/ {
+      split($1, hms, ":")
+      t = hms[1] * 3600 + hms[2] * 60 + hms[3]
+      if (count == 0) {
+        first = t
+      }
+      else if (t < last) {
+        print "time goes back from " last " to " t
+        exit
+      }
+      if (t < open || t > closing + interval) {
+        print "time " t " outside the office day"
+        exit
+      }
+      last = t
+      count++
+    }
+    END { if (count > 0) print count, first, last }' "$samples")
+  read -r count first last <<< "$result"
+  if [[ ! "$count" =~ ^[0-9]+$ ]]; then
+    echo "FAIL: day $day samples: $result"
+    exit 1
+  fi
+  log_info "Dzien $day: $count probek od $first do $last s"
+  if [[ "$count" -lt 5 ]]; then
+    echo "FAIL: too few samples for day $day"
+    exit 1
+  fi
+  if [[ "$first" -ge $((open_sec + interval)) ]]; then
+    echo "FAIL: day $day samples start at $first s, not at the opening"
+    exit 1
+  fi
+done
+
+echo "PASS: Test 26"
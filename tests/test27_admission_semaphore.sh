@@ -0,0 +1,64 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 27: Wpuszczanie do budynku przez semafor futex"
+clean_artifacts
+
+# N=4 leaves 3 places in the building; a petent with a child takes two of them in one acquire
+capacity=4
+places=$((capacity - 1))
+pid=$(start_director --role dyrektor --Tp 8 --Tk 9 --time-mul 2000 --one-day --N "$capacity" --sample-interval 60 --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 1)
+trap 'stop_director "$pid"' EXIT
+
+if ! wait_for_log "Zapisano probki dnia 1." 30; then
+  echo "FAIL: timeout waiting for samples"
+  exit 1
+fi
+
+samples="${SAMPLES_BASE}1.csv"
+# Prints "count full max_free min_free max_queue" over the kolejka and wolne_miejsca columns
+read -r count full max_free min_free max_queue < <(awk -F, '
+  /^[0-9][0-9]:[0-9][0-9]:[0-9][0-9],/ {
+    if (count == 0 || $3 < min_free) min_free = $3
+    if (count == 0 || $3 > max_free) max_free = $3
+    if ($2 > max_queue) max_queue = $2
+    if ($3 == 0) full++
+    count++
+  }
+  END { print count + 0, full + 0, max_free + 0, min_free + 0, max_queue + 0 }' "$samples")
+log_info "Probki: $count, pelny budynek: $full, wolne miejsca $min_free..$max_free, kolejka do $max_queue"
+
+if [[ "$count" -lt 5 ]]; then
+  echo "FAIL: too few samples in $samples"
+  exit 1
+fi
+if [[ "$min_free" -lt 0 || "$max_free" -gt "$places" ]]; then
+  echo "FAIL: free places $min_free..$max_free outside 0..$places"
+  exit 1
+fi
+if [[ "$max_queue" -gt "$places" ]]; then
+  echo "FAIL: $max_queue petents waited for a ticket in a building with $places places"
+  exit 1
+fi
+if [[ "$full" -eq 0 ]]; then
+  echo "FAIL: the building never filled up; admission was not contended"
+  exit 1
+fi
+
+with_child=$(grep -c "Petent wchodzi do urzedu z dzieckiem." "$LOG" || true)
+if [[ "$with_child" -eq 0 ]]; then
+  echo "FAIL: no petent with a child was admitted"
+  exit 1
+fi
+if grep -q "Blad oczekiwania na miejsce w kolejce." "$LOG"; then
+  echo "FAIL: an admission wait failed"
+  exit 1
+fi
+assert_log "Wydano bilet nr"
+
+stop_director "$pid"
+trap - EXIT
+
+echo "PASS: Test 27"
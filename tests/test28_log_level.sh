@@ -0,0 +1,32 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 28: Filtrowanie logow wedlug poziomu i roli"
+clean_artifacts
+
+# Petents log only from Notice up; every other role keeps the default level
+pid=$(start_director --role dyrektor --Tp 8 --Tk 9 --time-mul 2000 --one-day --log-level petent=notice --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 1)
+trap 'stop_director "$pid"' EXIT
+
+if ! wait_for_log "Zapisano podsumowanie dnia 1." 30; then
+  echo "FAIL: timeout waiting for the day summary"
+  exit 1
+fi
+
+filtered=$(grep -c "\] \(INFO\|DEBUG\) PETENT:" "$LOG" || true)
+if [[ "$filtered" -ne 0 ]]; then
+  echo "FAIL: $filtered Info/Debug lines from petents despite --log-level petent=notice"
+  grep -m 3 "\] \(INFO\|DEBUG\) PETENT:" "$LOG"
+  exit 1
+fi
+assert_log "\] NOTICE PETENT:"
+# Other roles are not affected by the petent filter
+assert_log "\] INFO REJESTRACJA: Wydano bilet nr"
+assert_log "\] INFO URZEDNIK([A-Z]*): Rozpoczecie obslugi petenta"
+
+stop_director "$pid"
+trap - EXIT
+
+echo "PASS: Test 28"
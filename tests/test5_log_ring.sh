@@ -0,0 +1,42 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 5: Bufor logow w pamieci wspoldzielonej"
+clean_artifacts
+
+pid=$(start_director --role dyrektor --Tp 8 --Tk 9 --time-mul 2000 --log-ring --log-ring-full drop --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 1)
+trap 'stop_director "$pid"' EXIT
+
+if ! wait_for_log "Koniec dnia." 20; then
+  echo "FAIL: timeout waiting for end of day"
+  exit 1
+fi
+
+assert_log "Dzien 1: Urzad otwarty."
+assert_log "Wydano bilet nr"
+assert_log "REJESTRACJA: Rejestracja uruchomiona."
+
+stop_director "$pid"
+trap - EXIT
+
+# The flusher reports how many records went through the ring; nearly every line must have
+if ! wait_for_log "Bufor logow: przekazano" 20; then
+  echo "FAIL: timeout waiting for log ring summary"
+  exit 1
+fi
+summary=$(grep -m1 "Bufor logow: przekazano" "$LOG")
+passed=$(echo "$summary" | sed -n 's/.*przekazano \([0-9]*\) wpisow.*/\1/p')
+dropped=$(echo "$summary" | sed -n 's/.*pominieto \([0-9]*\)\..*/\1/p')
+lines=$(wc -l < "$LOG")
+log_info "Bufor logow: przekazano $passed, pominieto $dropped, linii w logu $lines"
+if (( passed == 0 || lines - passed > 20 )); then
+  echo "FAIL: log lines bypassed the ring ($passed of $lines)"
+  exit 1
+fi
+if (( dropped > 0 )); then
+  assert_log "Pominieto [0-9]* wpisow dziennika"
+fi
+
+echo "PASS: Test 5"
@@ -0,0 +1,39 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 6: Binarny format logu i dekoder logdump"
+clean_artifacts
+
+WORK_DIR=$(mktemp -d)
+BIN_LOG="$WORK_DIR/so_projekt.bin"
+DUMP="$WORK_DIR/dump.txt"
+
+pid=$(cd "$WORK_DIR" && start_director --role dyrektor --Tp 8 --Tk 9 --time-mul 2000 --one-day --log-format binary --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 1)
+trap 'stop_director "$pid"; rm -rf "$WORK_DIR"' EXIT
+
+for _ in $(seq 1 200); do
+  kill -0 "$pid" 2>/dev/null || break
+  sleep 0.1
+done
+
+stop_director "$pid"
+
+if [[ ! -s "$BIN_LOG" ]]; then
+  echo "FAIL: missing binary log: $BIN_LOG"
+  exit 1
+fi
+
+"$BIN" --role logdump --log-in "$BIN_LOG" >"$DUMP"
+cp "$DUMP" "$LOG"
+
+assert_log "DYREKTOR: Dzien 1: Urzad otwarty."
+assert_log "REJESTRACJA: Wydano bilet nr"
+assert_log "Rozpoczecie obslugi petenta"
+assert_log "Koniec dnia."
+
+trap - EXIT
+rm -rf "$WORK_DIR"
+
+echo "PASS: Test 6"
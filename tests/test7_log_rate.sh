@@ -0,0 +1,25 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 7: Limitowanie i probkowanie logow"
+clean_artifacts
+
+pid=$(start_director --role dyrektor --Tp 8 --Tk 9 --time-mul 2000 --log-rate rejestracja=5 --log-sample petent=10 --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 1)
+trap 'stop_director "$pid"' EXIT
+
+if ! wait_for_log "Koniec dnia." 20; then
+  echo "FAIL: timeout waiting for end of day"
+  exit 1
+fi
+
+assert_log "Dzien 1: Urzad otwarty."
+assert_log "Wydano bilet nr"
+assert_log "REJESTRACJA: Pominieto [0-9]* podobnych wpisow: \"Wydano bilet nr {} do wydzialu.\""
+assert_log "PETENT: Pominieto [0-9]* podobnych wpisow"
+
+stop_director "$pid"
+trap - EXIT
+
+echo "PASS: Test 7"
@@ -0,0 +1,27 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+source "$(dirname "$0")/lib.sh"
+
+log_info "TEST 8: Podsumowanie dnia"
+clean_artifacts
+
+pid=$(start_director --role dyrektor --Tp 8 --Tk 9 --time-mul 2000 --one-day --gen-from-dyrektor --gen-min-delay 0 --gen-max-delay 1)
+trap 'stop_director "$pid"' EXIT
+
+if ! wait_for_log "Zapisano podsumowanie dnia 1." 20; then
+  echo "FAIL: timeout waiting for day summary"
+  exit 1
+fi
+
+assert_summary_contains 1 csv "^dzien,wydzial,metryka,wartosc$"
+assert_summary_contains 1 csv "^1,SA,wydane,[1-9]"
+assert_summary_contains 1 json "\"SA\": {\"limit\": 4000, \"issued\": [1-9]"
+assert_summary_contains 1 json "\"peak_queue_length\": [1-9]"
+assert_summary_contains 1 txt "Podsumowanie dnia 1"
+assert_summary_contains 1 txt "^RAZEM"
+
+stop_director "$pid"
+trap - EXIT
+
+echo "PASS: Test 8"
@@ -7,17 +7,26 @@
 #include <sys/msg.h>
 #include <thread>
 #include <unistd.h>
+#include "../dayshift.h"
 #include "../ipcutils.h"
 #include "../logger.h"
 #include "../report.h"
 
 constexpr long kPriorityMsgType = -kNormalQueueType; // negative = dequeue lowest mtype first
+constexpr long kServiceMsgType = -kKasaReturnQueueType; // tickets (VIP first), then petents back from the kasa
+constexpr size_t kDrainBatch = 64; // tickets taken per receive when draining the queue on SIGUSR1
 static volatile sig_atomic_t urzednik_running = 1;
 static volatile sig_atomic_t stop_after_current = 0;
+static volatile sig_atomic_t retired = 0;
 
 static void handle_shutdown_signal(int) { urzednik_running = 0; }
 
-static void handle_finish_signal(int) { stop_after_current = 1; }
+static void handle_finish_signal(int, siginfo_t* info, void*) {
+    if (info && info->si_code == SI_QUEUE && info->si_value.sival_int == kRetireClerkSignalValue) {
+        retired = 1;
+    }
+    stop_after_current = 1;
+}
 
 static void short_work_delay(int time_mul) {
     int delay_minutes = rng::random_int(5, 30);
@@ -40,8 +49,9 @@ static uint32_t resolve_report_day(const SharedState* shared_state) {
     if (!shared_state) {
         return 1;
     }
-    uint32_t day = shared_state->day;
-    if (shared_state->office_status == OfficeStatus::Open) {
+    StateSnapshot state = shared_state->snapshot();
+    uint32_t day = state.day;
+    if (state.office_status == OfficeStatus::Open) {
         day += 1;
     }
     if (day == 0) {
@@ -50,39 +60,121 @@ static uint32_t resolve_report_day(const SharedState* shared_state) {
     return day;
 }
 
+// Moves the tickets still queued for this clerk to the day report as unserved; done when the clerk stops after
+// SIGUSR1 and at every day end
+static void drain_unserved(SharedState* shared_state, UrzednikRole role, int msg_id) {
+    bool logged_unserved = false;
+    report::Writer report_writer(resolve_report_day(shared_state));
+    TicketIssuedMsg tickets[kDrainBatch];
+    while (true) {
+        int received = ipc::msg::receive_batch<TicketIssuedMsg>(msg_id, kPriorityMsgType, tickets, kDrainBatch,
+                                                                IPC_NOWAIT);
+        if (received == -1) {
+            if (errno == ENOMSG) {
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            std::string error = "Blad odczytu kolejki podczas konczenia pracy: " +
+                                std::string(std::strerror(errno));
+            Logger::log(LogSeverity::Err, Identity::Urzednik, role, error);
+            break;
+        }
+
+        for (int i = 0; i < received; ++i) {
+            const TicketIssuedMsg& ticket = tickets[i];
+            if (ticket.petent_id == 0) {
+                continue;
+            }
+
+            std::string_view issuer = ticket.redirected_from_sa ? "SA" : "REJESTRACJA";
+            report_writer.unserved_after_signal(ticket.petent_id, ticket.department, issuer);
+            DayStats::bump(shared_state->stats.unserved, ticket.department);
+            Logger::log<LogSeverity::Notice>(Identity::Urzednik, role, [&] {
+                return "skierowanie do " +
+                       std::string(urzednik_role_to_string(ticket.department).value_or("?")) + " - wystawil " +
+                       std::string(issuer) + " - petent " + std::to_string(ticket.petent_id);
+            });
+            logged_unserved = true;
+        }
+    }
+    report_writer.flush();
+
+    if (!logged_unserved) {
+        Logger::log<LogSeverity::Notice>(Identity::Urzednik, role,
+                                         "Brak nieobsluzonych petentow w kolejce przy zakonczeniu pracy.");
+    }
+}
+
 int urzednik_main(UrzednikRole role) {
     ipc::install_signal_handler(SIGTERM, handle_shutdown_signal);
-    ipc::install_signal_handler(SIGUSR1, handle_finish_signal);
+    ipc::install_signal_info_handler(SIGUSR1, handle_finish_signal);
+    dayshift::install_day_end_handler();
     signal(SIGINT, SIG_IGN);
     signal(SIGUSR2, SIG_IGN);
 
-    Logger::log(LogSeverity::Info, Identity::Urzednik, role, "Urzednik uruchomiony.");
+    Logger::log<LogSeverity::Info>(Identity::Urzednik, role, "Urzednik uruchomiony.");
 
     auto shared_state = ipc::helper::get_shared_state(false);
     if (!shared_state) {
         return 1;
     }
 
-    int sem_id = ipc::helper::get_semaphore_set(2);
-    if (sem_id == -1) {
-        ipc::shm::detach(shared_state);
-        return 1;
-    }
-
     int msg_id = ipc::helper::get_role_queue(role);
     if (msg_id == -1) {
         ipc::shm::detach(shared_state);
         return 1;
     }
 
-    int msg_req_id = ipc::helper::get_msg_queue(ipc::KeyType::MsgQueueRejestracja);
-    if (msg_req_id == -1) {
-        Logger::log(LogSeverity::Err, Identity::Urzednik, role, "Nie znaleziono kolejki rejestracji.");
+    bool replies_available = true;
+    for (size_t shard = 0; shard < kReplyShardCount; ++shard) {
+        if (ipc::helper::get_reply_queue(shard) == -1) {
+            replies_available = false;
+        }
     }
+    if (!replies_available) {
+        Logger::log(LogSeverity::Err, Identity::Urzednik, role, "Nie znaleziono kolejek odpowiedzi dla petentow.");
+    }
+
+    dayshift::Shift shift(shared_state);
+    auto should_stop = [] { return !urzednik_running || stop_after_current; };
+
+    auto finish_service = [&](const TicketIssuedMsg& ticket) {
+        DayStats::bump(shared_state->stats.served, role);
+        Logger::event<LogSeverity::Info>(Identity::Urzednik, role,
+                                         ticket.is_vip ? LogEvent::ServiceFinishedVip : LogEvent::ServiceFinished,
+                                         ticket.petent_id);
+
+        if (replies_available) {
+            ServiceDoneMsg done{};
+            done.petent_id = ticket.petent_id;
+            done.department = role;
+            done.action = ServiceAction::Complete;
+            // Use IPC_NOWAIT when shutting down to avoid blocking on a full queue
+            int send_flags = stop_after_current ? IPC_NOWAIT : 0;
+            if (ipc::helper::send_reply<ServiceDoneMsg>(ticket.petent_id, done, send_flags) == -1) {
+                Logger::log(LogSeverity::Err, Identity::Urzednik, role,
+                            "Blad wyslania potwierdzenia obslugi petenta.");
+            }
+        }
+    };
 
     while (urzednik_running) {
+        if (shift.day_ended()) {
+            drain_unserved(shared_state, role, msg_id);
+            if (!shift.finish_day(should_stop)) {
+                break;
+            }
+            continue;
+        }
+
+        // A petent back from the kasa goes before the next ticket; otherwise one blocking receive waits for both
         TicketIssuedMsg ticket{};
-        int rc = ipc::msg::receive<TicketIssuedMsg>(msg_id, kPriorityMsgType, &ticket, 0);
+        int rc = ipc::msg::receive<TicketIssuedMsg>(msg_id, kKasaReturnQueueType, &ticket, IPC_NOWAIT);
+        if (rc == -1 && errno == ENOMSG) {
+            rc = ipc::msg::receive<TicketIssuedMsg>(msg_id, kServiceMsgType, &ticket, 0);
+        }
         if (rc == -1) {
             if (errno == EINTR) {
                 if (!urzednik_running || stop_after_current) {
@@ -96,58 +188,46 @@ int urzednik_main(UrzednikRole role) {
         }
 
         if (ticket.petent_id == 0) {
-            Logger::log(LogSeverity::Notice, Identity::Urzednik, role, "Otrzymano sygnal zakonczenia.");
+            Logger::log<LogSeverity::Notice>(Identity::Urzednik, role, "Otrzymano sygnal zakonczenia.");
             break;
         }
 
-        if (ticket.is_vip) {
-            Logger::log(LogSeverity::Info, Identity::Urzednik, role,
-                        "Rozpoczecie obslugi petenta VIP " + std::to_string(ticket.petent_id) + " (bilet " +
-                            std::to_string(ticket.ticket_number) + ").");
-        } else {
-            Logger::log(LogSeverity::Info, Identity::Urzednik, role,
-                        "Rozpoczecie obslugi petenta " + std::to_string(ticket.petent_id) + " (bilet " +
-                            std::to_string(ticket.ticket_number) + ").");
+        // Any clerk of the department resumes a returning petent; one dyrektor has already released is dropped
+        if (ticket.from_kasa) {
+            if (shared_state->unpark(role, ticket.petent_id)) {
+                Logger::event<LogSeverity::Info>(Identity::Urzednik, role, LogEvent::ReturnedFromKasa,
+                                                 ticket.petent_id);
+                finish_service(ticket);
+            }
+            if (stop_after_current) {
+                break;
+            }
+            continue;
         }
 
+        Logger::event<LogSeverity::Info>(Identity::Urzednik, role,
+                                         ticket.is_vip ? LogEvent::ServiceStartedVip : LogEvent::ServiceStarted,
+                                         ticket.petent_id, ticket.ticket_number);
+
         short_work_delay(static_cast<int>(shared_state->time_mul));
 
         bool redirected = false;
-        if (role == UrzednikRole::SA && shared_state->office_status == OfficeStatus::Open) {
+        if (role == UrzednikRole::SA && shared_state->is_open()) {
             int roll = rng::random_int(1, 100);
             if (roll <= 40) {
                 UrzednikRole target = get_rand_redirect();
                 int target_msg_id = ipc::helper::get_role_queue(target);
                 if (target_msg_id != -1) {
-                    uint32_t ticket_number = 0;
-                    bool limit_reached = false;
-                    if (ipc::sem::wait(sem_id, 1) == -1) {
-                        Logger::log(LogSeverity::Err, Identity::Urzednik, role,
-                                    "Blad blokady licznika biletow dla przekierowania.");
-                    }
-                    else {
-                        int target_idx = static_cast<int>(target);
-                        uint32_t limit = shared_state->ticket_limits[target_idx];
-                        uint32_t current = shared_state->ticket_counters[target_idx];
-                        if (limit != 0 && current >= limit) {
-                            limit_reached = true;
-                        }
-                        else {
-                            ticket_number = ++shared_state->ticket_counters[target_idx];
-                        }
-                        if (ipc::sem::post(sem_id, 1) == -1) {
-                            Logger::log(LogSeverity::Err, Identity::Urzednik, role,
-                                        "Blad odblokowania licznika biletow dla przekierowania.");
-                        }
-                    }
+                    uint32_t ticket_number = shared_state->take_ticket(target);
+                    bool limit_reached = ticket_number == 0;
 
                     if (limit_reached) {
-                        auto dept_name = urzednik_role_to_string(target);
-                        std::string dept = dept_name ? std::string(*dept_name) : std::string("?");
-                        Logger::log(LogSeverity::Notice, Identity::Urzednik, role,
-                                    "Brak wolnych terminow w wydziale " + dept +
-                                        " dla petenta " + std::to_string(ticket.petent_id) +
-                                        ", przekierowanie odrzucone.");
+                        DayStats::bump(shared_state->stats.rejected_limit, target);
+                        Logger::log<LogSeverity::Notice>(Identity::Urzednik, role, [&] {
+                            return "Brak wolnych terminow w wydziale " +
+                                   std::string(urzednik_role_to_string(target).value_or("?")) + " dla petenta " +
+                                   std::to_string(ticket.petent_id) + ", przekierowanie odrzucone.";
+                        });
                         report::log_unserved_after_signal(resolve_report_day(shared_state), ticket.petent_id, target,
                                                          "SA");
                     }
@@ -169,15 +249,11 @@ int urzednik_main(UrzednikRole role) {
                             Logger::log(LogSeverity::Err, Identity::Urzednik, role, error);
                         }
                         else {
-                            if (ticket.is_vip) {
-                                Logger::log(LogSeverity::Notice, Identity::Urzednik, role,
-                                            "Przekierowano petenta VIP " + std::to_string(ticket.petent_id) +
-                                                " do innego wydzialu.");
-                            } else {
-                                Logger::log(LogSeverity::Notice, Identity::Urzednik, role,
-                                            "Przekierowano petenta " + std::to_string(ticket.petent_id) +
-                                                " do innego wydzialu.");
-                            }
+                            DayStats::bump(shared_state->stats.redirected_from_sa, target);
+                            Logger::event<LogSeverity::Notice>(
+                                Identity::Urzednik, role,
+                                ticket.is_vip ? LogEvent::PetentRedirectedVip : LogEvent::PetentRedirected,
+                                ticket.petent_id);
                             redirected = true;
                         }
                     }
@@ -190,71 +266,30 @@ int urzednik_main(UrzednikRole role) {
         }
 
         if (!redirected) {
-            if (role != UrzednikRole::SA && shared_state->office_status == OfficeStatus::Open && !stop_after_current) {
+            bool sent_to_kasa = false;
+            if (role != UrzednikRole::SA && shared_state->is_open() && !stop_after_current) {
                 int kasa_roll = rng::random_int(1, 100);
-                if (kasa_roll <= 10) {
-                    Logger::log(LogSeverity::Notice, Identity::Urzednik, role,
-                                "Petent " + std::to_string(ticket.petent_id) + " skierowany do kasy.");
-
-                    if (msg_req_id != -1) {
-                        ServiceDoneMsg kasa_msg{};
-                        kasa_msg.petent_id = ticket.petent_id;
-                        kasa_msg.department = role;
-                        kasa_msg.action = ServiceAction::GoToKasa;
-                        if (ipc::msg::send<ServiceDoneMsg>(msg_req_id, static_cast<long>(ticket.petent_id), kasa_msg, 0) == -1) {
-                            Logger::log(LogSeverity::Err, Identity::Urzednik, role,
-                                        "Blad wyslania skierowania do kasy.");
-                        } else {
-                            KasaRequestMsg ret{};
-                            bool returned = false;
-                            while (!returned) {
-                                int rrc = ipc::msg::receive<KasaRequestMsg>(msg_id, kKasaReturnQueueType, &ret, 0);
-                                if (rrc == -1) {
-                                    if (errno == EINTR) {
-                                        if (!urzednik_running || stop_after_current) {
-                                            break;
-                                        }
-                                        continue;
-                                    }
-                                    Logger::log(LogSeverity::Err, Identity::Urzednik, role,
-                                                "Blad oczekiwania na powrot petenta z kasy.");
-                                    break;
-                                }
-                                if (ret.petent_id == ticket.petent_id) {
-                                    returned = true;
-                                } else {
-                                    ipc::msg::send<KasaRequestMsg>(msg_id, kKasaReturnQueueType, ret, IPC_NOWAIT);
-                                }
-                            }
-
-                            if (returned) {
-                                Logger::log(LogSeverity::Info, Identity::Urzednik, role,
-                                            "Petent " + std::to_string(ticket.petent_id) + " wrocil z kasy.");
-                            }
-                        }
+                // Parked before the petent learns about it, so even a quick return finds its slot
+                if (kasa_roll <= 10 && replies_available &&
+                    shared_state->park(role, ticket.petent_id, ticket.ticket_number)) {
+                    DayStats::bump(shared_state->stats.sent_to_kasa, role);
+                    Logger::event<LogSeverity::Notice>(Identity::Urzednik, role, LogEvent::SentToKasa, ticket.petent_id);
+
+                    ServiceDoneMsg kasa_msg{};
+                    kasa_msg.petent_id = ticket.petent_id;
+                    kasa_msg.department = role;
+                    kasa_msg.action = ServiceAction::GoToKasa;
+                    if (ipc::helper::send_reply<ServiceDoneMsg>(ticket.petent_id, kasa_msg) == -1) {
+                        Logger::log(LogSeverity::Err, Identity::Urzednik, role, "Blad wyslania skierowania do kasy.");
+                        shared_state->unpark(role, ticket.petent_id);
+                    } else {
+                        sent_to_kasa = true;
                     }
                 }
             }
 
-            if (ticket.is_vip) {
-                Logger::log(LogSeverity::Info, Identity::Urzednik, role,
-                            "Zakonczono obsluge petenta VIP " + std::to_string(ticket.petent_id) + ".");
-            } else {
-                Logger::log(LogSeverity::Info, Identity::Urzednik, role,
-                            "Zakonczono obsluge petenta " + std::to_string(ticket.petent_id) + ".");
-            }
-
-            if (msg_req_id != -1) {
-                ServiceDoneMsg done{};
-                done.petent_id = ticket.petent_id;
-                done.department = role;
-                done.action = ServiceAction::Complete;
-                // Use IPC_NOWAIT when shutting down to avoid blocking on a full queue
-                int send_flags = stop_after_current ? IPC_NOWAIT : 0;
-                if (ipc::msg::send<ServiceDoneMsg>(msg_req_id, static_cast<long>(ticket.petent_id), done, send_flags) == -1) {
-                    Logger::log(LogSeverity::Err, Identity::Urzednik, role,
-                                "Blad wyslania potwierdzenia obslugi petenta.");
-                }
+            if (!sent_to_kasa) {
+                finish_service(ticket);
             }
         }
 
@@ -263,45 +298,15 @@ int urzednik_main(UrzednikRole role) {
         }
     }
 
-    if (stop_after_current) {
-        bool logged_unserved = false;
-        while (true) {
-            TicketIssuedMsg ticket{};
-            int rc = ipc::msg::receive<TicketIssuedMsg>(msg_id, kPriorityMsgType, &ticket, IPC_NOWAIT);
-            if (rc == -1) {
-                if (errno == ENOMSG) {
-                    break;
-                }
-                if (errno == EINTR) {
-                    continue;
-                }
-                std::string error = "Blad odczytu kolejki podczas konczenia pracy: " +
-                                    std::string(std::strerror(errno));
-                Logger::log(LogSeverity::Err, Identity::Urzednik, role, error);
-                break;
-            }
-
-            if (ticket.petent_id == 0) {
-                continue;
-            }
-
-            std::string_view issuer = ticket.redirected_from_sa ? "SA" : "REJESTRACJA";
-            report::log_unserved_after_signal(resolve_report_day(shared_state), ticket.petent_id, ticket.department,
-                                              issuer);
-            Logger::log(LogSeverity::Notice, Identity::Urzednik, role,
-                        "skierowanie do " + std::string(urzednik_role_to_string(ticket.department).value_or("?")) +
-                            " - wystawil " + std::string(issuer) +
-                            " - petent " + std::to_string(ticket.petent_id));
-            logged_unserved = true;
-        }
-
-        if (!logged_unserved) {
-            Logger::log(LogSeverity::Notice, Identity::Urzednik, role,
-                        "Brak nieobsluzonych petentow w kolejce przy zakonczeniu pracy.");
-        }
+    if (stop_after_current && retired) {
+        Logger::log<LogSeverity::Notice>(Identity::Urzednik, role,
+                                         "Urzednik odwolany przez dyrektora - kolejka zostaje dla pozostalych.");
+    }
+    else if (stop_after_current) {
+        drain_unserved(shared_state, role, msg_id);
     }
 
     ipc::shm::detach(shared_state);
-    Logger::log(LogSeverity::Info, Identity::Urzednik, role, "Urzednik zakonczyl prace.");
+    Logger::log<LogSeverity::Info>(Identity::Urzednik, role, "Urzednik zakonczyl prace.");
     return 0;
 }